@@ -0,0 +1,238 @@
+// -----------------------------------------------------------------------
+//
+// Batched depth-first search. Instead of validating one vector per kernel
+// launch, every step of the search gives all 2^d combinations of values to
+// the next d unassigned propositions and validates the 2^d candidates
+// together with submit_batch(). The search then descends into the valid
+// candidates in depth-first order (true before false), so it reports the
+// same solution as search() while launching a kernel once per batch.
+//
+// The batches are pipelined: while the device validates the batch of the
+// level just opened, the host builds and submits the batch of the child
+// level of the parent's next valid candidate, which the search will open
+// when it backtracks there. That batch goes to the second buffer slot of
+// the devices, so it never delays the search's own batches, and its flags
+// are waited for only when the search reaches it.
+//
+// -----------------------------------------------------------------------
+
+// Batch search structure, one entry per level of the search.
+struct batch_level {
+    int trail_size;         // Trail size before the level's values were assigned.
+    int depth;              // Number of propositions given values at this level.
+    int count;              // Number of candidates of the level, 2^depth.
+    int next;               // Next candidate of the level to descend into.
+    int *vars;              // Propositions given values at this level.
+    int *flags;             // Whether each candidate of the level is valid.
+    struct work work;       // Validation of the level's candidates.
+    int ahead;              // Candidate whose child level is validated ahead, -1 if none.
+    int ahead_depth;        // Number of propositions given values by that child level.
+    int *ahead_vars;        // Propositions given values by that child level.
+    int *ahead_flags;       // Whether each candidate of that child level is valid.
+    struct work ahead_work; // Validation of that child level's candidates.
+};
+
+#define SEARCH_SLOT 0       // Buffer slot of the batches the search waits for at once.
+#define AHEAD_SLOT 1        // Buffer slot of the batches validated ahead.
+
+int batch_size;             // Maximum number of candidates validated per kernel launch.
+int batch_pipeline = 1;     // Whether child levels are validated ahead.
+int *batch_candidates[PIPELINE_SLOTS]; // The candidates of each slot's batch, batch_size rows of N values.
+struct work *batch_slot_work[PIPELINE_SLOTS]; // The last work submitted from each slot.
+int *batch_base;            // Values of the candidate whose child level is validated ahead.
+
+// Lists in vars the first unassigned propositions of vector, of n values, at most max of
+// them. Returns how many were listed.
+int next_vars(int n, int *vector, int *vars, int max)
+{
+    int depth = 0;
+
+    for (int var = 0; var < n && depth < max; var++) {
+        if (vector[var] == 0) {
+            vars[depth++] = var;
+        }
+    }
+
+    return depth;
+}
+
+// Builds the candidates of a level from vector, of n values: candidate c gives the level's
+// j-th proposition the value false when bit depth - 1 - j of c is set.
+void build_candidates(int n, int *vector, int *vars, int depth, int *candidates)
+{
+    for (int c = 0; c < (1 << depth); c++) {
+        int *candidate = candidates + (c * n);
+        memcpy(candidate, vector, n * sizeof(int));
+        for (int j = 0; j < depth; j++) {
+            candidate[vars[j]] = ((c >> (depth - 1 - j)) & 1) ? -1 : 1;
+        }
+    }
+}
+
+// Builds the candidates of a level of problem p from vector in the host buffer of a slot
+// and submits them, without waiting. The previous candidates of the slot must have been
+// uploaded first.
+void launch_level(struct problem *p, int *vector, int *vars, int depth, int *flags, struct work *w, int slot)
+{
+    if (batch_slot_work[slot] != NULL) {
+        work_uploaded(batch_slot_work[slot]);
+    }
+    build_candidates(p->N, vector, vars, depth, batch_candidates[slot]);
+    submit_batch(p, w, slot, batch_candidates[slot], 1 << depth, flags);
+    batch_slot_work[slot] = w;
+}
+
+// Validates ahead the child level of the next valid candidate of level l, if any, from
+// the engine's assignment, which gives l's propositions the values of an earlier candidate.
+void launch_ahead(struct engine *e, struct batch_level *l, int depth)
+{
+    int c;
+
+    for (c = l->next; c < l->count && !l->flags[c]; c++);
+    if (c == l->count) {
+        return;
+    }
+    memcpy(batch_base, e->assignment, e->N * sizeof(int));
+    for (int j = 0; j < l->depth; j++) {
+        batch_base[l->vars[j]] = ((c >> (l->depth - 1 - j)) & 1) ? -1 : 1;
+    }
+
+    // A complete candidate has no child level: it is a solution.
+    l->ahead_depth = next_vars(e->N, batch_base, l->ahead_vars, depth);
+    if (l->ahead_depth > 0) {
+        launch_level(e->p, batch_base, l->ahead_vars, l->ahead_depth, l->ahead_flags, &l->ahead_work, AHEAD_SLOT);
+        l->ahead = c;
+    }
+}
+
+// Depth-first search validating batch_size candidates per kernel launch, over the problem
+// of the engine, which the devices hold. Branches on the first unassigned propositions,
+// value true first. Returns 1 when the engine's assignment is a solution, 0 if no solution
+// exists and -1 on error.
+int batch_search(struct engine *e)
+{
+    int i, j, found, top, depth, *swap;
+    int N = e->N;
+    struct batch_level *levels, *l, *parent;
+    struct work ahead;
+
+    // Largest number of propositions whose combinations fit in a batch.
+    for (depth = 0; (2 << depth) <= batch_size && depth < 30; depth++);
+    if (depth == 0) {
+        depth = 1;
+    }
+
+    levels = (struct batch_level*)calloc(N + 1, sizeof(struct batch_level));
+    batch_base = (int*)malloc(N * sizeof(int));
+    if (levels == NULL || batch_base == NULL) {
+        report("Error: malloc for batch search failed.\n");
+        return -1;
+    }
+    for (i = 0; i < PIPELINE_SLOTS; i++) {
+        batch_candidates[i] = (int*)malloc((1 << depth) * N * sizeof(int));
+        batch_slot_work[i] = NULL;
+        if (batch_candidates[i] == NULL) {
+            report("Error: malloc for batch search failed.\n");
+            return -1;
+        }
+    }
+    for (i = 0; i <= N; i++) {
+        levels[i].vars = (int*)malloc(depth * sizeof(int));
+        levels[i].flags = (int*)malloc((1 << depth) * sizeof(int));
+        levels[i].ahead_vars = (int*)malloc(depth * sizeof(int));
+        levels[i].ahead_flags = (int*)malloc((1 << depth) * sizeof(int));
+        if (levels[i].vars == NULL || levels[i].flags == NULL || levels[i].ahead_vars == NULL || levels[i].ahead_flags == NULL
+            || work_init(&levels[i].work) < 0 || work_init(&levels[i].ahead_work) < 0) {
+            report("Error: malloc for batch search failed.\n");
+            return -1;
+        }
+        levels[i].ahead = -1;
+    }
+
+    t1 = wall_clock();
+
+    found = 0;
+    COUNT_ADD(e->checks, 1);
+    if (valid(e->p, e->assignment)) {
+        top = 0;
+        while (top >= 0) {
+            l = &levels[top];
+            if (l->count == 0) {
+                // Open a new level on the next unassigned propositions, taking it from the
+                // parent when it was validated ahead.
+                l->trail_size = e->trail_size;
+                parent = top > 0 ? &levels[top - 1] : NULL;
+                if (parent != NULL && parent->ahead == parent->next - 1) {
+                    swap = l->vars, l->vars = parent->ahead_vars, parent->ahead_vars = swap;
+                    swap = l->flags, l->flags = parent->ahead_flags, parent->ahead_flags = swap;
+                    l->depth = parent->ahead_depth;
+                    ahead = l->work, l->work = parent->ahead_work, parent->ahead_work = ahead;
+                    if (batch_slot_work[AHEAD_SLOT] == &parent->ahead_work) {
+                        batch_slot_work[AHEAD_SLOT] = &l->work;
+                    }
+                    parent->ahead = -1;
+                } else {
+                    l->depth = next_vars(N, e->assignment, l->vars, depth);
+                    if (l->depth == 0) {
+                        found = 1;
+                        break;
+                    }
+                    launch_level(e->p, e->assignment, l->vars, l->depth, l->flags, &l->work, SEARCH_SLOT);
+                }
+                l->count = 1 << l->depth;
+                l->next = 0;
+
+                // While the device validates this level, the host prepares the next one.
+                if (batch_pipeline && parent != NULL) {
+                    launch_ahead(e, parent, depth);
+                }
+                wait_batch(&l->work);
+                COUNT_ADD(e->checks, l->count);
+            } else {
+                engine_undo(e, l->trail_size);
+            }
+
+            // Descend into the next valid candidate, or backtrack when there is none.
+            while (l->next < l->count && !l->flags[l->next]) {
+                l->next++;
+                COUNT_ADD(e->pruned, 1);
+            }
+            if (l->next == l->count) {
+                l->count = 0;
+                top--;
+                continue;
+            }
+            for (j = 0; j < l->depth; j++) {
+                int value = ((l->next >> (l->depth - 1 - j)) & 1) ? -1 : 1;
+                engine_assign(e, value * (l->vars[j] + 1), -1);
+            }
+            COUNT_ADD(e->nodes, l->depth);
+            COUNT_MAX(e->max_depth, e->trail_size);
+            l->next++;
+            levels[++top].count = 0;
+        }
+    }
+
+    t2 = wall_clock();
+
+    // Levels validated ahead that the search did not reach are waited for before their
+    // buffers are released.
+    for (i = 0; i <= N; i++) {
+        if (levels[i].ahead >= 0) {
+            wait_batch(&levels[i].ahead_work);
+        }
+        free(levels[i].vars);
+        free(levels[i].flags);
+        free(levels[i].ahead_vars);
+        free(levels[i].ahead_flags);
+        work_free(&levels[i].work);
+        work_free(&levels[i].ahead_work);
+    }
+    free(levels);
+    for (i = 0; i < PIPELINE_SLOTS; i++) {
+        free(batch_candidates[i]);
+    }
+    free(batch_base);
+
+    return found;
+}
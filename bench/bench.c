@@ -0,0 +1,582 @@
+// -----------------------------------------------------------------------
+//
+// Benchmark harness. Generates uniform random SAT instances from a seed,
+// runs a solver on each of them several times per search mode, and reports
+// the median and 95th percentile wall time, the nodes per second and the
+// peak resident memory of every mode. Every answer is cross-checked: models
+// are verified against the clauses, small instances are decided by an
+// independent backtracking search, and the modes must agree on the rest.
+// The figures can be saved as a baseline, and a later run compared with it
+// reports the modes that became slower or larger.
+//
+// -----------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+// Random instance generator
+#include "gen.c"
+
+// Independent model verifier
+#include "verify.c"
+
+#define BENCH_MAX_MODES 16      // Largest number of modes of a run.
+#define BENCH_MAX_ARGS 16       // Largest number of extra solver arguments.
+#define BENCH_TOLERANCE 0.20    // Default slowdown flagged as a regression.
+#define BENCH_NOISE 0.005       // Median times closer than this, in seconds, are never flagged.
+
+// Results of a solver run.
+#define RUN_UNSAT   0           // The solver proved that no solution exists.
+#define RUN_SAT     1           // The solver printed a model.
+#define RUN_UNKNOWN 2           // The solver gave up, as local search does.
+#define RUN_TIMEOUT 3           // The run was killed at the time limit.
+#define RUN_ERROR   4           // The solver failed or printed no result.
+
+// Figures of a mode.
+struct mode_result {
+    char name[32];              // Search mode, passed as --mode=<name>.
+    double *wall;               // Wall time of every run, in seconds.
+    double *rate;               // Nodes per second of every run.
+    int runs;                   // Number of runs.
+    long peak_rss;              // Largest peak resident memory of a run, in KB.
+    int wrong;                  // Runs with a wrong answer.
+    int failed;                 // Runs that timed out or failed.
+    double median, p95, nodes_per_sec; // Summary of the runs.
+};
+
+char *solver = "./sat_CPU";     // Solver to run.
+char *solver_args[BENCH_MAX_ARGS]; // Extra arguments, given before the problem file.
+int num_solver_args;
+double time_limit = 60.0;       // Seconds after which a run is killed.
+volatile sig_atomic_t alarm_rang; // Set when a run reached the time limit.
+
+// Auxiliary function that displays a message in case of wrong input parameters.
+void syntax_error(char **argv)
+{
+    printf("Wrong syntax. Use the following:\n\n");
+    printf("%s [--solver=<path>] [--arg=<argument>]... [--modes=<mode>,...] [--n=<number>] [--m=<number>]\n", argv[0]);
+    printf("    [--ratio=<number>] [--clauses=<number>] [--instances=<number>] [--runs=<number>] [--seed=<number>]\n");
+    printf("    [--timeout=<seconds>] [--save=<file>] [--baseline=<file>] [--tolerance=<fraction>] [--keep=<directory>]\n");
+    printf("%s --generate=<file> [--n=<number>] [--m=<number>] [--ratio=<number>] [--clauses=<number>] [--seed=<number>]\n", argv[0]);
+    printf("%s --verify=<inputfile> < <solver output>\n\n", argv[0]);
+    printf("where:\n");
+    printf("--solver = solver to benchmark (default ./sat_CPU)\n");
+    printf("--arg = extra argument of the solver, such as the work items of sat_GPU; may be repeated\n");
+    printf("--modes = search modes to compare (default dfs,cdcl,portfolio,cube)\n");
+    printf("--n = propositions per instance (default 40)\n");
+    printf("--m = propositions per clause (default 3)\n");
+    printf("--ratio = clauses per proposition (default %0.2f, the 3-SAT phase transition)\n", GEN_DEFAULT_RATIO);
+    printf("--clauses = clauses per instance, instead of --ratio\n");
+    printf("--instances = instances generated (default 5)\n");
+    printf("--runs = runs of every mode on every instance (default 3)\n");
+    printf("--seed = seed of the first instance, the next ones take the following seeds (default 1)\n");
+    printf("--timeout = seconds after which a run is killed (default 60)\n");
+    printf("--save = write the figures of every mode to this baseline file\n");
+    printf("--baseline = compare the figures of every mode with this baseline file\n");
+    printf("--tolerance = slowdown or growth flagged as a regression (default %0.2f)\n", BENCH_TOLERANCE);
+    printf("--keep = write the instances to this directory and keep them\n");
+    printf("--generate = write one instance to this file\n");
+    printf("--verify = check the model the solver printed on standard input against this problem file\n");
+    printf("Program terminates.\n");
+}
+
+// Returns the time of the monotonic clock, in seconds.
+double wall_clock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+// Notes that the running solver reached the time limit.
+void on_alarm(int sig)
+{
+    alarm_rang = 1;
+}
+
+// Reads a whole file into a string. Returns it, or NULL on error.
+char *read_all(char *filename)
+{
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        return NULL;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *text = (char*)malloc(size + 1);
+    if (text != NULL) {
+        text[fread(text, 1, size, fp)] = '\0';
+    }
+    fclose(fp);
+
+    return text;
+}
+
+// Returns the number following "name": in the JSON statistics of a solver, or -1.
+double json_number(char *json, char *name)
+{
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\": ", name);
+    char *pos = strstr(json, key);
+
+    return pos != NULL ? atof(pos + strlen(key)) : -1.0;
+}
+
+// Runs the solver in a mode on a problem file with its output in out_file and its JSON
+// statistics in stats_file, and stores its wall time, nodes per second and peak resident
+// memory. Returns one of RUN_*.
+int run_solver(char *mode, char *filename, char *out_file, char *stats_file, uint64_t seed, double *wall, double *rate, long *rss)
+{
+    char mode_arg[64], seed_arg[64], stats_arg[600];
+    char *args[BENCH_MAX_ARGS + 8];
+    int n = 0, status;
+    struct rusage usage;
+    pid_t pid, done;
+
+    snprintf(mode_arg, sizeof(mode_arg), "--mode=%s", mode);
+    snprintf(seed_arg, sizeof(seed_arg), "--seed=%lu", (unsigned long)seed);
+    snprintf(stats_arg, sizeof(stats_arg), "--stats=json:%s", stats_file);
+    args[n++] = solver;
+    args[n++] = mode_arg;
+    args[n++] = seed_arg;
+    args[n++] = "--no-cache";
+    args[n++] = stats_arg;
+    for (int i = 0; i < num_solver_args; i++) {
+        args[n++] = solver_args[i];
+    }
+    args[n++] = filename;
+    args[n] = NULL;
+
+    // A statistics file left by an earlier run must not stand for this one.
+    remove(stats_file);
+    double start = wall_clock();
+    pid = fork();
+    if (pid < 0) {
+        printf("Error: fork failed.\n");
+        return RUN_ERROR;
+    }
+    if (pid == 0) {
+        int fd = open(out_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int null = open("/dev/null", O_WRONLY);
+        if (fd < 0 || null < 0) {
+            _exit(127);
+        }
+        dup2(fd, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execv(solver, args);
+        _exit(127);
+    }
+
+    // Wait for the solver; the alarm interrupts the wait at the time limit.
+    struct itimerval limit = {{0, 0}, {(long)time_limit, (long)((time_limit - (long)time_limit) * 1000000)}};
+    struct itimerval off = {{0, 0}, {0, 0}};
+    int killed = 0;
+    alarm_rang = 0;
+    setitimer(ITIMER_REAL, &limit, NULL);
+    while ((done = wait4(pid, &status, 0, &usage)) < 0 && errno == EINTR) {
+        if (alarm_rang && !killed) {
+            kill(pid, SIGKILL);
+            killed = 1;
+        }
+    }
+    *wall = wall_clock() - start;
+    setitimer(ITIMER_REAL, &off, NULL);
+    *rss = usage.ru_maxrss;
+    *rate = 0.0;
+    if (done < 0) {
+        return RUN_ERROR;
+    }
+    if (killed) {
+        return RUN_TIMEOUT;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        return RUN_ERROR;
+    }
+
+    char *json = read_all(stats_file);
+    if (json == NULL) {
+        return RUN_ERROR;
+    }
+    int result = RUN_ERROR;
+    *rate = json_number(json, "nodes_per_sec");
+    if (strstr(json, "\"result\": \"SAT\"") != NULL) {
+        result = RUN_SAT;
+    } else if (strstr(json, "\"result\": \"UNSAT\"") != NULL) {
+        result = RUN_UNSAT;
+    } else if (strstr(json, "\"result\": \"UNKNOWN\"") != NULL) {
+        result = RUN_UNKNOWN;
+    }
+    free(json);
+
+    return result;
+}
+
+// Sorts doubles in increasing order, for qsort.
+int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+// Returns the p-th percentile of count sorted values, by the nearest rank.
+double percentile(double *sorted, int count, double p)
+{
+    int rank = (int)(p / 100.0 * count + 0.999999);
+
+    if (rank < 1) {
+        rank = 1;
+    }
+    return sorted[(rank > count ? count : rank) - 1];
+}
+
+// Summarizes the runs of a mode.
+void summarize(struct mode_result *r)
+{
+    qsort(r->wall, r->runs, sizeof(double), compare_doubles);
+    qsort(r->rate, r->runs, sizeof(double), compare_doubles);
+    r->median = percentile(r->wall, r->runs, 50);
+    r->p95 = percentile(r->wall, r->runs, 95);
+    r->nodes_per_sec = percentile(r->rate, r->runs, 50);
+}
+
+// Writes the figures of every mode to a baseline file. Returns 0, or -1 on error.
+int save_baseline(char *filename, struct mode_result *results, int num_modes, char *setup)
+{
+    FILE *fp = fopen(filename, "w");
+    if (fp == NULL) {
+        printf("Error: cannot write baseline %s.\n", filename);
+        return -1;
+    }
+    fprintf(fp, "# %s\n", setup);
+    fprintf(fp, "# mode median_secs p95_secs nodes_per_sec peak_rss_kb\n");
+    for (int i = 0; i < num_modes; i++) {
+        struct mode_result *r = &results[i];
+        fprintf(fp, "%s %0.6f %0.6f %0.0f %ld\n", r->name, r->median, r->p95, r->nodes_per_sec, r->peak_rss);
+    }
+    fclose(fp);
+
+    return 0;
+}
+
+// Compares the figures of every mode with those of a baseline file: a median or 95th
+// percentile time, or a peak memory, larger by more than the tolerance is a regression.
+// Returns the number of regressions, or -1 on error.
+int compare_baseline(char *filename, struct mode_result *results, int num_modes, double tolerance)
+{
+    char line[256], name[32], setup[256] = "";
+    double median, p95, rate;
+    long rss;
+    int regressions = 0;
+
+    FILE *fp = fopen(filename, "r");
+    if (fp == NULL) {
+        printf("Error: cannot read baseline %s.\n", filename);
+        return -1;
+    }
+    printf("\nComparison with %s:\n", filename);
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (line[0] == '#') {
+            if (setup[0] == '\0') {
+                snprintf(setup, sizeof(setup), "%s", line + 2);
+                printf("    Baseline: %s", setup);
+            }
+            continue;
+        }
+        if (sscanf(line, "%31s %lf %lf %lf %ld", name, &median, &p95, &rate, &rss) != 5) {
+            continue;
+        }
+        for (int i = 0; i < num_modes; i++) {
+            struct mode_result *r = &results[i];
+            if (strcmp(r->name, name) != 0) {
+                continue;
+            }
+            int slower = r->median > median * (1.0 + tolerance) && r->median - median > BENCH_NOISE;
+            int tail = r->p95 > p95 * (1.0 + tolerance) && r->p95 - p95 > BENCH_NOISE;
+            int larger = r->peak_rss > rss * (1.0 + tolerance);
+            printf("    %-12s median %+6.1f%%, p95 %+6.1f%%, nodes/sec %+6.1f%%, peak RSS %+6.1f%%%s\n", name,
+                   median > 0 ? (r->median / median - 1.0) * 100.0 : 0.0,
+                   p95 > 0 ? (r->p95 / p95 - 1.0) * 100.0 : 0.0,
+                   rate > 0 ? (r->nodes_per_sec / rate - 1.0) * 100.0 : 0.0,
+                   rss > 0 ? ((double)r->peak_rss / rss - 1.0) * 100.0 : 0.0,
+                   (slower || tail || larger) ? "  REGRESSION" : "");
+            regressions += (slower || tail || larger);
+        }
+    }
+    fclose(fp);
+
+    return regressions;
+}
+
+// Checks the model a solver printed on standard input against a problem file. Returns
+// 0 when the model satisfies every clause, 1 otherwise.
+int verify_main(char *filename)
+{
+    struct instance in;
+    char *output;
+    size_t size = 0, capacity = 1 << 16;
+    int *model;
+
+    if (instance_read(filename, &in) < 0) {
+        return 1;
+    }
+    output = (char*)malloc(capacity);
+    model = (int*)malloc((in.n + 1) * sizeof(int));
+    if (output == NULL || model == NULL) {
+        printf("Error: malloc for verifier failed.\n");
+        return 1;
+    }
+    while (!feof(stdin)) {
+        if (size + 1 == capacity) {
+            capacity *= 2;
+            output = (char*)realloc(output, capacity);
+            if (output == NULL) {
+                printf("Error: malloc for verifier failed.\n");
+                return 1;
+            }
+        }
+        size += fread(output + size, 1, capacity - size - 1, stdin);
+    }
+    output[size] = '\0';
+
+    int values = model_read(output, in.n, model);
+    if (values == 0) {
+        printf("No model found.\n");
+        return 1;
+    }
+    int bad = model_check(&in, model);
+    if (bad > 0) {
+        printf("Model leaves %d of %d clauses false.\n", bad, in.k);
+        return 1;
+    }
+    printf("Model satisfies all %d clauses.\n", in.k);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    char *modes = "dfs,cdcl,portfolio,cube";
+    char *save_file = NULL, *baseline_file = NULL, *generate_file = NULL, *verify_file = NULL, *keep = NULL;
+    int n = 40, m = 3, clauses = 0, instances = 5, runs = 3;
+    double ratio = GEN_DEFAULT_RATIO, tolerance = BENCH_TOLERANCE;
+    uint64_t seed = 1;
+    struct mode_result results[BENCH_MAX_MODES];
+    int num_modes = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--solver=", 9) == 0) {
+            solver = argv[i] + 9;
+        } else if (strncmp(argv[i], "--arg=", 6) == 0 && num_solver_args < BENCH_MAX_ARGS) {
+            solver_args[num_solver_args++] = argv[i] + 6;
+        } else if (strncmp(argv[i], "--modes=", 8) == 0) {
+            modes = argv[i] + 8;
+        } else if (strncmp(argv[i], "--n=", 4) == 0) {
+            n = atoi(argv[i] + 4);
+        } else if (strncmp(argv[i], "--m=", 4) == 0) {
+            m = atoi(argv[i] + 4);
+        } else if (strncmp(argv[i], "--ratio=", 8) == 0) {
+            ratio = atof(argv[i] + 8);
+        } else if (strncmp(argv[i], "--clauses=", 10) == 0) {
+            clauses = atoi(argv[i] + 10);
+        } else if (strncmp(argv[i], "--instances=", 12) == 0) {
+            instances = atoi(argv[i] + 12);
+        } else if (strncmp(argv[i], "--runs=", 7) == 0) {
+            runs = atoi(argv[i] + 7);
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (strncmp(argv[i], "--timeout=", 10) == 0) {
+            time_limit = atof(argv[i] + 10);
+        } else if (strncmp(argv[i], "--save=", 7) == 0) {
+            save_file = argv[i] + 7;
+        } else if (strncmp(argv[i], "--baseline=", 11) == 0) {
+            baseline_file = argv[i] + 11;
+        } else if (strncmp(argv[i], "--tolerance=", 12) == 0) {
+            tolerance = atof(argv[i] + 12);
+        } else if (strncmp(argv[i], "--keep=", 7) == 0) {
+            keep = argv[i] + 7;
+        } else if (strncmp(argv[i], "--generate=", 11) == 0) {
+            generate_file = argv[i] + 11;
+        } else if (strncmp(argv[i], "--verify=", 9) == 0) {
+            verify_file = argv[i] + 9;
+        } else {
+            syntax_error(argv);
+            exit(-1);
+        }
+    }
+    if (clauses == 0) {
+        clauses = (int)(ratio * n + 0.5);
+    }
+    if (n < 1 || m < 1 || clauses < 1 || instances < 1 || runs < 1 || time_limit <= 0 || tolerance < 0) {
+        syntax_error(argv);
+        exit(-1);
+    }
+
+    if (verify_file != NULL) {
+        return verify_main(verify_file);
+    }
+    if (generate_file != NULL) {
+        return generate(generate_file, n, m, clauses, seed) < 0 ? 1 : 0;
+    }
+
+    // Split the list of modes.
+    modes = strdup(modes);
+    for (char *mode = strtok(modes, ","); mode != NULL && num_modes < BENCH_MAX_MODES; mode = strtok(NULL, ",")) {
+        struct mode_result *r = &results[num_modes++];
+        memset(r, 0, sizeof(struct mode_result));
+        snprintf(r->name, sizeof(r->name), "%s", mode);
+        r->wall = (double*)malloc(instances * runs * sizeof(double));
+        r->rate = (double*)malloc(instances * runs * sizeof(double));
+        if (r->wall == NULL || r->rate == NULL) {
+            printf("Error: malloc for results failed.\n");
+            exit(-1);
+        }
+    }
+    // The alarm must interrupt the wait for a solver rather than restart it.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_alarm;
+    sigaction(SIGALRM, &action, NULL);
+    if (access(solver, X_OK) != 0) {
+        printf("Error: cannot run solver %s.\n", solver);
+        exit(-1);
+    }
+
+    // The instances go to a directory of their own.
+    char dir[256], filename[512], out_file[512], stats_file[512], setup[256];
+    if (keep != NULL) {
+        snprintf(dir, sizeof(dir), "%s", keep);
+        mkdir(dir, 0755);
+    } else {
+        snprintf(dir, sizeof(dir), "/tmp/sat_bench.XXXXXX");
+        if (mkdtemp(dir) == NULL) {
+            printf("Error: cannot create a directory for the instances.\n");
+            exit(-1);
+        }
+    }
+    snprintf(out_file, sizeof(out_file), "%s/output.txt", dir);
+    snprintf(stats_file, sizeof(stats_file), "%s/stats.json", dir);
+    snprintf(setup, sizeof(setup), "solver %s, n %d, m %d, clauses %d, instances %d, runs %d, seed %lu",
+             solver, n, m, clauses, instances, runs, (unsigned long)seed);
+
+    printf("\nBenchmark of %s on %d random %d-SAT instances of %d propositions and %d clauses,\n", solver, instances, m, n, clauses);
+    printf("%d runs per mode and instance, seeds %lu to %lu.\n\n", runs, (unsigned long)seed, (unsigned long)(seed + instances - 1));
+
+    int wrong = 0;
+    int *model = (int*)malloc((n + 1) * sizeof(int));
+    int *answer = (int*)malloc(num_modes * sizeof(int));
+    if (model == NULL || answer == NULL) {
+        printf("Error: malloc for results failed.\n");
+        exit(-1);
+    }
+    for (int i = 0; i < instances; i++) {
+        struct instance in;
+        snprintf(filename, sizeof(filename), "%s/rand_%d_%d_%d_%lu.txt", dir, m, n, clauses, (unsigned long)(seed + i));
+        if (generate(filename, n, m, clauses, seed + i) < 0 || instance_read(filename, &in) < 0) {
+            exit(-1);
+        }
+
+        // The independent search decides small instances; larger ones rely on the models
+        // and on the agreement of the modes.
+        int expected = oracle(&in);
+        printf("Instance %d: %s\n", i, expected < 0 ? "undecided by the verifier" : (expected ? "satisfiable" : "unsatisfiable"));
+
+        for (int m = 0; m < num_modes; m++) {
+            struct mode_result *r = &results[m];
+            answer[m] = -1;
+            for (int run = 0; run < runs; run++) {
+                double wall, rate;
+                long rss;
+                int result = run_solver(r->name, filename, out_file, stats_file, seed + run, &wall, &rate, &rss);
+                r->wall[r->runs] = wall;
+                r->rate[r->runs++] = rate;
+                if (rss > r->peak_rss) {
+                    r->peak_rss = rss;
+                }
+
+                // Check the answer.
+                char *problem = NULL;
+                if (result == RUN_SAT) {
+                    char *output = read_all(out_file);
+                    int values = output != NULL ? model_read(output, n, model) : 0;
+                    free(output);
+                    if (values < n || model_check(&in, model) > 0) {
+                        problem = "model leaves clauses false";
+                    }
+                } else if (result == RUN_UNSAT && expected == 1) {
+                    problem = "no solution reported for a satisfiable instance";
+                } else if (result == RUN_TIMEOUT || result == RUN_ERROR) {
+                    r->failed++;
+                    printf("    %s, run %d: %s\n", r->name, run, result == RUN_TIMEOUT ? "timed out" : "failed");
+                }
+                if (problem == NULL && (result == RUN_SAT || result == RUN_UNSAT)) {
+                    answer[m] = result;
+                } else if (problem != NULL) {
+                    r->wrong++;
+                    wrong++;
+                    printf("    %s, run %d: WRONG, %s\n", r->name, run, problem);
+                }
+            }
+        }
+
+        // Without the independent search, a mode proving that no solution exists while
+        // another one found a verified model is wrong.
+        for (int m = 0; m < num_modes && expected < 0; m++) {
+            for (int o = 0; o < num_modes; o++) {
+                if (answer[m] == RUN_UNSAT && answer[o] == RUN_SAT) {
+                    results[m].wrong++;
+                    wrong++;
+                    printf("    %s: WRONG, no solution reported while %s found one\n", results[m].name, results[o].name);
+                    break;
+                }
+            }
+        }
+        instance_free(&in);
+    }
+    if (keep == NULL) {
+        remove(out_file);
+        remove(stats_file);
+        for (int i = 0; i < instances; i++) {
+            snprintf(filename, sizeof(filename), "%s/rand_%d_%d_%d_%lu.txt", dir, m, n, clauses, (unsigned long)(seed + i));
+            remove(filename);
+        }
+        rmdir(dir);
+    }
+
+    printf("\n%-12s %12s %12s %14s %14s %8s %8s\n", "Mode", "Median secs", "P95 secs", "Nodes/sec", "Peak RSS KB", "Failed", "Wrong");
+    for (int m = 0; m < num_modes; m++) {
+        struct mode_result *r = &results[m];
+        summarize(r);
+        printf("%-12s %12.4f %12.4f %14.0f %14ld %8d %8d\n", r->name, r->median, r->p95, r->nodes_per_sec, r->peak_rss, r->failed, r->wrong);
+    }
+
+    int regressions = 0;
+    if (save_file != NULL && save_baseline(save_file, results, num_modes, setup) == 0) {
+        printf("\nBaseline written to %s\n", save_file);
+    }
+    if (baseline_file != NULL) {
+        regressions = compare_baseline(baseline_file, results, num_modes, tolerance);
+        if (regressions < 0) {
+            exit(-1);
+        }
+    }
+    if (wrong > 0 || regressions > 0) {
+        printf("\n%d wrong answers, %d regressions.\n", wrong, regressions);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+// -----------------------------------------------------------------------
+//
+// Uniform random SAT generator. Every clause holds M distinct
+// propositions drawn uniformly, each negated with probability 1/2, which
+// is the model of the satisfiability phase transition: 3-SAT instances
+// with about 4.26 clauses per proposition are the hardest, half of them
+// satisfiable. Instances are written in the original input format of the
+// solvers (propositions, clauses, propositions per clause, then the
+// clauses), and depend only on their parameters and seed.
+//
+// -----------------------------------------------------------------------
+
+#define GEN_DEFAULT_RATIO 4.26  // Clauses per proposition of the 3-SAT phase transition.
+
+uint64_t gen_state;     // State of the random number generator.
+
+// Seeds the random number generator. Equal seeds give equal instances on every machine.
+void gen_seed(uint64_t seed)
+{
+    gen_state = (seed * 0x9E3779B97F4A7C15ULL) | 1;
+}
+
+// Returns the next random number, from the xorshift64* generator.
+uint64_t gen_next(void)
+{
+    gen_state ^= gen_state >> 12;
+    gen_state ^= gen_state << 25;
+    gen_state ^= gen_state >> 27;
+
+    return gen_state * 0x2545F4914F6CDD1DULL;
+}
+
+// Returns a random number in [0, n).
+int gen_below(int n)
+{
+    return (int)((gen_next() >> 11) % (uint64_t)n);
+}
+
+// Writes a uniform random instance of n propositions and the given number of
+// clauses of m propositions to a file. Returns 0, or -1 on error.
+int generate(char *filename, int n, int m, int clauses, uint64_t seed)
+{
+    FILE *fp;
+    int i, j, l;
+    int *clause;
+
+    if (m < 1 || m > n || clauses < 1) {
+        printf("Error: cannot draw %d clauses of %d distinct propositions out of %d.\n", clauses, m, n);
+        return -1;
+    }
+    fp = fopen(filename, "w");
+    clause = (int*)malloc(m * sizeof(int));
+    if (fp == NULL || clause == NULL) {
+        printf("Error: cannot write instance %s.\n", filename);
+        return -1;
+    }
+
+    gen_seed(seed);
+    fprintf(fp, "%d %d %d\n", n, clauses, m);
+    for (i = 0; i < clauses; i++) {
+        for (j = 0; j < m; j++) {
+            // Draw again until the proposition differs from the previous ones.
+            do {
+                clause[j] = gen_below(n) + 1;
+                for (l = 0; l < j && clause[l] != clause[j]; l++);
+            } while (l < j);
+            fprintf(fp, "%s%d", j > 0 ? " " : "", (gen_next() >> 63) ? -clause[j] : clause[j]);
+        }
+        fprintf(fp, "\n");
+    }
+
+    free(clause);
+    if (fclose(fp) != 0) {
+        printf("Error: cannot write instance %s.\n", filename);
+        return -1;
+    }
+
+    return 0;
+}
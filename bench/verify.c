@@ -0,0 +1,236 @@
+// -----------------------------------------------------------------------
+//
+// Independent model verifier. The problem file is read again with a parser
+// of its own, in either input format, and the model a solver printed is
+// checked against every clause. Small problems are also decided by a plain
+// backtracking search that shares no code with the solvers, so a solver
+// reporting that no solution exists can be caught as well.
+//
+// -----------------------------------------------------------------------
+
+#define ORACLE_MAX_N 60     // Largest number of propositions the backtracking search decides.
+
+// Problem as read by the verifier.
+struct instance {
+    int n;                  // Number of propositions.
+    int k;                  // Number of clauses.
+    int *start;             // Position in lits of each clause, and of the end of the last one.
+    int *lits;              // Literals of the clauses, back to back.
+    int *occ_start;         // Position in occ of the clauses of each proposition.
+    int *occ;               // Clauses holding each proposition, for the backtracking search.
+};
+
+// Appends a literal to the clauses of an instance, growing the table as needed.
+int instance_add(struct instance *in, int lit, int *size, int *capacity)
+{
+    if (*size == *capacity) {
+        *capacity = *capacity > 0 ? 2 * *capacity : 1024;
+        int *grown = (int*)realloc(in->lits, *capacity * sizeof(int));
+        if (grown == NULL) {
+            return -1;
+        }
+        in->lits = grown;
+    }
+    in->lits[(*size)++] = lit;
+
+    return 0;
+}
+
+// Reads a problem in the original format or in DIMACS CNF. Returns 0, or -1 on error.
+int instance_read(char *filename, struct instance *in)
+{
+    FILE *fp;
+    char line[256];
+    int i, m, lit, c, dimacs, size = 0, capacity = 0;
+
+    memset(in, 0, sizeof(struct instance));
+    fp = fopen(filename, "r");
+    if (fp == NULL) {
+        printf("Error: cannot open %s.\n", filename);
+        return -1;
+    }
+
+    // DIMACS starts with comments or the problem line, the original format with a number.
+    c = fgetc(fp);
+    while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+        c = fgetc(fp);
+    }
+    ungetc(c, fp);
+    dimacs = (c == 'c' || c == 'p');
+    if (dimacs) {
+        while (fgets(line, sizeof(line), fp) != NULL && sscanf(line, "p cnf %d %d", &in->n, &in->k) != 2);
+    } else if (fscanf(fp, "%d %d %d", &in->n, &in->k, &m) != 3) {
+        in->n = 0;
+    }
+    in->start = (int*)malloc((in->k + 1) * sizeof(int));
+    if (in->n <= 0 || in->k <= 0 || in->start == NULL) {
+        printf("Error: %s is not a problem file.\n", filename);
+        fclose(fp);
+        return -1;
+    }
+
+    for (i = 0; i < in->k; i++) {
+        in->start[i] = size;
+        if (dimacs) {
+            // Read up to the closing 0, skipping comment lines.
+            while ((c = fscanf(fp, " %d", &lit)) != EOF && (c == 0 || lit != 0)) {
+                if (c == 0) {
+                    if (fgets(line, sizeof(line), fp) == NULL) {
+                        break;
+                    }
+                } else if (instance_add(in, lit, &size, &capacity) < 0) {
+                    break;
+                }
+            }
+        } else {
+            for (int j = 0; j < m && fscanf(fp, "%d", &lit) == 1; j++) {
+                if (instance_add(in, lit, &size, &capacity) < 0) {
+                    break;
+                }
+            }
+        }
+    }
+    in->start[in->k] = size;
+    fclose(fp);
+
+    // List the clauses of every proposition.
+    in->occ_start = (int*)calloc(in->n + 2, sizeof(int));
+    in->occ = (int*)malloc((size > 0 ? size : 1) * sizeof(int));
+    if (in->occ_start == NULL || in->occ == NULL) {
+        printf("Error: malloc for verifier failed.\n");
+        return -1;
+    }
+    for (i = 0; i < size; i++) {
+        if (in->lits[i] == 0 || abs(in->lits[i]) > in->n) {
+            printf("Error: %s holds a literal out of range.\n", filename);
+            return -1;
+        }
+        in->occ_start[abs(in->lits[i]) + 1]++;
+    }
+    for (i = 1; i <= in->n + 1; i++) {
+        in->occ_start[i] += in->occ_start[i - 1];
+    }
+    int *fill = (int*)malloc((in->n + 1) * sizeof(int));
+    if (fill == NULL) {
+        printf("Error: malloc for verifier failed.\n");
+        return -1;
+    }
+    memcpy(fill, in->occ_start, (in->n + 1) * sizeof(int));
+    for (c = 0; c < in->k; c++) {
+        for (i = in->start[c]; i < in->start[c + 1]; i++) {
+            in->occ[fill[abs(in->lits[i])]++] = c;
+        }
+    }
+    free(fill);
+
+    return 0;
+}
+
+// Releases the tables of an instance.
+void instance_free(struct instance *in)
+{
+    free(in->start);
+    free(in->lits);
+    free(in->occ_start);
+    free(in->occ);
+}
+
+// Reads the values a solver printed as P<i>=true or P<i>=false into model, indexed from 1;
+// propositions without a value get 0. Returns the number of values read.
+int model_read(char *output, int n, int *model)
+{
+    int count = 0;
+    char *pos = output;
+
+    memset(model, 0, (n + 1) * sizeof(int));
+    while ((pos = strstr(pos, "P")) != NULL) {
+        int p;
+        char value[6];
+        if (sscanf(pos, "P%d=%5[a-z]", &p, value) == 2 && p >= 1 && p <= n) {
+            if (strcmp(value, "true") == 0) {
+                model[p] = 1;
+                count++;
+            } else if (strcmp(value, "false") == 0) {
+                model[p] = -1;
+                count++;
+            }
+        }
+        pos++;
+    }
+
+    return count;
+}
+
+// Returns the number of clauses of an instance that a model leaves false.
+int model_check(struct instance *in, int *model)
+{
+    int c, i, bad = 0;
+
+    for (c = 0; c < in->k; c++) {
+        for (i = in->start[c]; i < in->start[c + 1]; i++) {
+            int lit = in->lits[i];
+            if ((lit > 0 && model[lit] == 1) || (lit < 0 && model[-lit] == -1)) {
+                break;
+            }
+        }
+        bad += (i == in->start[c + 1]);
+    }
+
+    return bad;
+}
+
+// Returns 1 if a clause holding proposition p has every literal false under values.
+int oracle_conflict(struct instance *in, int *values, int p)
+{
+    for (int o = in->occ_start[p]; o < in->occ_start[p + 1]; o++) {
+        int c = in->occ[o], i;
+        for (i = in->start[c]; i < in->start[c + 1]; i++) {
+            int lit = in->lits[i];
+            int value = lit > 0 ? values[lit] : -values[-lit];
+            if (value >= 0) {
+                break;
+            }
+        }
+        if (i == in->start[c + 1]) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// Backtracking over propositions p to n, true first. Returns 1 if values extend to a model.
+int oracle_search(struct instance *in, int *values, int p)
+{
+    if (p > in->n) {
+        return 1;
+    }
+    for (int value = 1; value >= -1; value -= 2) {
+        values[p] = value;
+        if (!oracle_conflict(in, values, p) && oracle_search(in, values, p + 1)) {
+            return 1;
+        }
+    }
+    values[p] = 0;
+
+    return 0;
+}
+
+// Decides a small instance by backtracking. Returns 1 if it has a solution, 0 if it has
+// none, and -1 if it has too many propositions or memory is exhausted.
+int oracle(struct instance *in)
+{
+    int found, *values;
+
+    if (in->n > ORACLE_MAX_N) {
+        return -1;
+    }
+    values = (int*)calloc(in->n + 1, sizeof(int));
+    if (values == NULL) {
+        return -1;
+    }
+    found = oracle_search(in, values, 1);
+    free(values);
+
+    return found;
+}
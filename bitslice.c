@@ -0,0 +1,230 @@
+// -----------------------------------------------------------------------
+//
+// Bit-sliced exhaustive evaluation. Complete assignments are numbered from 0
+// to 2^N - 1: proposition i (counting from 0) is false when bit N - 1 - i of
+// the number is set, so the numbering follows the order in which the
+// depth-first search visits complete assignments and the first satisfying
+// number is the solution the search would report. A block packs 64 numbers
+// into the lanes of a 64-bit word, one bit per assignment; every clause is
+// evaluated for all lanes at once with bitwise OR over its literals and AND
+// across clauses, and a block is abandoned as soon as no lane is left.
+// Wider kernels evaluate 4 (AVX2) or 8 (AVX-512) consecutive blocks together
+// and are selected at runtime when the processor supports them.
+//
+// -----------------------------------------------------------------------
+
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define BITSLICE_AUTO_N 20  // Problems with at most this many propositions are enumerated by default.
+#define BITSLICE_MAX_N 62   // Largest number of propositions that can be enumerated.
+#define BITSLICE_CHUNK 4096 // Blocks handed to a kernel per call.
+
+char *bitslice_kernel_name; // Name of the kernel selected at runtime.
+
+// Lanes of a block whose assignment number has bit q set, for the 6 lane bits.
+const uint64_t lane_pattern[6] = {
+    0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL
+};
+
+// Returns the word of a block whose lanes are set where proposition i of n is true.
+uint64_t true_lanes(int n, uint64_t block, int i)
+{
+    int q = n - 1 - i;
+
+    if (q < 6) {
+        return ~lane_pattern[q];
+    }
+
+    return ((block >> (q - 6)) & 1) ? 0 : ~0ULL;
+}
+
+// Returns the lanes of the block that hold valid assignment numbers, for n propositions.
+uint64_t valid_lanes(int n)
+{
+    return (n >= 6) ? ~0ULL : ((1ULL << (1 << n)) - 1);
+}
+
+// Portable kernel: evaluates one block per iteration of problem p, whose literals are
+// given by their LIT_INDEX in lits. Returns 1 and stores the number of the first
+// satisfying assignment in index, or returns 0.
+int bitslice_scalar(struct problem *p, int *lits, uint64_t block, uint64_t count, uint64_t *index)
+{
+    int i, j;
+    int n = p->N, k = p->K;
+    int *offsets = p->Offsets;
+    uint64_t acc, clause;
+    uint64_t lit_lanes[2 * BITSLICE_MAX_N];
+
+    for (uint64_t b = block; b < block + count; b++) {
+        for (i = 0; i < n; i++) {
+            lit_lanes[2 * i] = true_lanes(n, b, i);
+            lit_lanes[2 * i + 1] = ~lit_lanes[2 * i];
+        }
+
+        acc = valid_lanes(n);
+        for (i = 0; i < k && acc != 0; i++) {
+            clause = 0;
+            for (j = offsets[i]; j < offsets[i + 1]; j++) {
+                clause |= lit_lanes[lits[j]];
+            }
+            acc &= clause;
+        }
+
+        if (acc != 0) {
+            *index = b * 64 + __builtin_ctzll(acc);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// AVX2 kernel: evaluates 4 consecutive blocks per iteration.
+__attribute__((target("avx2")))
+int bitslice_avx2(struct problem *p, int *lits, uint64_t block, uint64_t count, uint64_t *index)
+{
+    int i, j, w;
+    int n = p->N, k = p->K;
+    int *offsets = p->Offsets;
+    __m256i acc, clause;
+    __m256i lit_lanes[2 * BITSLICE_MAX_N];
+    uint64_t words[4];
+    uint64_t b;
+
+    for (b = block; b + 4 <= block + count; b += 4) {
+        for (i = 0; i < n; i++) {
+            lit_lanes[2 * i] = _mm256_set_epi64x(true_lanes(n, b + 3, i), true_lanes(n, b + 2, i),
+                                                 true_lanes(n, b + 1, i), true_lanes(n, b, i));
+            lit_lanes[2 * i + 1] = _mm256_xor_si256(lit_lanes[2 * i], _mm256_set1_epi64x(-1));
+        }
+
+        acc = _mm256_set1_epi64x(-1);
+        for (i = 0; i < k && !_mm256_testz_si256(acc, acc); i++) {
+            clause = _mm256_setzero_si256();
+            for (j = offsets[i]; j < offsets[i + 1]; j++) {
+                clause = _mm256_or_si256(clause, lit_lanes[lits[j]]);
+            }
+            acc = _mm256_and_si256(acc, clause);
+        }
+
+        if (!_mm256_testz_si256(acc, acc)) {
+            _mm256_storeu_si256((__m256i*)words, acc);
+            for (w = 0; words[w] == 0; w++);
+            *index = (b + w) * 64 + __builtin_ctzll(words[w]);
+            return 1;
+        }
+    }
+
+    return bitslice_scalar(p, lits, b, block + count - b, index);
+}
+
+// AVX-512 kernel: evaluates 8 consecutive blocks per iteration.
+__attribute__((target("avx512f")))
+int bitslice_avx512(struct problem *p, int *lits, uint64_t block, uint64_t count, uint64_t *index)
+{
+    int i, j, w;
+    int n = p->N, k = p->K;
+    int *offsets = p->Offsets;
+    __m512i acc, clause;
+    __m512i lit_lanes[2 * BITSLICE_MAX_N];
+    uint64_t words[8];
+    uint64_t b;
+
+    for (b = block; b + 8 <= block + count; b += 8) {
+        for (i = 0; i < n; i++) {
+            lit_lanes[2 * i] = _mm512_set_epi64(true_lanes(n, b + 7, i), true_lanes(n, b + 6, i),
+                                                true_lanes(n, b + 5, i), true_lanes(n, b + 4, i),
+                                                true_lanes(n, b + 3, i), true_lanes(n, b + 2, i),
+                                                true_lanes(n, b + 1, i), true_lanes(n, b, i));
+            lit_lanes[2 * i + 1] = _mm512_xor_si512(lit_lanes[2 * i], _mm512_set1_epi64(-1));
+        }
+
+        acc = _mm512_set1_epi64(-1);
+        for (i = 0; i < k && _mm512_test_epi64_mask(acc, acc) != 0; i++) {
+            clause = _mm512_setzero_si512();
+            for (j = offsets[i]; j < offsets[i + 1]; j++) {
+                clause = _mm512_or_si512(clause, lit_lanes[lits[j]]);
+            }
+            acc = _mm512_and_si512(acc, clause);
+        }
+
+        if (_mm512_test_epi64_mask(acc, acc) != 0) {
+            _mm512_storeu_si512((void*)words, acc);
+            for (w = 0; words[w] == 0; w++);
+            *index = (b + w) * 64 + __builtin_ctzll(words[w]);
+            return 1;
+        }
+    }
+
+    return bitslice_scalar(p, lits, b, block + count - b, index);
+}
+#endif
+
+// Selects the widest kernel the processor supports.
+int (*select_bitslice_kernel())(struct problem*, int*, uint64_t, uint64_t, uint64_t*)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        bitslice_kernel_name = "AVX-512";
+        return bitslice_avx512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        bitslice_kernel_name = "AVX2";
+        return bitslice_avx2;
+    }
+#endif
+    bitslice_kernel_name = "scalar";
+    return bitslice_scalar;
+}
+
+// Enumerates every complete assignment of a problem in bit-sliced blocks. Returns 1 and
+// stores the first satisfying assignment in vector, 0 if no solution exists and -1 on error.
+int bitslice(struct problem *p, int *vector)
+{
+    int i;
+    uint64_t block, blocks, index;
+    int (*kernel)(struct problem*, int*, uint64_t, uint64_t, uint64_t*);
+    int *lits;
+
+    if (p->N > BITSLICE_MAX_N) {
+        report("Too many propositions for bit-sliced enumeration. Program terminates.\n");
+        return -1;
+    }
+
+    // The literals are replaced by their LIT_INDEX.
+    lits = (int*)malloc((p->Offsets[p->K] > 0 ? p->Offsets[p->K] : 1) * sizeof(int));
+    if (lits == NULL) {
+        report("Error: malloc for bit-sliced enumeration failed.\n");
+        return -1;
+    }
+    for (i = 0; i < p->Offsets[p->K]; i++) {
+        lits[i] = LIT_INDEX(p->Problem[i]);
+    }
+    kernel = select_bitslice_kernel();
+
+    t1 = wall_clock();
+
+    blocks = (p->N > 6) ? (1ULL << (p->N - 6)) : 1;
+    for (block = 0; block < blocks; block += BITSLICE_CHUNK) {
+        uint64_t count = (blocks - block < BITSLICE_CHUNK) ? blocks - block : BITSLICE_CHUNK;
+        if (kernel(p, lits, block, count, &index)) {
+            for (i = 0; i < p->N; i++) {
+                vector[i] = ((index >> (p->N - 1 - i)) & 1) ? -1 : 1;
+            }
+            t2 = wall_clock();
+            free(lits);
+            return 1;
+        }
+    }
+
+    t2 = wall_clock();
+    free(lits);
+
+    return 0;
+}
@@ -0,0 +1,405 @@
+// -----------------------------------------------------------------------
+//
+// Conflict-Driven Clause Learning search. Every conflict found by unit
+// propagation is analysed on the implication graph down to its first unique
+// implication point (1-UIP); the resulting clause is added to the learned
+// clause database of the engine and the search backjumps to the second
+// highest decision level of that clause. Restarts follow the Luby sequence
+// and the least active learned clauses are deleted to bound memory.
+//
+// -----------------------------------------------------------------------
+
+#define RESTART_BASE 100        // Conflicts of the first restart interval.
+#define CLAUSE_DECAY 0.999      // Decay factor of learned clause activities.
+
+// Returns the i-th element (starting from 0) of the Luby sequence 1 1 2 1 1 2 4 ...
+int luby(int i)
+{
+    int size, seq;
+
+    for (size = 1, seq = 0; size < i + 1; seq++, size = 2 * size + 1);
+    while (size - 1 != i) {
+        size = (size - 1) >> 1;
+        seq--;
+        i = i % size;
+    }
+
+    return 1 << seq;
+}
+
+// Increases the activity of a learned clause, rescaling all activities on overflow.
+void bump_clause(struct engine *e, int c)
+{
+    if (c < e->K) {
+        return;
+    }
+    e->learnt_activity[c - e->K] += e->clause_increment;
+    if (e->learnt_activity[c - e->K] > 1e20) {
+        for (int i = 0; i < e->num_learnts; i++) {
+            e->learnt_activity[i] *= 1e-20;
+        }
+        e->clause_increment *= 1e-20;
+    }
+}
+
+// Adds a clause of at least two literals to the learned clause database and watches
+// its first two literals. Returns the index of the new clause, or -1 if memory is exhausted.
+int add_learnt(struct engine *e, int *lits, int size)
+{
+    if (e->num_learnts == e->learnt_capacity) {
+        int capacity = e->learnt_capacity > 0 ? 2 * e->learnt_capacity : 64;
+        int *start = (int*)realloc(e->learnt_start, capacity * sizeof(int));
+        int *length = (int*)realloc(e->learnt_length, capacity * sizeof(int));
+        double *activity = (double*)realloc(e->learnt_activity, capacity * sizeof(double));
+        int *watch0 = (int*)realloc(e->watch0, (e->K + capacity) * sizeof(int));
+        int *watch1 = (int*)realloc(e->watch1, (e->K + capacity) * sizeof(int));
+        if (start != NULL) e->learnt_start = start;
+        if (length != NULL) e->learnt_length = length;
+        if (activity != NULL) e->learnt_activity = activity;
+        if (watch0 != NULL) e->watch0 = watch0;
+        if (watch1 != NULL) e->watch1 = watch1;
+        if (start == NULL || length == NULL || activity == NULL || watch0 == NULL || watch1 == NULL) {
+            report("Error: realloc for learned clauses failed.\n");
+            return -1;
+        }
+        e->learnt_capacity = capacity;
+        e->allocations += 5;
+    }
+
+    if (e->learnt_lits_size + size > e->learnt_lits_capacity) {
+        int capacity = e->learnt_lits_capacity > 0 ? 2 * e->learnt_lits_capacity : 1024;
+        while (capacity < e->learnt_lits_size + size) {
+            capacity *= 2;
+        }
+        int *lits_table = (int*)realloc(e->learnt_lits, capacity * sizeof(int));
+        if (lits_table == NULL) {
+            report("Error: realloc for learned clauses failed.\n");
+            return -1;
+        }
+        e->learnt_lits = lits_table;
+        e->learnt_lits_capacity = capacity;
+        e->allocations++;
+    }
+
+    int c = e->K + e->num_learnts;
+    e->learnt_start[e->num_learnts] = e->learnt_lits_size;
+    e->learnt_length[e->num_learnts] = size;
+    e->learnt_activity[e->num_learnts] = 0.0;
+    e->num_learnts++;
+    memcpy(e->learnt_lits + e->learnt_lits_size, lits, size * sizeof(int));
+    e->learnt_lits_size += size;
+
+    e->watch0[c] = lits[0];
+    e->watch1[c] = lits[1];
+    if (watch(e, lits[0], c) < 0 || watch(e, lits[1], c) < 0) {
+        return -1;
+    }
+    bump_clause(e, c);
+
+    return c;
+}
+
+// Analyses a conflict on the implication graph. The learned clause is left in the
+// engine's buffer with the negation of the first unique implication point first and,
+// if there are more literals, the one of the highest remaining level second.
+// Returns the size of the learned clause and stores the backjump level in bt_level.
+int analyze(struct engine *e, int conflict, int *bt_level)
+{
+    int i, j, k, size, n, var, keep;
+    int *lits;
+    int path = 0;   // Literals of the conflict level still to be resolved.
+    int p = 0;      // Literal whose reason is being resolved.
+    int idx = e->trail_size - 1;
+    int c = conflict;
+
+    size = 1;
+    do {
+        bump_clause(e, c);
+        lits = engine_clause(e, c, &n);
+        for (j = 0; j < n; j++) {
+            var = VAR(lits[j]);
+            if (lits[j] == p || e->seen[var] || e->level[var] == 0) {
+                continue;
+            }
+            e->seen[var] = 1;
+            bump_variable(e, var);
+            if (e->level[var] >= e->num_decisions) {
+                path++;
+            } else {
+                e->buffer[size++] = lits[j];
+            }
+        }
+
+        // Select the next literal of the conflict level to resolve on.
+        while (!e->seen[VAR(e->trail[idx])]) {
+            idx--;
+        }
+        p = e->trail[idx--];
+        c = e->reason[VAR(p)];
+        e->seen[VAR(p)] = 0;
+        path--;
+    } while (path > 0);
+    e->buffer[0] = -p;
+
+    // Drop the literals implied by the other literals of the clause: their reason
+    // only contains propositions of the clause or of level 0.
+    for (i = 1, j = 1; i < size; i++) {
+        var = VAR(e->buffer[i]);
+        keep = (e->reason[var] < 0);
+        if (!keep) {
+            lits = engine_clause(e, e->reason[var], &n);
+            for (k = 0; k < n; k++) {
+                if (VAR(lits[k]) != var && !e->seen[VAR(lits[k])] && e->level[VAR(lits[k])] > 0) {
+                    keep = 1;
+                    break;
+                }
+            }
+        }
+        if (keep) {
+            int lit = e->buffer[j];
+            e->buffer[j++] = e->buffer[i];
+            e->buffer[i] = lit;
+        }
+    }
+    for (i = 1; i < size; i++) {
+        e->seen[VAR(e->buffer[i])] = 0;
+    }
+    size = j;
+
+    // Backjump to the highest level below the conflict level.
+    *bt_level = 0;
+    for (i = 1; i < size; i++) {
+        if (e->level[VAR(e->buffer[i])] > *bt_level) {
+            *bt_level = e->level[VAR(e->buffer[i])];
+            int lit = e->buffer[1];
+            e->buffer[1] = e->buffer[i];
+            e->buffer[i] = lit;
+        }
+    }
+
+    return size;
+}
+
+// Takes back every decision above the given level, with the values they implied.
+void backjump(struct engine *e, int level)
+{
+    if (level < e->num_decisions) {
+        engine_undo(e, e->decisions[level]);
+        e->num_decisions = level;
+    }
+}
+
+// Orders learned clauses by increasing activity.
+int compare_activity(const void *a, const void *b)
+{
+    double x = ((const double*)a)[0];
+    double y = ((const double*)b)[0];
+
+    return (x > y) - (x < y);
+}
+
+// Deletes the learned clauses satisfied at level 0 and the less active half of the
+// others, keeping binary clauses. Must be called at decision level 0, where no
+// learned clause is needed as a reason, so the database can be compacted.
+void reduce_learnts(struct engine *e)
+{
+    int i, j, k, n, size, start;
+    int *lits;
+    double median = 0.0;
+
+    // Find the median activity of the clauses that may be deleted.
+    double *sorted = (double*)malloc((e->num_learnts + 1) * sizeof(double));
+    if (sorted != NULL) {
+        for (i = 0, n = 0; i < e->num_learnts; i++) {
+            if (e->learnt_length[i] > 2) {
+                sorted[n++] = e->learnt_activity[i];
+            }
+        }
+        if (n > 0) {
+            qsort(sorted, n, sizeof(double), compare_activity);
+            median = sorted[n / 2];
+        }
+        free(sorted);
+    }
+
+    // Compact the kept clauses, removing their literals that are false at level 0.
+    for (i = 0, j = 0, start = 0; i < e->num_learnts; i++) {
+        lits = e->learnt_lits + e->learnt_start[i];
+        size = e->learnt_length[i];
+        if (size > 2 && e->learnt_activity[i] < median) {
+            continue;
+        }
+        for (k = 0; k < size && literal_value(e, lits[k]) != 1; k++);
+        if (k < size) {
+            continue;
+        }
+        e->learnt_start[j] = start;
+        for (k = 0, n = 0; k < size; k++) {
+            if (literal_value(e, lits[k]) == 0) {
+                e->learnt_lits[start + n++] = lits[k];
+            }
+        }
+        e->learnt_length[j] = n;
+        e->learnt_activity[j] = e->learnt_activity[i];
+        start += n;
+        j++;
+    }
+    e->num_learnts = j;
+    e->learnt_lits_size = start;
+
+    // Rebuild the watches of the learned clauses under their new numbers.
+    for (i = 0; i < 2 * e->N; i++) {
+        for (k = 0, n = 0; k < e->watch_count[i]; k++) {
+            if (e->watches[i][k] < e->K) {
+                e->watches[i][n++] = e->watches[i][k];
+            }
+        }
+        e->watch_count[i] = n;
+    }
+    for (i = 0; i < e->num_learnts; i++) {
+        lits = e->learnt_lits + e->learnt_start[i];
+        e->watch0[e->K + i] = lits[0];
+        e->watch1[e->K + i] = lits[1];
+        watch(e, lits[0], e->K + i);
+        watch(e, lits[1], e->K + i);
+    }
+    for (i = 0; i < e->trail_size; i++) {
+        e->reason[VAR(e->trail[i])] = -1;
+    }
+}
+
+// Makes the count literals of lits the assumptions of the engine. A repeated literal is
+// removed in place, keeping the first: every assumption may open a decision level, and
+// the engine has one level per proposition. Returns the number of assumptions kept, or
+// -1 if a literal is 0 or names no proposition of the engine.
+int set_assumptions(struct engine *e, int *lits, int count)
+{
+    int i, mark;
+    int kept = 0;
+
+    for (i = 0; i < count && lits[i] != 0 && lits[i] <= e->N && lits[i] >= -e->N; i++) {
+        mark = lits[i] > 0 ? 1 : 2;
+        if (!(e->seen[VAR(lits[i])] & mark)) {
+            e->seen[VAR(lits[i])] |= mark;
+            lits[kept++] = lits[i];
+        }
+    }
+    for (int j = 0; j < kept; j++) {
+        e->seen[VAR(lits[j])] = 0;
+    }
+    if (i < count) {
+        return -1;
+    }
+    e->assumptions = lits;
+    e->num_assumptions = kept;
+
+    return kept;
+}
+
+// Conflict-driven search from the values already on the trail. The assumptions of the
+// engine are decided first, in order, one per decision level; later decisions follow the
+// decision heuristic of the engine. The assumptions must be distinct literals, as
+// set_assumptions() leaves them. Every conflict is turned into a learned clause that
+// forces a new value after backjumping. Learned clauses do not depend on the assumptions,
+// so they are kept for later searches of the engine. Returns 1 when the engine's assignment
+// is a solution, 0 if no solution exists under the assumptions and -1 if memory is
+// exhausted or the search was stopped through the engine's stop flag.
+int cdcl_search(struct engine *e)
+{
+    int c, lit, size, bt_level;
+    int restarts = 0;
+    unsigned long restart_conflicts = 0;
+
+    e->num_decisions = 0;
+    e->max_learnts = e->K / 3 > 1000 ? e->K / 3 : 1000;
+
+    while (1) {
+        c = engine_propagate(e);
+        COUNT_ADD(e->checks, 1);
+        if (c == PROPAGATE_ERROR) {
+            return -1;
+        }
+        if (c >= 0) {
+            e->conflicts++;
+            COUNT_ADD(e->pruned, 1);
+            restart_conflicts++;
+            if (e->num_decisions == 0) {
+                return 0;
+            }
+
+            // Learn the clause of the conflict and backjump where it forces its first literal.
+            size = analyze(e, c, &bt_level);
+            backjump(e, bt_level);
+            if (size == 1) {
+                engine_assign(e, e->buffer[0], -1);
+            } else {
+                c = add_learnt(e, e->buffer, size);
+                if (c < 0) {
+                    return -1;
+                }
+                engine_assign(e, e->buffer[0], c);
+            }
+            e->clause_increment /= CLAUSE_DECAY;
+            decay_variables(e);
+            continue;
+        }
+
+        // Restart when the current Luby interval is over or the database is full.
+        if (restart_conflicts >= (unsigned long)luby(restarts) * RESTART_BASE ||
+            e->num_learnts >= e->max_learnts) {
+            backjump(e, 0);
+            restarts++;
+            restart_conflicts = 0;
+            if (e->num_learnts >= e->max_learnts) {
+                reduce_learnts(e);
+                e->max_learnts += e->max_learnts / 10;
+            }
+        }
+
+        // Decide the next assumption. One that is already true gets an empty level, and
+        // one that is false cannot hold with the previous ones.
+        lit = 0;
+        while (lit == 0 && e->num_decisions < e->num_assumptions) {
+            int value = literal_value(e, e->assumptions[e->num_decisions]);
+            if (value == -1) {
+                return 0;
+            }
+            if (value == 1) {
+                e->decisions[e->num_decisions++] = e->trail_size;
+            } else {
+                lit = e->assumptions[e->num_decisions];
+            }
+        }
+
+        // A complete assignment without conflicts is a solution.
+        if (lit == 0) {
+            lit = pick_branch_literal(e);
+        }
+        if (lit == 0) {
+            return 1;
+        }
+
+        e->decisions[e->num_decisions++] = e->trail_size;
+        COUNT_ADD(e->nodes, 1);
+        COUNT_MAX(e->max_depth, e->num_decisions);
+        engine_assign(e, lit, -1);
+
+        // Let the owner of the engine stop the search.
+        if ((e->nodes & 1023) == 0 && e->stop != NULL && __atomic_load_n(e->stop, __ATOMIC_ACQUIRE)) {
+            return -1;
+        }
+    }
+}
+
+// This function implements conflict-driven clause learning from the empty assignment.
+// Returns the result of cdcl_search().
+int cdcl(struct engine *e)
+{
+    int found;
+
+    t1 = wall_clock();
+    found = cdcl_search(e);
+    t2 = wall_clock();
+
+    return found;
+}
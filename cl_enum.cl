@@ -0,0 +1,41 @@
+// -------------------------------------------------------
+// Kernel file named cl_enum.cl.
+// This Kernel evaluates complete assignments for exhaustive enumeration.
+// Assignments are numbered from 0 to 2^N - 1: proposition p is false when
+// bit N - p of the number is set, so the numbering follows the order of the
+// depth-first search. Each thread evaluates the assignment base + its ID and
+// stores its ID in found when every clause is true, keeping the smallest one.
+//
+// -------------------------------------------------------
+
+__kernel void clenum(
+__global int *Problem,
+__global int *Offsets,
+__global uint *found,
+const ulong base,
+const int K,
+const int N)
+{
+    uint idx = get_global_id(0); // The ID of the thread in execution.
+    ulong index = base + idx;    // The assignment evaluated by the thread.
+    int valid;                   // Whether the current clause is true.
+    int lit;
+    int i,j;
+
+    for(i = 0; i < K; ++i){
+        valid = 0;
+        for(j = Offsets[i]; j < Offsets[i + 1] && !valid; ++j){
+            lit = Problem[j];
+            if(lit > 0){
+                valid = ((index >> (N - lit)) & 1) == 0;
+            } else {
+                valid = ((index >> (N + lit)) & 1) == 1;
+            }
+        }
+        if(!valid){ // The clause is false, and so is the assignment.
+            return;
+        }
+    }
+
+    atomic_min(found, idx);
+}
@@ -11,31 +11,243 @@
 
 __kernel void clvalid(
 __global int *Problem,
+__global int *Offsets,
 __global int *vector,
 __global int *finish,
-__global int *partial_sums,
+__global int *count,
+__local int *local_sums,
 const int step,
-const int M)
+const int items)
 {
     int idx = get_global_id(0); // The ID of the thread in execution.
+    int lid = get_local_id(0);  // The ID of the thread in its work-group.
     int valid;                  // Count of valid propositions in each clause.
     int sum;                    // Sum of valid clauses.
     int i,j;
     int start = idx * step;
 
     sum = 0;
+    if(idx < items){ // Threads that only pad the last work-group have no clauses.
+        for(i = start; i < finish[idx]; ++i){
+            valid = 0;
+            for(j = Offsets[i]; j < Offsets[i + 1]; ++j){
+                valid+=((Problem[j] > 0) &&
+                (vector[Problem[j] - 1] >= 0)) ||
+                ((Problem[j] < 0) &&
+                (vector[-Problem[j] - 1] <= 0));
+            }
+            sum += (valid > 0); // if valid = 0, the clause is invalid.
+        }
+    }
+
+    // Reduce the sums of the work-group in local memory, then add the
+    // work-group's sum to count, so the CPU reads back a single integer.
+    local_sums[lid] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(i = get_local_size(0) / 2; i > 0; i >>= 1){
+        if(lid < i){
+            local_sums[lid] += local_sums[lid + i];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if(lid == 0){
+        atomic_add(count, local_sums[0]);
+    }
+}
+
+// -------------------------------------------------------
+// Batched version of clvalid. The work items form a 2D index space: the first
+// dimension selects a candidate vector of N values in candidates, the second one
+// a range of clauses, as in clvalid. A work item clears the flag of its candidate
+// as soon as one of its clauses is false; the host sets every flag beforehand.
+// -------------------------------------------------------
+
+__kernel void clvalid_batch(
+__global int *Problem,
+__global int *Offsets,
+__global int *candidates,
+__global int *finish,
+__global int *flags,
+const int step,
+const int N)
+{
+    int cand = get_global_id(0); // The candidate checked by the thread.
+    int idx = get_global_id(1);  // The range of clauses checked by the thread.
+    int valid;                   // Count of valid propositions in each clause.
+    int i,j;
+    int start = idx * step;
+    __global int *vector = candidates + (cand * N);
+
     for(i = start; i < finish[idx]; ++i){
         valid = 0;
-        for(j = 0; j < M; ++j){
-            valid+=((Problem[(i * M) +j] > 0) &&
-            (vector[Problem[(i * M) +j] - 1] >= 0)) ||
-            ((Problem[(i * M) + j] < 0) &&
-            (vector[-Problem[(i * M) + j] - 1] <= 0));
+        for(j = Offsets[i]; j < Offsets[i + 1]; ++j){
+            valid+=((Problem[j] > 0) &&
+            (vector[Problem[j] - 1] >= 0)) ||
+            ((Problem[j] < 0) &&
+            (vector[-Problem[j] - 1] <= 0));
+        }
+        if(valid == 0){ // The clause is invalid, and so is the candidate.
+            flags[cand] = 0;
+            return;
+        }
+    }
+}
+
+// -------------------------------------------------------
+// Coalesced version of clvalid. The clauses are read from ProblemT, a transposed
+// copy of Problem holding literal j of clause i at (j * K) + i, with literals
+// encoded in 16 bits as 2 * (p - 1) for proposition p and 2 * (p - 1) + 1 for
+// its negation. Clauses shorter than M repeat their first literal. Neighbouring
+// threads check neighbouring clauses, striding over the whole global index
+// space, so their reads fall on neighbouring addresses.
+// The work-group first copies the vector to local memory, one value per byte,
+// so literal lookups do not go to global memory.
+// -------------------------------------------------------
+
+__kernel void clvalid_coalesced(
+__global ushort *ProblemT,
+__global int *vector,
+__global int *count,
+__local int *local_sums,
+__local char *local_vector,
+const int K,
+const int M,
+const int N)
+{
+    int idx = get_global_id(0);     // The ID of the thread in execution.
+    int lid = get_local_id(0);      // The ID of the thread in its work-group.
+    int size = get_local_size(0);
+    int stride = get_global_size(0);
+    int valid;                      // Whether the current clause is true.
+    int sum;                        // Sum of valid clauses.
+    int i,j;
+    ushort lit;
+    char value;
+
+    // Cache the vector in local memory.
+    for(i = lid; i < N; i += size){
+        local_vector[i] = (char)vector[i];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    sum = 0;
+    for(i = idx; i < K; i += stride){
+        valid = 0;
+        for(j = 0; j < M && !valid; ++j){
+            lit = ProblemT[(j * K) + i];
+            value = local_vector[lit >> 1];
+            valid = (value == 0) || ((value > 0) != (lit & 1));
         }
-        sum += (valid > 0); // if valid = 0, the clause is invalid.
+        sum += valid;
     }
 
-    // Write the local sum to global memory, so the CPU can reduce the table
-    // partial_sums, which has size the number of threads.
-    partial_sums[idx] = sum;
+    // Reduce the sums of the work-group in local memory, then add the
+    // work-group's sum to count, so the CPU reads back a single integer.
+    local_sums[lid] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(i = size / 2; i > 0; i >>= 1){
+        if(lid < i){
+            local_sums[lid] += local_sums[lid + i];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if(lid == 0){
+        atomic_add(count, local_sums[0]);
+    }
+}
+
+// -------------------------------------------------------
+// Coalesced version of clvalid_batch, over ProblemT as in clvalid_coalesced.
+// The second dimension selects the candidate, and every work-group checks a
+// single one: it copies the candidate to local memory, then its threads check
+// neighbouring clauses, striding over the first dimension of the index space.
+// A thread clears the flag of the candidate as soon as one of its clauses is
+// false, and stops when another thread of the candidate has done so.
+// -------------------------------------------------------
+
+__kernel void clvalid_batch_coalesced(
+__global ushort *ProblemT,
+__global int *candidates,
+__global int *flags,
+__local char *local_vector,
+const int K,
+const int M,
+const int N)
+{
+    int cand = get_global_id(1);    // The candidate checked by the thread.
+    int lid = get_local_id(0);      // The ID of the thread in its work-group.
+    int size = get_local_size(0);
+    int stride = get_global_size(0);
+    int valid;                      // Whether the current clause is true.
+    int i,j;
+    ushort lit;
+    char value;
+    __global int *vector = candidates + (cand * N);
+
+    // Cache the candidate in local memory.
+    for(i = lid; i < N; i += size){
+        local_vector[i] = (char)vector[i];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    for(i = get_global_id(0); i < K && flags[cand]; i += stride){
+        valid = 0;
+        for(j = 0; j < M && !valid; ++j){
+            lit = ProblemT[(j * K) + i];
+            value = local_vector[lit >> 1];
+            valid = (value == 0) || ((value > 0) != (lit & 1));
+        }
+        if(!valid){ // The clause is invalid, and so is the candidate.
+            flags[cand] = 0;
+            return;
+        }
+    }
+}
+
+// -------------------------------------------------------
+// Incremental version of clvalid. After a literal was made false, only the
+// clauses holding it can have become false: the host passes the position and
+// length of its list in Occurrences, the clauses holding each literal back to
+// back, and every thread checks one clause of the list. Count receives the
+// number of valid clauses of the list.
+// -------------------------------------------------------
+
+__kernel void clvalid_occ(
+__global int *Problem,
+__global int *Offsets,
+__global int *Occurrences,
+__global int *vector,
+__global int *count,
+__local int *local_sums,
+const int start,
+const int items)
+{
+    int idx = get_global_id(0); // The ID of the thread in execution.
+    int lid = get_local_id(0);  // The ID of the thread in its work-group.
+    int valid;                  // Count of valid propositions in the clause.
+    int i,j;
+
+    valid = 0;
+    if(idx < items){ // Threads that only pad the last work-group have no clause.
+        i = Occurrences[start + idx];
+        for(j = Offsets[i]; j < Offsets[i + 1] && !valid; ++j){
+            valid = ((Problem[j] > 0) &&
+            (vector[Problem[j] - 1] >= 0)) ||
+            ((Problem[j] < 0) &&
+            (vector[-Problem[j] - 1] <= 0));
+        }
+    }
+
+    // Reduce the valid clauses of the work-group in local memory.
+    local_sums[lid] = valid;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for(i = get_local_size(0) / 2; i > 0; i >>= 1){
+        if(lid < i){
+            local_sums[lid] += local_sums[lid + i];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if(lid == 0){
+        atomic_add(count, local_sums[0]);
+    }
 }
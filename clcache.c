@@ -0,0 +1,264 @@
+// -----------------------------------------------------------------------
+//
+// OpenCL program binary cache. Building the kernels from source can take
+// longer than solving a small problem, so the binaries of a program built
+// for a device are saved to a file named after a checksum of the device
+// name, the driver version, the build options and the kernel source.
+// Later runs on the same device and driver load the binaries instead of
+// compiling the source, and fall back to the source whenever a binary is
+// missing, stale or refused by the runtime. The files go to the user's
+// cache directory, never to the directory the program runs in, unless
+// another directory is given.
+//
+// -----------------------------------------------------------------------
+
+#include <errno.h>
+
+#define PROGRAM_CACHE_SUFFIX ".clbin"
+#define PROGRAM_CACHE_MAGIC "CLBIN\0\0\1"
+
+int use_program_cache = 1;      // If set, program binaries are loaded from and saved to the cache.
+char *program_cache_dir;        // Directory of the program cache files, NULL until chosen.
+char program_cache_default[1024]; // Default directory: $XDG_CACHE_HOME/sat_GPU or ~/.cache/sat_GPU.
+unsigned long program_cache_hits;   // Programs loaded from their binaries.
+unsigned long program_cache_misses; // Programs built from source while the cache was in use.
+
+// Program cache file header, followed by the key and the binary.
+struct program_cache_header {
+    char magic[8];          // PROGRAM_CACHE_MAGIC, with the format version in the last byte.
+    int64_t key_size;       // Size of the key, which names the device, driver, options and source.
+    int64_t binary_size;    // Size of the program binary.
+};
+
+// Chooses the directory of the program cache, unless one was given: sat_GPU under
+// $XDG_CACHE_HOME, or under ~/.cache, created if missing. Turns the cache off when there is
+// no such directory. Returns 1 if the cache is in use, and 0 otherwise.
+int program_cache_ready()
+{
+    char *base = getenv("XDG_CACHE_HOME");
+    char *home = getenv("HOME");
+    char *dir = program_cache_default;
+    int size = sizeof(program_cache_default);
+    int ok;
+
+    if (!use_program_cache || program_cache_dir != NULL) {
+        return use_program_cache;
+    }
+    if (base != NULL && base[0] == '/') {
+        ok = snprintf(dir, size, "%s", base) < size;
+    } else if (home != NULL && home[0] == '/') {
+        ok = snprintf(dir, size, "%s/.cache", home) < size;
+    } else {
+        ok = 0;
+    }
+    // The cache directory itself may not exist yet.
+    ok = ok && (mkdir(dir, 0700) == 0 || errno == EEXIST) && strlen(dir) + sizeof("/sat_GPU") <= (size_t)size;
+    if (ok) {
+        strcat(dir, "/sat_GPU");
+        ok = mkdir(dir, 0700) == 0 || errno == EEXIST;
+    }
+    if (!ok) {
+        use_program_cache = 0;
+        return 0;
+    }
+    program_cache_dir = dir;
+
+    return 1;
+}
+
+// Writes the key of a program for a device into key: device name, driver version, build
+// options and checksum of the source, separated by newlines. Returns the key size, or -1.
+int program_key(cl_device_id device, const char *options, const char *source, char *key, int size)
+{
+    char name[256], driver[256];
+
+    if (clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, NULL) != CL_SUCCESS ||
+        clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driver), driver, NULL) != CL_SUCCESS) {
+        return -1;
+    }
+    name[sizeof(name) - 1] = '\0';
+    driver[sizeof(driver) - 1] = '\0';
+
+    int length = snprintf(key, size, "%s\n%s\n%s\n%016llx\n", name, driver, options,
+                          (unsigned long long)checksum((char*)source, strlen(source)));
+
+    return length < size ? length : -1;
+}
+
+// Writes the name of the cache file of a program key into path: <dir>/<source>.<checksum>.clbin.
+void program_cache_name(const char *sourceFile, const char *key, int key_size, char *path, int size)
+{
+    const char *base = strrchr(sourceFile, '/');
+
+    snprintf(path, size, "%s/%s.%016llx%s", program_cache_dir, base != NULL ? base + 1 : sourceFile,
+             (unsigned long long)checksum((char*)key, key_size), PROGRAM_CACHE_SUFFIX);
+}
+
+// Reads the binary of a program for a device from its cache file, if the file holds the same
+// key. Returns the binary, to be freed, and stores its size, or returns NULL.
+unsigned char *read_program_binary(const char *sourceFile, const char *options, const char *source,
+                                   cl_device_id device, size_t *binary_size)
+{
+    char key[1024], path[1024];
+    struct program_cache_header h;
+    unsigned char *binary;
+    char *stored;
+    FILE *fp;
+
+    int key_size = program_key(device, options, source, key, sizeof(key));
+    if (key_size < 0) {
+        return NULL;
+    }
+    program_cache_name(sourceFile, key, key_size, path, sizeof(path));
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    if (fread(&h, sizeof(h), 1, fp) != 1 || memcmp(h.magic, PROGRAM_CACHE_MAGIC, 8) != 0 ||
+        h.key_size != key_size || h.binary_size <= 0) {
+        fclose(fp);
+        return NULL;
+    }
+
+    // The key is compared in full, in case two keys share a checksum.
+    stored = (char*)malloc(key_size);
+    binary = (unsigned char*)malloc(h.binary_size);
+    if (stored == NULL || binary == NULL ||
+        fread(stored, 1, key_size, fp) != (size_t)key_size || memcmp(stored, key, key_size) != 0 ||
+        fread(binary, 1, h.binary_size, fp) != (size_t)h.binary_size) {
+        free(stored);
+        free(binary);
+        fclose(fp);
+        return NULL;
+    }
+    free(stored);
+    fclose(fp);
+    *binary_size = h.binary_size;
+
+    return binary;
+}
+
+// Writes the binary of a program for a device to its cache file, through a temporary file
+// renamed into place so that a concurrent run never reads a partial binary. Failing to
+// write the cache is not an error: the next run builds from source again.
+void write_program_binary(const char *sourceFile, const char *options, const char *source,
+                          cl_device_id device, unsigned char *binary, size_t binary_size)
+{
+    char key[1024], path[1024], tmpname[1100];
+    struct program_cache_header h;
+    FILE *fp;
+    int ok;
+
+    int key_size = program_key(device, options, source, key, sizeof(key));
+    if (key_size < 0) {
+        return;
+    }
+    program_cache_name(sourceFile, key, key_size, path, sizeof(path));
+    snprintf(tmpname, sizeof(tmpname), "%s.%d", path, (int)getpid());
+    fp = fopen(tmpname, "wb");
+    if (fp == NULL) {
+        return;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PROGRAM_CACHE_MAGIC, 8);
+    h.key_size = key_size;
+    h.binary_size = binary_size;
+    ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+         fwrite(key, 1, key_size, fp) == (size_t)key_size &&
+         fwrite(binary, 1, binary_size, fp) == binary_size;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmpname, path) != 0) {
+        unlink(tmpname);
+    }
+}
+
+// Creates and builds a program for the devices of a context from the cached binaries.
+// Returns the program, or NULL if a device has no usable binary, so that the caller
+// builds from source.
+cl_program load_program_binaries(cl_context context, const char *sourceFile, const char *options,
+                                 const char *source, cl_uint numDevices, cl_device_id *devices)
+{
+    unsigned char **binaries;
+    size_t *sizes;
+    cl_program program = NULL;
+    cl_int err;
+    cl_uint i;
+
+    binaries = (unsigned char**)calloc(numDevices, sizeof(unsigned char*));
+    sizes = (size_t*)calloc(numDevices, sizeof(size_t));
+    if (binaries == NULL || sizes == NULL) {
+        free(binaries);
+        free(sizes);
+        return NULL;
+    }
+    for (i = 0; i < numDevices; i++) {
+        binaries[i] = read_program_binary(sourceFile, options, source, devices[i], &sizes[i]);
+        if (binaries[i] == NULL) {
+            break;
+        }
+    }
+
+    if (i == numDevices) {
+        program = clCreateProgramWithBinary(context, numDevices, devices, sizes,
+                                            (const unsigned char**)binaries, NULL, &err);
+        if (err != CL_SUCCESS) {
+            program = NULL;
+        } else if (clBuildProgram(program, numDevices, devices, options, NULL, NULL) != CL_SUCCESS) {
+            clReleaseProgram(program);
+            program = NULL;
+        }
+    }
+
+    for (i = 0; i < numDevices; i++) {
+        free(binaries[i]);
+    }
+    free(binaries);
+    free(sizes);
+
+    return program;
+}
+
+// Saves the binaries of a program built from source, one cache file per device. The
+// binaries come in the order of the program's devices, which are those of the context.
+void save_program_binaries(cl_program program, const char *sourceFile, const char *options,
+                           const char *source, cl_uint numDevices, cl_device_id *devices)
+{
+    cl_uint count;
+    cl_device_id *ids;
+    unsigned char **binaries;
+    size_t *sizes;
+    cl_uint i;
+    int ok;
+
+    if (clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint), &count, NULL) != CL_SUCCESS ||
+        count != numDevices) {
+        return;
+    }
+    ids = (cl_device_id*)malloc(count * sizeof(cl_device_id));
+    sizes = (size_t*)calloc(count, sizeof(size_t));
+    binaries = (unsigned char**)calloc(count, sizeof(unsigned char*));
+    ok = ids != NULL && sizes != NULL && binaries != NULL &&
+         clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, count * sizeof(size_t), sizes, NULL) == CL_SUCCESS;
+
+    // Runtimes that cannot list the program's devices list those given to the build.
+    if (ok && clGetProgramInfo(program, CL_PROGRAM_DEVICES, count * sizeof(cl_device_id), ids, NULL) != CL_SUCCESS) {
+        memcpy(ids, devices, count * sizeof(cl_device_id));
+    }
+    for (i = 0; ok && i < count; i++) {
+        binaries[i] = sizes[i] > 0 ? (unsigned char*)malloc(sizes[i]) : NULL;
+        ok = binaries[i] != NULL;
+    }
+    if (ok && clGetProgramInfo(program, CL_PROGRAM_BINARIES, count * sizeof(unsigned char*), binaries, NULL) == CL_SUCCESS) {
+        for (i = 0; i < count; i++) {
+            write_program_binary(sourceFile, options, source, ids[i], binaries[i], sizes[i]);
+        }
+    }
+
+    for (i = 0; binaries != NULL && i < count; i++) {
+        free(binaries[i]);
+    }
+    free(binaries);
+    free(sizes);
+    free(ids);
+}
@@ -0,0 +1,144 @@
+// -----------------------------------------------------------------------
+//
+// Conquer phase of cube-and-conquer on a pool of threads. Every thread owns
+// a clause learning engine and takes the next cube not yet searched; the
+// cube becomes the assumptions of the engine, so the clauses learned on one
+// cube keep pruning the following ones of the same thread. The first thread
+// to find a solution stops all the others; the problem has no solution when
+// no cube has one.
+//
+// -----------------------------------------------------------------------
+
+// Conquer worker structure.
+struct conquer_worker {
+    int id;                 // Index of the worker.
+    pthread_t thread;       // Thread running the worker.
+    struct engine e;        // Clause learning engine of the worker.
+    unsigned long cubes_done; // Number of cubes searched by the worker.
+    int error;              // Set if the worker ran out of memory.
+};
+
+struct conquer_worker *conquer_workers; // The worker threads.
+int next_cube;              // Next cube to hand out.
+int cube_solved;            // Set by the first worker that finds a solution. Always accessed atomically.
+int *conquer_solution;      // The solution found.
+
+// Thread function of a worker: searches cubes until none is left or a solution is found.
+void *conquer_run(void *arg)
+{
+    struct conquer_worker *w = (struct conquer_worker*)arg;
+    struct engine *e = &w->e;
+    struct timespec start, end;
+    int i, found;
+
+    while (!__atomic_load_n(&cube_solved, __ATOMIC_ACQUIRE)) {
+        i = __atomic_fetch_add(&next_cube, 1, __ATOMIC_SEQ_CST);
+        if (i >= num_cubes) {
+            break;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        backjump(e, 0);
+        e->assumptions = cube_lits + cube_offsets[i];
+        e->num_assumptions = cube_offsets[i + 1] - cube_offsets[i];
+        found = cdcl_search(e);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if (found < 0) {
+            w->error = !__atomic_load_n(&cube_solved, __ATOMIC_ACQUIRE);
+            break;
+        }
+        cube_result[i] = found;
+        cube_time[i] = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        w->cubes_done++;
+        if (found == 1 && !__atomic_exchange_n(&cube_solved, 1, __ATOMIC_SEQ_CST)) {
+            memcpy(conquer_solution, e->assignment, e->N * sizeof(int));
+        }
+    }
+
+    return NULL;
+}
+
+// Cube-and-conquer: splits a problem into cubes with the lookahead cuber, writes them to
+// cube_file when it is not NULL, and searches them on the given number of threads.
+// Returns 1 and stores the solution in vector, 0 if no solution exists and -1 on error.
+int cube_and_conquer(struct problem *p, int threads, char *cube_file, int *vector)
+{
+    int i, error = 0;
+    struct timespec start, cubed, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    t1 = wall_clock();
+
+    if (make_cubes(p) < 0 || (cube_file != NULL && write_cubes(p, cube_file) < 0) || cube_results_init() < 0) {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &cubed);
+
+    next_cube = 0;
+    cube_solved = 0;
+    conquer_solution = vector;
+    conquer_workers = (struct conquer_worker*)calloc(threads, sizeof(struct conquer_worker));
+    if (conquer_workers == NULL) {
+        report("Error: malloc for workers failed.\n");
+        return -1;
+    }
+    for (i = 0; i < threads; i++) {
+        struct conquer_worker *w = &conquer_workers[i];
+        w->id = i;
+        if (engine_init(&w->e, p) < 0 || heuristic_init(&w->e, HEURISTIC_VSIDS, 1) < 0) {
+            return -1;
+        }
+        w->e.stop = &cube_solved;
+        stats_track(&w->e);
+    }
+
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&conquer_workers[i].thread, NULL, conquer_run, &conquer_workers[i]) != 0) {
+            report("Error: pthread_create failed.\n");
+            return -1;
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(conquer_workers[i].thread, NULL);
+    }
+
+    t2 = wall_clock();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Report the cubes, how long each took, and how the work was spread over the workers.
+    double lookahead_time = (cubed.tv_sec - start.tv_sec) + (cubed.tv_nsec - start.tv_nsec) / 1e9;
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    unsigned long nodes = 0;
+    report("\nCube and conquer on %d threads, %d cubes:\n", threads, num_cubes);
+    report("    Lookahead: %0.3f secs, %lu failed literals, %lu cubes refuted\n", lookahead_time, cube_failed, cube_refuted);
+    if (cube_file != NULL) {
+        report("    Cubes written to %s\n", cube_file);
+    }
+    report_cubes();
+    for (i = 0; i < threads; i++) {
+        struct conquer_worker *w = &conquer_workers[i];
+        report("    Thread %d: %lu nodes, %lu cubes searched\n", i, w->e.nodes, w->cubes_done);
+        nodes += w->e.nodes;
+        engine_add_counts(&engine, &w->e);
+        error |= w->error;
+    }
+    report("    Wall time: %0.3f secs\n", wall);
+    engine.nodes = nodes;
+
+    for (i = 0; i < threads; i++) {
+        stats_untrack(&conquer_workers[i].e);
+        engine_free(&conquer_workers[i].e);
+    }
+    free(conquer_workers);
+    free(cube_result);
+    free(cube_time);
+    free(cube_lits);
+    free(cube_offsets);
+
+    if (error) {
+        return -1;
+    }
+
+    return __atomic_load_n(&cube_solved, __ATOMIC_ACQUIRE);
+}
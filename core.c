@@ -1,136 +1,554 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <time.h>
 #include <math.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/socket.h>
 
-// Execution parameters
-int N;          // Number of propositions.
-int K;          // Number of clauses.
-int M;          // Number of propositions per clause.
-int *Problem;   // This is a table to keep all the clauses of the problem.
-clock_t t1, t2; // CPU timers.
-int mem_error;  // Constant for errors while allocating memory. If mem_error -1 programm exhausted all available memory and terminates.
-
-// Frontier's node structure.
-struct frontier_node {
-    int *vector;                    // Node's vector.
-    struct frontier_node *previous; // Pointer to the previous frontier node.
-    struct frontier_node *next;     // Pointer to the next frontier node.
+// A problem and the storage of its clauses. Several problems can be loaded at once:
+// every module works on the problem it is given, or on the one of its engine.
+struct problem {
+    int N;              // Number of propositions.
+    int K;              // Number of clauses.
+    int M;              // Largest number of propositions in a clause.
+    int *Problem;       // The clauses, back to back.
+    int *Offsets;       // Position in Problem of each clause, and of the end of the last one in Offsets[K].
+    char *cache_data;   // Mapping of the cache file Offsets and Problem point into, or NULL.
+    size_t cache_size;  // Size of the mapping of the cache file.
+    int *occ_offsets;   // Occurrence lists built by occurrences_init(), or NULL.
+    int *occ_clauses;   // Clauses of the occurrence lists, back to back.
 };
 
-struct frontier_node *head = NULL;  // The one end of the frontier.
-struct frontier_node *tail = NULL;  // The other end of the frontier.
+// Execution parameters.
+double t1, t2;  // Wall-clock timers of the search, in seconds.
+int use_cache = 1;  // If set, problems are loaded from and saved to a binary cache file.
+struct problem input; // The problem read by readfile(), or left by preprocessing.
+int quiet;      // If set, report() prints nothing: the library and the many-instance mode answer through results only.
 
-// Reading the input file.
-int readfile(char *filename)
+// Binary problem cache. The file <inputfile>.satbin holds a header followed by
+// Offsets (K + 1 entries) and Problem (Offsets[K] entries), in the machine's
+// byte order, so that later runs map it and point Offsets and Problem into it.
+#define CACHE_SUFFIX ".satbin"
+#define CACHE_MAGIC "SATBIN\0\1"
+
+// Binary problem cache header.
+struct cache_header {
+    char magic[8];          // CACHE_MAGIC, with the format version in the last byte.
+    int N;                  // Number of propositions.
+    int K;                  // Number of clauses.
+    int M;                  // Largest number of propositions in a clause.
+    int width;              // Bytes per literal and per offset.
+    int64_t source_size;    // Size of the input file the cache was built from.
+    uint64_t checksum;      // Checksum of the input file the cache was built from.
+};
+
+// Returns the time of the monotonic clock, in seconds. Unlike clock(), which sums the CPU
+// time of every thread, it measures the wall time of the search.
+double wall_clock(void)
 {
-    int i, j;
-    FILE *infile;
-    int err;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-    // Opening the input file.
-    infile = fopen(filename, "r");
-    if (infile == NULL) {
-        printf("Cannot open input file. Program terminates.\n");
-        return -1;
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
+}
+
+// Prints a message of the modules, like printf(), unless they are quiet.
+void report(const char *format, ...)
+{
+    va_list args;
+
+    if (quiet) {
+        return;
+    }
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+// Writes size bytes to a socket. Returns 0, or -1 on error.
+int write_all(int fd, void *buf, size_t size)
+{
+    char *p = (char*)buf;
+
+    while (size > 0) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+// Reads size bytes from a socket. Returns 0, or -1 on error or end of stream.
+int read_all(int fd, void *buf, size_t size)
+{
+    char *p = (char*)buf;
+
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+// Skips blanks and, if comments is set, DIMACS comment lines starting with 'c'.
+// Returns the position of the next token, or end if there is none.
+char *skip_blanks(char *pos, char *end, int comments)
+{
+    while (pos < end) {
+        if (*pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r') {
+            pos++;
+        } else if (comments && *pos == 'c') {
+            while (pos < end && *pos != '\n') {
+                pos++;
+            }
+        } else {
+            break;
+        }
+    }
+
+    return pos;
+}
+
+// Reads an integer at the position of a token, without the overhead of fscanf.
+// Returns the position after it, or NULL if the token is not an integer.
+char *scan_int(char *pos, char *end, int *value)
+{
+    int negative = 0;
+    int digits = 0;
+    long v = 0;
+
+    if (pos < end && (*pos == '-' || *pos == '+')) {
+        negative = (*pos == '-');
+        pos++;
+    }
+    while (pos < end && *pos >= '0' && *pos <= '9') {
+        v = (v * 10) + (*pos - '0');
+        pos++;
+        if (++digits > 10) {
+            return NULL;
+        }
+    }
+    if (digits == 0 || v > 2147483647L || (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\n' && *pos != '\r')) {
+        return NULL;
+    }
+    *value = negative ? (int)-v : (int)v;
+
+    return pos;
+}
+
+// Appends a literal to the clauses of a problem, growing them as needed.
+int add_literal(struct problem *p, int lit, int *capacity)
+{
+    if (p->Offsets[p->K] == *capacity) {
+        *capacity *= 2;
+        int *grown = (int*)realloc(p->Problem, *capacity * sizeof(int));
+        if (grown == NULL) {
+            report("Error: realloc for Problem failed.\n");
+            return -1;
+        }
+        p->Problem = grown;
+    }
+    p->Problem[p->Offsets[p->K]++] = lit;
+
+    return 0;
+}
+
+// Parses a problem from text. Both the DIMACS CNF format ("p cnf <propositions> <clauses>"
+// followed by clauses ending with 0, and comment lines starting with 'c') and the
+// original format (number of propositions, of clauses and of propositions per clause,
+// followed by the clauses) are accepted, in a single pass, into p. A DIMACS problem with an
+// empty clause has no solution, and is read as the contradiction (1) and (-1), which every
+// search refutes at once. If rest is not NULL, it receives the position after the last
+// clause. Returns 0, or -1 on error.
+int parse_problem(struct problem *p, char *data, char *end, char **rest)
+{
+    int i, lit, capacity, dimacs, empty = 0;
+    char *pos;
+
+    memset(p, 0, sizeof(struct problem));
+
+    // A DIMACS file starts with comments or its problem line.
+    pos = skip_blanks(data, end, 1);
+    dimacs = (pos < end && *pos == 'p');
+    if (dimacs) {
+        if (end - pos < 5 || strncmp(pos, "p cnf", 5) != 0) {
+            report("Cannot read the DIMACS problem line. Program terminates.\n");
+            return -1;
+        }
+        pos = skip_blanks(pos + 5, end, 0);
     }
 
     // Reading the number of propositions.
-    err = fscanf(infile, "%d", &N);
-    if (err < 1) {
-        printf("Cannot read the number of propositions. Program terminates.\n");
-        fclose(infile);
+    pos = scan_int(pos, end, &p->N);
+    if (pos == NULL) {
+        report("Cannot read the number of propositions. Program terminates.\n");
         return -1;
     }
 
-    if (N < 1) {
-        printf("Small number of propositions. Program terminates.\n");
-        fclose(infile);
+    if (p->N < 1) {
+        report("Small number of propositions. Program terminates.\n");
         return -1;
     }
 
     // Reading the number of clauses.
-    err = fscanf(infile, "%d", &K);
-    if (err<1) {
-        printf("Cannot read the number of clauses. Program terminates.\n");
-        fclose(infile);
+    pos = scan_int(skip_blanks(pos, end, 0), end, &p->K);
+    if (pos == NULL) {
+        report("Cannot read the number of clauses. Program terminates.\n");
         return -1;
     }
 
-    if (K < 1) {
-        printf("Low number of clauses. Program terminates.\n");
-        fclose(infile);
+    if (p->K < 1) {
+        report("Low number of clauses. Program terminates.\n");
         return -1;
     }
 
-    // Reading the number of propositions per clause.
-    err = fscanf(infile, "%d", &M);
-    if (err < 1) {
-        printf("Cannot read the number of propositions per clause. Program terminates.\n");
-        fclose(infile);
-        return -1;
-    }
+    // Reading the number of propositions per clause, which DIMACS files do not have.
+    p->M = 0;
+    if (!dimacs) {
+        pos = scan_int(skip_blanks(pos, end, 0), end, &p->M);
+        if (pos == NULL) {
+            report("Cannot read the number of propositions per clause. Program terminates.\n");
+            return -1;
+        }
 
-    if (M < 2) {
-        printf("Low number of propositions per clause. Program terminates.\n");
-        fclose(infile);
-        return -1;
+        if (p->M < 1) {
+            report("Low number of propositions per clause. Program terminates.\n");
+            return -1;
+        }
     }
 
     // Allocating memory for the clauses...
-    Problem = (int*)malloc(K * M * sizeof(int));
-    if (Problem == NULL) {
-        printf("Error: malloc for Problem failed.\n");
+    capacity = dimacs ? 4 * p->K : p->K * p->M;
+    p->Problem = (int*)malloc(capacity * sizeof(int));
+    p->Offsets = (int*)malloc((p->K + 1) * sizeof(int));
+    if (p->Problem == NULL || p->Offsets == NULL) {
+        report("Error: malloc for Problem failed.\n");
         return -1;
     }
 
-    // ...and read them
-    for (i = 0; i < K; i++) {
-        for (j = 0; j < M; j++) {
-            err = fscanf(infile, "%d", Problem + (i * M) + j);
-            if (err < 1) {
-                printf("Cannot read the #%d proposition of the #%d clause. Program terminates.\n", j + 1, i + 1);
-                fclose(infile);
+    // ...and read them. Offsets[K] counts the literals read so far.
+    p->Offsets[0] = 0;
+    p->Offsets[p->K] = 0;
+    for (i = 0; i < p->K; i++) {
+        p->Offsets[i] = p->Offsets[p->K];
+        while (dimacs || p->Offsets[p->K] - p->Offsets[i] < p->M) {
+            pos = skip_blanks(pos, end, dimacs);
+            if (dimacs && pos < end && *pos == '%') { // End marker of some DIMACS benchmark files.
+                pos = end;
+            }
+            if (pos == end || (pos = scan_int(pos, end, &lit)) == NULL) {
+                report("Cannot read the #%d proposition of the #%d clause. Program terminates.\n", p->Offsets[p->K] - p->Offsets[i] + 1, i + 1);
                 return -1;
             }
-            if (Problem[i*M + j] == 0 || Problem[(i * M) + j] > N || Problem[(i * M) + j] < -N) {
-                printf("Wrong value for the #%d proposition of the #%d clause. Program terminates.\n", j + 1, i + 1);
-                fclose(infile);
+            if (dimacs && lit == 0) {
+                break;
+            }
+            if (lit == 0 || lit > p->N || lit < -p->N) {
+                report("Wrong value for the #%d proposition of the #%d clause. Program terminates.\n", p->Offsets[p->K] - p->Offsets[i] + 1, i + 1);
                 return -1;
             }
+            if (add_literal(p, lit, &capacity) < 0) {
+                return -1;
+            }
+        }
+        if (p->Offsets[p->K] == p->Offsets[i]) {
+            empty = 1;
+        }
+        if (p->Offsets[p->K] - p->Offsets[i] > p->M) {
+            p->M = p->Offsets[p->K] - p->Offsets[i];
         }
     }
+    if (rest != NULL) {
+        *rest = pos;
+    }
 
-    fclose(infile);
+    // Only a DIMACS clause can be empty, so Problem has room for 4 literals.
+    if (empty) {
+        int *grown = (int*)realloc(p->Offsets, 3 * sizeof(int));
+        if (grown == NULL) {
+            report("Error: realloc for Offsets failed.\n");
+            return -1;
+        }
+        p->Offsets = grown;
+        p->K = 2;
+        p->M = 1;
+        p->Offsets[0] = 0;
+        p->Offsets[1] = 1;
+        p->Offsets[2] = 2;
+        p->Problem[0] = 1;
+        p->Problem[1] = -1;
+    }
 
     return 0;
 }
 
-// Auxiliary function that displays all the clauses of the problem.
-void display_problem()
+// Checksum of the input file, 64 bits at a time with a multiplicative hash.
+uint64_t checksum(char *data, size_t size)
+{
+    uint64_t h = 14695981039346656037ULL;
+    uint64_t word;
+    size_t i;
+
+    for (i = 0; i + 8 <= size; i += 8) {
+        memcpy(&word, data + i, 8);
+        h = (h ^ word) * 1099511628211ULL;
+        h ^= h >> 29;
+    }
+    for (; i < size; i++) {
+        h = (h ^ (unsigned char)data[i]) * 1099511628211ULL;
+    }
+
+    return h;
+}
+
+// Maps the cache file and points the Offsets and Problem of p into it, if it was built
+// from an input file of the given size and checksum. The mapping stays until the problem
+// is freed. Returns 0, or -1 if there is no usable cache.
+int load_cache(struct problem *p, char *cachename, int64_t size, uint64_t sum)
+{
+    int fd;
+    struct stat st;
+    struct cache_header *h;
+    char *data;
+    size_t expected;
+
+    fd = open(cachename, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(struct cache_header)) {
+        close(fd);
+        return -1;
+    }
+    data = (char*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+
+    h = (struct cache_header*)data;
+    if (memcmp(h->magic, CACHE_MAGIC, 8) != 0 || h->width != sizeof(int) ||
+        h->source_size != size || h->checksum != sum || h->N < 1 || h->K < 1) {
+        munmap(data, st.st_size);
+        return -1;
+    }
+    p->Offsets = (int*)(data + sizeof(struct cache_header));
+    expected = sizeof(struct cache_header) + (h->K + 1) * sizeof(int);
+    if ((size_t)st.st_size < expected || p->Offsets[h->K] < 0 ||
+        (size_t)st.st_size != expected + p->Offsets[h->K] * sizeof(int)) {
+        munmap(data, st.st_size);
+        return -1;
+    }
+    p->N = h->N;
+    p->K = h->K;
+    p->M = h->M;
+    p->Problem = p->Offsets + (p->K + 1);
+    p->cache_data = data;
+    p->cache_size = st.st_size;
+
+    return 0;
+}
+
+// Writes the Offsets and Problem of p to the cache file, through a temporary file renamed
+// into place so that a concurrent run never maps a partial cache. Failing to write
+// the cache is not an error: the next run parses the input file again.
+void save_cache(struct problem *p, char *cachename, int64_t size, uint64_t sum)
+{
+    struct cache_header h;
+    char *tmpname;
+    FILE *fp;
+    int ok;
+
+    tmpname = (char*)malloc(strlen(cachename) + 16);
+    if (tmpname == NULL) {
+        return;
+    }
+    sprintf(tmpname, "%s.%d", cachename, (int)getpid());
+    fp = fopen(tmpname, "wb");
+    if (fp == NULL) {
+        free(tmpname);
+        return;
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CACHE_MAGIC, 8);
+    h.N = p->N;
+    h.K = p->K;
+    h.M = p->M;
+    h.width = sizeof(int);
+    h.source_size = size;
+    h.checksum = sum;
+    ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+         fwrite(p->Offsets, sizeof(int), p->K + 1, fp) == (size_t)(p->K + 1) &&
+         fwrite(p->Problem, sizeof(int), p->Offsets[p->K], fp) == (size_t)p->Offsets[p->K];
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmpname, cachename) != 0) {
+        unlink(tmpname);
+    }
+    free(tmpname);
+}
+
+// Releases the clauses of a problem, or the cache mapping they point into, and its
+// occurrence lists.
+void problem_free(struct problem *p)
+{
+    if (p->cache_data != NULL) {
+        munmap(p->cache_data, p->cache_size);
+    } else {
+        free(p->Problem);
+        free(p->Offsets);
+    }
+    free(p->occ_offsets);
+    free(p->occ_clauses);
+    memset(p, 0, sizeof(struct problem));
+}
+
+// Returns 1 if values, 1 true and -1 false for each proposition of p, make every clause of
+// p true, and 0 otherwise.
+int problem_satisfied(struct problem *p, int *values)
+{
+    int i, j;
+
+    for (i = 0; i < p->K; i++) {
+        for (j = p->Offsets[i]; j < p->Offsets[i + 1]; j++) {
+            if (values[abs(p->Problem[j]) - 1] == (p->Problem[j] > 0 ? 1 : -1)) {
+                break;
+            }
+        }
+        if (j == p->Offsets[i + 1]) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Reads a problem from an input file into p. The file is mapped in memory; if cache is set
+// and the binary cache next to it was built from the same contents, the problem is mapped
+// from the cache without parsing, otherwise it is parsed and, if cache is set, the cache is
+// written for the next run. Clauses beyond the number given by the file are an error,
+// rather than being dropped. Returns 0, or -1 on error.
+int problem_read(struct problem *p, char *filename, int cache)
+{
+    int fd, err;
+    struct stat st;
+    char *data, *cachename, *rest;
+    uint64_t sum = 0;
+
+    memset(p, 0, sizeof(struct problem));
+
+    // Opening and mapping the input file.
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        report("Cannot open input file. Program terminates.\n");
+        return -1;
+    }
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        report("Cannot read the number of propositions. Program terminates.\n");
+        close(fd);
+        return -1;
+    }
+    data = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        report("Cannot map input file. Program terminates.\n");
+        return -1;
+    }
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    cachename = NULL;
+    if (cache) {
+        cachename = (char*)malloc(strlen(filename) + strlen(CACHE_SUFFIX) + 1);
+        if (cachename != NULL) {
+            sprintf(cachename, "%s%s", filename, CACHE_SUFFIX);
+            sum = checksum(data, st.st_size);
+            if (load_cache(p, cachename, st.st_size, sum) == 0) {
+                munmap(data, st.st_size);
+                free(cachename);
+                return 0;
+            }
+        }
+    }
+
+    err = parse_problem(p, data, data + st.st_size, &rest);
+    if (err == 0) {
+        // The end marker of some DIMACS benchmark files, and what follows it, are ignored.
+        rest = skip_blanks(rest, data + st.st_size, 1);
+        if (rest < data + st.st_size && *rest != '%') {
+            report("Data after the last clause of the problem. Program terminates.\n");
+            err = -1;
+        }
+    }
+    if (err == 0 && cachename != NULL) {
+        save_cache(p, cachename, st.st_size, sum);
+    } else if (err < 0) {
+        problem_free(p);
+    }
+
+    munmap(data, st.st_size);
+    free(cachename);
+
+    return err;
+}
+
+// Reading the input file into the input problem.
+int readfile(char *filename)
+{
+    return problem_read(&input, filename, use_cache);
+}
+
+// Releases the input problem.
+void free_problem()
+{
+    problem_free(&input);
+}
+
+// Auxiliary function that displays all the clauses of a problem.
+void display_problem(struct problem *p)
 {
     printf("The current problem:\n");
     printf("====================\n");
-    for (int i = 0; i < K; i++) {
-        for (int j = 0; j < M; j++) {
-            if (j > 0) {
+    for (int i = 0; i < p->K; i++) {
+        for (int j = p->Offsets[i]; j < p->Offsets[i + 1]; j++) {
+            if (j > p->Offsets[i]) {
                 printf(" or ");
             }
-            if (Problem[(i * M) + j] > 0) {
-                printf("P%d", Problem[(i * M) + j]);
+            if (p->Problem[j] > 0) {
+                printf("P%d", p->Problem[j]);
             } else {
-                printf("not P%d", -Problem[(i * M) + j]);
+                printf("not P%d", -p->Problem[j]);
             }
         }
         printf("\n");
     }
 }
 
-// Auxiliary function that displays the current assignment of truth values to the propositions.
-void display(int *vector)
+// Auxiliary function that displays the assignment of truth values to the n propositions.
+void display(int *vector, int n)
 {
-    for (int i = 0; i < N; i++) {
+    for (int i = 0; i < n; i++) {
         if (vector[i] == 1) {
             printf("P%d=true  ", i + 1);
         } else {
@@ -138,11 +556,3 @@ void display(int *vector)
         }
     }
 }
-
-// Auxiliary function that copies the values of one vector to another.
-void copy(int *vector1, int *vector2)
-{
-    for (int i = 0; i < N; i++) {
-        vector2[i] = vector1[i];
-    }
-}
@@ -0,0 +1,465 @@
+// -----------------------------------------------------------------------
+//
+// Cube-and-conquer. Splitting the search tree on its first propositions
+// gives subtrees of wildly different sizes, so the cuber looks ahead
+// instead: for the most frequent unassigned propositions of a cube it
+// propagates both values, turns a value that fails into a new literal of
+// the cube (a failed literal), and splits on the proposition whose two
+// values propagate the most. The cube with the fewest assigned propositions,
+// the largest subproblem left, is split next, until the requested number of
+// cubes is reached. Cubes can be written to an iCNF file (the clauses, then
+// one "a <literals> 0" line per cube) and read back, and are conquered by
+// searches that start from their literals.
+//
+// -----------------------------------------------------------------------
+
+#define CUBE_DEFAULT 64     // Default number of cubes.
+#define CUBE_CANDIDATES 32  // Unassigned propositions evaluated by each lookahead.
+#define CUBE_SPLIT -1       // Mark of a cube that was split or refuted.
+#define CUBE_FINAL -2       // Mark of a cube that gives every proposition a value.
+
+int cube_target = CUBE_DEFAULT; // Number of cubes the cuber aims for.
+int *cube_lits;             // Literals of the cubes, back to back.
+int *cube_offsets;          // Position in cube_lits of each cube, and its end in cube_offsets[num_cubes].
+int num_cubes;              // Number of cubes.
+int *cube_result;           // Result of the search of each cube: 1, 0, or -1 if it was not searched.
+double *cube_time;          // Wall time of the search of each cube, in seconds.
+unsigned long cube_failed;  // Failed literals found by the lookahead.
+unsigned long cube_refuted; // Cubes refuted by the lookahead.
+
+// List of cubes being split by the cuber.
+struct cube_list {
+    int *lits;              // Literals of the cubes, back to back.
+    int *offsets;           // Position in lits of each cube.
+    int *size;              // Number of literals of each cube.
+    int *assigned;          // Propositions assigned by each open cube, or CUBE_SPLIT or CUBE_FINAL.
+    int count;              // Number of cubes in the list.
+    int capacity;           // Allocated number of cubes.
+    int lits_size;          // Number of used entries of lits.
+    int lits_capacity;      // Allocated size of lits.
+};
+
+// Appends a cube to a list. Returns its index, or -1 on error.
+int cube_append(struct cube_list *l, int *lits, int size, int assigned)
+{
+    if (l->count == l->capacity) {
+        l->capacity = l->capacity > 0 ? 2 * l->capacity : 64;
+        l->offsets = (int*)realloc(l->offsets, l->capacity * sizeof(int));
+        l->size = (int*)realloc(l->size, l->capacity * sizeof(int));
+        l->assigned = (int*)realloc(l->assigned, l->capacity * sizeof(int));
+        if (l->offsets == NULL || l->size == NULL || l->assigned == NULL) {
+            report("Error: malloc for cubes failed.\n");
+            return -1;
+        }
+    }
+    if (l->lits == NULL || l->lits_size + size > l->lits_capacity) {
+        do {
+            l->lits_capacity = l->lits_capacity > 0 ? 2 * l->lits_capacity : 1024;
+        } while (l->lits_size + size > l->lits_capacity);
+        l->lits = (int*)realloc(l->lits, l->lits_capacity * sizeof(int));
+        if (l->lits == NULL) {
+            report("Error: malloc for cubes failed.\n");
+            return -1;
+        }
+    }
+    memcpy(l->lits + l->lits_size, lits, size * sizeof(int));
+    l->offsets[l->count] = l->lits_size;
+    l->size[l->count] = size;
+    l->assigned[l->count] = assigned;
+    l->lits_size += size;
+
+    return l->count++;
+}
+
+// Gives the engine the values of a cube above the base trail of the problem, and propagates
+// them. Returns 0 if the cube contradicts the problem, PROPAGATE_ERROR if memory is exhausted
+// and 1 otherwise.
+int cube_assign(struct engine *e, int base, int *lits, int size)
+{
+    engine_undo(e, base);
+    for (int i = 0; i < size; i++) {
+        int value = literal_value(e, lits[i]);
+        if (value == -1) {
+            return 0;
+        }
+        if (value == 0) {
+            engine_assign(e, lits[i], -1);
+        }
+    }
+
+    int c = engine_propagate(e);
+    if (c == PROPAGATE_ERROR) {
+        return PROPAGATE_ERROR;
+    }
+
+    return c < 0;
+}
+
+// Propagates a literal on top of the engine's assignment and takes it back. Returns the
+// number of propositions it assigns, -1 if it leads to a conflict, or PROPAGATE_ERROR if
+// memory is exhausted.
+int cube_probe(struct engine *e, int lit)
+{
+    int mark = e->trail_size;
+    int c, reduction;
+
+    engine_assign(e, lit, -1);
+    c = engine_propagate(e);
+    reduction = e->trail_size - mark;
+    engine_undo(e, mark);
+    if (c == PROPAGATE_ERROR) {
+        return PROPAGATE_ERROR;
+    }
+
+    return c >= 0 ? -1 : reduction;
+}
+
+// Looks ahead on the candidates of a cube whose values are on the engine. Failed literals
+// are assigned and appended to lits. Returns 1 and stores the literal to split on in split,
+// 0 if every proposition has a value, -1 if the cube is refuted and PROPAGATE_ERROR if memory
+// is exhausted. The propositions the split literal and its negation assign are stored in
+// reduction[0] and reduction[1].
+int lookahead(struct engine *e, int *order, int *lits, int *size, int *split, int *reduction)
+{
+    int i, c, var, positive, negative;
+    int candidates = 0;
+    int best = 0;
+    double score, best_score = -1.0;
+
+    for (i = 0; i < e->N && candidates < CUBE_CANDIDATES; i++) {
+        var = order[i];
+        if (e->assignment[var] != 0) {
+            continue;
+        }
+        candidates++;
+
+        positive = cube_probe(e, var + 1);
+        negative = cube_probe(e, -(var + 1));
+        if (positive == PROPAGATE_ERROR || negative == PROPAGATE_ERROR) {
+            return PROPAGATE_ERROR;
+        }
+        if (positive < 0 || negative < 0) {
+            // A failed value: the other one is implied by the cube.
+            if (positive < 0 && negative < 0) {
+                return -1;
+            }
+            lits[(*size)++] = (positive < 0) ? -(var + 1) : var + 1;
+            engine_assign(e, lits[*size - 1], -1);
+            cube_failed++;
+            c = engine_propagate(e);
+            if (c != -1) {
+                return c == PROPAGATE_ERROR ? PROPAGATE_ERROR : -1;
+            }
+            continue;
+        }
+
+        // Prefer propositions whose values both propagate far.
+        score = (double)positive * negative + positive + negative;
+        if (score > best_score) {
+            best_score = score;
+            best = (positive >= negative) ? var + 1 : -(var + 1);
+            reduction[0] = (positive >= negative) ? positive : negative;
+            reduction[1] = (positive >= negative) ? negative : positive;
+        }
+    }
+
+    // Failed literals may have assigned the best candidate.
+    if (best != 0 && e->assignment[VAR(best)] != 0) {
+        return lookahead(e, order, lits, size, split, reduction);
+    }
+    *split = best;
+
+    return best != 0;
+}
+
+// Orders the keys of the propositions, their missing occurrences in the high half and their
+// index in the low one: by decreasing number of occurrences, the order in which the
+// lookahead takes its candidates.
+int compare_occurrences(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+// Splits a problem into at most cube_target cubes, stored in cube_lits and cube_offsets.
+// Returns the number of cubes, 0 if the lookahead refuted every cube, and -1 on error.
+int make_cubes(struct problem *p)
+{
+    struct engine e;
+    struct cube_list l = {0};
+    int i, c, size, lit, result, live;
+    int reduction[2];
+    int base = 0;
+    int *order, *lits;
+    uint64_t *keys;
+
+    order = (int*)malloc(p->N * sizeof(int));
+    lits = (int*)malloc((p->N + 1) * sizeof(int));
+    keys = (uint64_t*)malloc(p->N * sizeof(uint64_t));
+    if (order == NULL || lits == NULL || keys == NULL || engine_init(&e, p) < 0) {
+        report("Error: malloc for cuber failed.\n");
+        return -1;
+    }
+    for (i = 0; i < p->N; i++) {
+        keys[i] = ((uint64_t)(UINT32_MAX - (p->occ_offsets[2 * i + 2] - p->occ_offsets[2 * i])) << 32) | (uint64_t)i;
+    }
+    qsort(keys, p->N, sizeof(uint64_t), compare_occurrences);
+    for (i = 0; i < p->N; i++) {
+        order[i] = (int)(keys[i] & UINT32_MAX);
+    }
+    free(keys);
+
+    cube_failed = 0;
+    cube_refuted = 0;
+    num_cubes = 0;
+
+    // The unit clauses of the problem, and what they imply, hold below every cube.
+    live = 0;
+    for (i = 0, c = 1; i < p->K && c; i++) {
+        if (p->Offsets[i + 1] - p->Offsets[i] == 1) {
+            if (literal_value(&e, p->Problem[p->Offsets[i]]) == -1) {
+                c = 0;
+            } else if (literal_value(&e, p->Problem[p->Offsets[i]]) == 0) {
+                engine_assign(&e, p->Problem[p->Offsets[i]], -1);
+            }
+        }
+    }
+    if (c) {
+        c = engine_propagate(&e);
+        if (c == PROPAGATE_ERROR) {
+            return -1;
+        }
+    }
+    if (c == -1) {
+        base = e.trail_size;
+        if (cube_append(&l, lits, 0, base) < 0) {
+            return -1;
+        }
+        live = 1;
+    }
+
+    // Split the open cube with the fewest assigned propositions.
+    while (live < cube_target) {
+        for (i = 0, c = -1; i < l.count; i++) {
+            if (l.assigned[i] >= 0 && (c < 0 || l.assigned[i] < l.assigned[c])) {
+                c = i;
+            }
+        }
+        if (c < 0) {
+            break;
+        }
+
+        size = l.size[c];
+        memcpy(lits, l.lits + l.offsets[c], size * sizeof(int));
+        l.assigned[c] = CUBE_SPLIT;
+        live--;
+        result = cube_assign(&e, base, lits, size);
+        if (result > 0) {
+            result = lookahead(&e, order, lits, &size, &lit, reduction);
+        } else if (result == 0) {
+            result = -1;
+        }
+        if (result == PROPAGATE_ERROR) {
+            return -1;
+        }
+        if (result < 0) {
+            cube_refuted++;
+            continue;
+        }
+        if (result == 0) {
+            // Every proposition has a value: the cube is final, a solution.
+            if (cube_append(&l, lits, size, CUBE_FINAL) < 0) {
+                return -1;
+            }
+            live++;
+            continue;
+        }
+
+        lits[size] = lit;
+        if (cube_append(&l, lits, size + 1, e.trail_size + reduction[0]) < 0) {
+            return -1;
+        }
+        lits[size] = -lit;
+        if (cube_append(&l, lits, size + 1, e.trail_size + reduction[1]) < 0) {
+            return -1;
+        }
+        live += 2;
+    }
+
+    // Keep the cubes that were neither split nor refuted, in the order they were made.
+    cube_offsets = (int*)malloc((live + 1) * sizeof(int));
+    cube_lits = (int*)malloc((l.lits_size > 0 ? l.lits_size : 1) * sizeof(int));
+    if (cube_offsets == NULL || cube_lits == NULL) {
+        report("Error: malloc for cubes failed.\n");
+        return -1;
+    }
+    cube_offsets[0] = 0;
+    for (i = 0; i < l.count; i++) {
+        if (l.assigned[i] != CUBE_SPLIT) {
+            memcpy(cube_lits + cube_offsets[num_cubes], l.lits + l.offsets[i], l.size[i] * sizeof(int));
+            cube_offsets[num_cubes + 1] = cube_offsets[num_cubes] + l.size[i];
+            num_cubes++;
+        }
+    }
+
+    free(l.lits);
+    free(l.offsets);
+    free(l.size);
+    free(l.assigned);
+    free(lits);
+    free(order);
+    engine_free(&e);
+
+    return num_cubes;
+}
+
+// Writes a problem and its cubes to an iCNF file. Returns 0, or -1 on error.
+int write_cubes(struct problem *p, char *filename)
+{
+    int i, j;
+    FILE *f = fopen(filename, "w");
+
+    if (f == NULL) {
+        report("Cannot create cube file %s. Program terminates.\n", filename);
+        return -1;
+    }
+    fprintf(f, "p inccnf\n");
+    for (i = 0; i < p->K; i++) {
+        for (j = p->Offsets[i]; j < p->Offsets[i + 1]; j++) {
+            fprintf(f, "%d ", p->Problem[j]);
+        }
+        fprintf(f, "0\n");
+    }
+    for (i = 0; i < num_cubes; i++) {
+        fprintf(f, "a ");
+        for (j = cube_offsets[i]; j < cube_offsets[i + 1]; j++) {
+            fprintf(f, "%d ", cube_lits[j]);
+        }
+        fprintf(f, "0\n");
+    }
+    if (fclose(f) != 0) {
+        report("Cannot write cube file %s. Program terminates.\n", filename);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Reads the cubes of problem p from an iCNF file, its "a" lines; the clauses are those of p,
+// already read. A file without cubes is one whose cubes were all refuted. Returns the
+// number of cubes, or -1 on error.
+int read_cubes(struct problem *p, char *filename)
+{
+    char *line = NULL, *pos, *next;
+    size_t capacity = 0;
+    int lits_capacity = 1024, cubes_capacity = 64;
+    int header = 0;
+    long lit;
+    FILE *f = fopen(filename, "r");
+
+    if (f == NULL) {
+        report("Cannot open cube file %s. Program terminates.\n", filename);
+        return -1;
+    }
+    cube_lits = (int*)malloc(lits_capacity * sizeof(int));
+    cube_offsets = (int*)malloc((cubes_capacity + 1) * sizeof(int));
+    if (cube_lits == NULL || cube_offsets == NULL) {
+        report("Error: malloc for cubes failed.\n");
+        return -1;
+    }
+    num_cubes = 0;
+    cube_offsets[0] = 0;
+
+    while (getline(&line, &capacity, f) >= 0) {
+        if (strncmp(line, "p inccnf", 8) == 0) {
+            header = 1;
+        }
+        if (line[0] != 'a') {
+            continue;
+        }
+        if (num_cubes == cubes_capacity) {
+            cubes_capacity *= 2;
+            cube_offsets = (int*)realloc(cube_offsets, (cubes_capacity + 1) * sizeof(int));
+            if (cube_offsets == NULL) {
+                report("Error: malloc for cubes failed.\n");
+                return -1;
+            }
+        }
+        cube_offsets[num_cubes + 1] = cube_offsets[num_cubes];
+        for (pos = line + 1; ; pos = next) {
+            lit = strtol(pos, &next, 10);
+            if (next == pos || lit == 0) {
+                break;
+            }
+            if (lit > p->N || lit < -p->N) {
+                report("Cube %d of %s has proposition %ld, the problem has %d. Program terminates.\n",
+                       num_cubes + 1, filename, lit < 0 ? -lit : lit, p->N);
+                return -1;
+            }
+            if (cube_offsets[num_cubes + 1] == lits_capacity) {
+                lits_capacity *= 2;
+                cube_lits = (int*)realloc(cube_lits, lits_capacity * sizeof(int));
+                if (cube_lits == NULL) {
+                    report("Error: malloc for cubes failed.\n");
+                    return -1;
+                }
+            }
+            cube_lits[cube_offsets[num_cubes + 1]++] = (int)lit;
+        }
+        num_cubes++;
+    }
+    free(line);
+    fclose(f);
+
+    if (!header) {
+        report("File %s is not an iCNF file. Program terminates.\n", filename);
+        return -1;
+    }
+
+    return num_cubes;
+}
+
+// Allocates the results and times of the cubes, none searched yet.
+int cube_results_init()
+{
+    cube_result = (int*)malloc((num_cubes > 0 ? num_cubes : 1) * sizeof(int));
+    cube_time = (double*)calloc(num_cubes > 0 ? num_cubes : 1, sizeof(double));
+    if (cube_result == NULL || cube_time == NULL) {
+        report("Error: malloc for cubes failed.\n");
+        return -1;
+    }
+    for (int i = 0; i < num_cubes; i++) {
+        cube_result[i] = -1;
+    }
+
+    return 0;
+}
+
+// Reports the result and the time of every cube, and how balanced the times were.
+void report_cubes()
+{
+    int i, searched = 0;
+    double sum = 0.0, shortest = 0.0, longest = 0.0;
+
+    for (i = 0; i < num_cubes; i++) {
+        report("    Cube %d: %d literals, ", i, cube_offsets[i + 1] - cube_offsets[i]);
+        if (cube_result[i] < 0) {
+            report("not searched\n");
+            continue;
+        }
+        report("%s in %0.3f secs\n", cube_result[i] ? "solution" : "no solution", cube_time[i]);
+        if (searched == 0 || cube_time[i] < shortest) {
+            shortest = cube_time[i];
+        }
+        if (cube_time[i] > longest) {
+            longest = cube_time[i];
+        }
+        sum += cube_time[i];
+        searched++;
+    }
+    if (searched > 0) {
+        report("    Cube times: min %0.3f, mean %0.3f, max %0.3f secs\n", shortest, sum / searched, longest);
+    }
+}
@@ -0,0 +1,747 @@
+// -----------------------------------------------------------------------
+//
+// OpenCL devices. Every device of every platform gets command queues of
+// its own, along with its own kernels and copies of the problem buffers;
+// CPU devices may first be split into sub-devices. The devices of a
+// platform share its context and programs. GPUs come first, and the first
+// device is the primary one, which runs the single-vector validations of
+// the search since they wait for each other. Batches of candidates and
+// chunks of the enumeration are split across all the devices instead, in
+// proportion to the throughput each one showed on the previous batches,
+// and their results are merged on the host. Every device has two buffer
+// slots for batches, each with an in-order queue of its own, so that a
+// batch can be uploaded and validated while the previous one is in flight.
+//
+// -----------------------------------------------------------------------
+
+#define THROUGHPUT_SMOOTHING 0.5 // Weight of the last measure in the throughput of a device.
+#define PIPELINE_SLOTS 2    // Buffer slots of a device for batches in flight.
+
+// OpenCL platform structure.
+struct platform {
+    cl_platform_id id;      // The platform.
+    cl_context context;     // Context of the platform's devices.
+    cl_device_id *ids;      // Devices of the platform that are used.
+    cl_uint num_ids;        // Number of those devices.
+    cl_program program;     // Validation kernels (cl_valid.cl), built for those devices.
+    cl_program enum_program; // Enumeration kernel (cl_enum.cl), if enumerating.
+};
+
+// OpenCL device structure.
+struct device {
+    cl_device_id id;        // The device.
+    struct platform *platform; // Platform of the device.
+    char name[100];         // Name of the device.
+    int sub_device;         // Set if the device is a sub-device of a CPU device.
+    cl_command_queue queue[PIPELINE_SLOTS]; // Command queues of the device, one per buffer slot, with
+                            // profiling enabled. The first one also runs the single-vector kernels.
+    int coalesced;          // Set if the kernels read the transposed clauses: clvalid_coalesced and
+                            // clvalid_batch_coalesced rather than clvalid and clvalid_batch.
+    cl_kernel kernel;       // Validation kernel, clvalid_coalesced or the legacy clvalid.
+    cl_kernel batch_kernel; // Kernel validating a batch of candidates, clvalid_batch_coalesced or clvalid_batch.
+    cl_kernel occ_kernel;   // Kernel validating the clauses of one occurrence list (named "clvalid_occ").
+    cl_kernel enum_kernel;  // Kernel evaluating a chunk of assignments (named "clenum").
+    size_t globalWorkSize[1];
+    size_t localWorkSize[1]; // Work-group size of kernel, a power of two for the reduction.
+    size_t batchLocalWorkSize[2]; // Work-group size of clvalid_batch_coalesced, over clauses and candidates.
+    size_t batchGroups;     // Work-groups of clvalid_batch_coalesced enough for every clause of a candidate.
+    size_t occLocalWorkSize[1]; // Work-group size of clvalid_occ, a power of two for the reduction.
+    cl_mem d_problem;
+    cl_mem d_offsets;       // Position of each clause in d_problem.
+    cl_mem d_problem_t;     // Transposed copy of Problem with 16-bit literals, for the coalesced kernels.
+    cl_mem d_finish;
+    cl_mem d_vector;        // The vector being validated.
+    cl_mem d_count;         // Number of valid clauses, reduced on the device.
+    cl_mem d_candidates[PIPELINE_SLOTS]; // Candidates of a batch, batch_size rows of N values.
+    cl_mem d_flags[PIPELINE_SLOTS]; // Whether each candidate of a batch is valid.
+    cl_mem d_occ_clauses;   // Occurrence lists of the literals, occ_clauses on the device.
+    cl_mem d_found;         // Smallest satisfying number of a chunk, relative to the chunk.
+    cl_uint compute_units;  // Compute units of the device.
+    double throughput;      // Candidates or assignments per second, 0 until measured.
+    unsigned long items;    // Candidates or assignments validated by the device.
+    float kernel_time;      // Time spent running the device's kernels, in seconds.
+    size_t problem_capacity, offsets_capacity, problem_t_capacity, finish_capacity, vector_capacity;
+    size_t candidates_capacity[PIPELINE_SLOTS], flags_capacity[PIPELINE_SLOTS], occ_capacity;
+                            // Sizes of the buffers, kept from one problem to the next.
+};
+
+// Work split across the devices, in flight until it is merged.
+struct work {
+    unsigned long *share;   // Candidates or assignments given to each device.
+    cl_event *first;        // Per device given a share, its first command.
+    cl_event *run;          // Per device given a share, its kernel.
+    cl_event *last;         // Per device given a share, its last command.
+    int pending;            // Set until the work is merged.
+};
+
+struct platform *platforms_cl; // The platforms with devices.
+int num_platforms_cl;       // Number of those platforms.
+struct device *devs;        // The devices, the primary one first.
+int num_devs;               // Number of devices.
+int d_step; // Used to define starting index in Problem vector for each work item.
+int *d_finish_host;         // Finishing index of each work item.
+
+// Adds a device to the list, splitting it into sub-devices of sub_units compute units when
+// it is a CPU device and sub_units is positive. No more than max_devices are listed when it
+// is positive; sub-devices beyond that are released.
+void add_device(struct platform *p, cl_device_id id, int sub_units, int max_devices)
+{
+    cl_device_id sub[64];
+    cl_uint num_sub = 0;
+    cl_device_type type;
+
+    status = clGetDeviceInfo(id, CL_DEVICE_TYPE, sizeof(cl_device_type), &type, NULL);
+    if (status != CL_SUCCESS) {
+        report("clGetDeviceInfo failed. Program terminates.\n");
+        exit(-1);
+    }
+    if (sub_units > 0 && (type & CL_DEVICE_TYPE_CPU)) {
+        cl_device_partition_property props[] = {CL_DEVICE_PARTITION_EQUALLY, sub_units, 0};
+        if (clCreateSubDevices(id, props, 64, sub, &num_sub) != CL_SUCCESS || num_sub > 64) {
+            report("Device cannot be split into sub-devices of %d compute units, using it whole.\n", sub_units);
+            num_sub = 0;
+        }
+    }
+    if (num_sub == 0) {
+        sub[0] = id;
+    }
+
+    for (cl_uint i = 0; i < (num_sub > 0 ? num_sub : 1); i++) {
+        if (max_devices > 0 && num_devs == max_devices) {
+            clReleaseDevice(sub[i]);
+            continue;
+        }
+        struct device *d = &devs[num_devs++];
+        memset(d, 0, sizeof(struct device));
+        d->id = sub[i];
+        d->platform = p;
+        d->sub_device = (num_sub > 0);
+        status = clGetDeviceInfo(d->id, CL_DEVICE_NAME, sizeof(d->name), d->name, NULL);
+        status |= clGetDeviceInfo(d->id, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(cl_uint), &d->compute_units, NULL);
+        if (status != CL_SUCCESS) {
+            report("clGetDeviceInfo failed. Program terminates.\n");
+            exit(-1);
+        }
+        p->ids[p->num_ids++] = d->id;
+    }
+}
+
+// Finds the devices of every platform, at most max_devices of them when it is positive,
+// splits CPU devices into sub-devices of sub_units compute units when it is positive, and
+// creates a context per platform and the command queues of every device. Devices are printed.
+void devices_init(int max_devices, int sub_units)
+{
+    cl_uint numPlatforms = 0;
+    cl_platform_id *platforms;
+    int capacity = 0;
+
+    // Query for the number of recongnized platforms.
+    status = clGetPlatformIDs(0, NULL, &numPlatforms);
+    if (status != CL_SUCCESS) {
+        report("clGetPlatformIDs failed. Program terminates.\n");
+        exit(-1);
+    }
+
+    // Make sure some platforms were found.
+    if (numPlatforms == 0) {
+        report("No platforms detected. Program terminates.\n");
+        exit(-1);
+    }
+
+    // Fill in platforms.
+    platforms = (cl_platform_id*)malloc(numPlatforms * sizeof(cl_platform_id));
+    platforms_cl = (struct platform*)calloc(numPlatforms, sizeof(struct platform));
+    if (platforms == NULL || platforms_cl == NULL) {
+        perror("malloc");
+        exit(-1);
+    }
+    status = clGetPlatformIDs(numPlatforms, platforms, NULL);
+    if (status != CL_SUCCESS) {
+        report("clGetPlatformIDs failed. Program terminates.\n");
+        exit(-1);
+    }
+
+    // Print out some basic information about each platform, and count its devices.
+    report("%u platforms detected\n", numPlatforms);
+    cl_uint *numDevices = (cl_uint*)calloc(numPlatforms, sizeof(cl_uint));
+    if (numDevices == NULL) {
+        perror("malloc");
+        exit(-1);
+    }
+    for (int i = 0; i < numPlatforms; i++) {
+        char buf[100];
+        report("Platform %u: \n", i);
+        status = clGetPlatformInfo(platforms[i], CL_PLATFORM_VENDOR, sizeof(buf), buf, NULL);
+        report("\tVendor: %s\n", buf);
+        status |= clGetPlatformInfo(platforms[i], CL_PLATFORM_NAME, sizeof(buf), buf, NULL);
+        report("\tName: %s\n", buf);
+        if (status != CL_SUCCESS) {
+            report("clGetPlatformInfo failed. Program terminates.\n");
+            exit(-1);
+        }
+        status = clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, 0, NULL, &numDevices[i]);
+        if (status == CL_DEVICE_NOT_FOUND) {
+            numDevices[i] = 0;
+        } else if (status != CL_SUCCESS) {
+            report("clGetDeviceIDs failed. Program terminates.\n");
+            exit(-1);
+        }
+        capacity += numDevices[i] * (sub_units > 0 ? 64 : 1);
+    }
+    report("\n");
+
+    devs = (struct device*)calloc(capacity > 0 ? capacity : 1, sizeof(struct device));
+    if (devs == NULL) {
+        perror("malloc");
+        exit(-1);
+    }
+
+    // GPUs are listed first, so that the primary device is a GPU when there is one.
+    num_devs = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = 0; i < numPlatforms; i++) {
+            struct platform *p = &platforms_cl[i];
+            cl_device_id *ids;
+            if (numDevices[i] == 0) {
+                continue;
+            }
+            ids = (cl_device_id*)malloc(numDevices[i] * sizeof(cl_device_id));
+            if (ids == NULL) {
+                perror("malloc");
+                exit(-1);
+            }
+            status = clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_ALL, numDevices[i], ids, NULL);
+            if (status != CL_SUCCESS) {
+                report("clGetDeviceIDs failed. Program terminates.\n");
+                exit(-1);
+            }
+            if (p->ids == NULL) {
+                p->id = platforms[i];
+                p->ids = (cl_device_id*)malloc(numDevices[i] * (sub_units > 0 ? 64 : 1) * sizeof(cl_device_id));
+                if (p->ids == NULL) {
+                    perror("malloc");
+                    exit(-1);
+                }
+            }
+            for (int j = 0; j < numDevices[i] && (max_devices <= 0 || num_devs < max_devices); j++) {
+                cl_device_type type;
+                status = clGetDeviceInfo(ids[j], CL_DEVICE_TYPE, sizeof(cl_device_type), &type, NULL);
+                if (status != CL_SUCCESS) {
+                    report("clGetDeviceInfo failed. Program terminates.\n");
+                    exit(-1);
+                }
+                if (((type & CL_DEVICE_TYPE_GPU) != 0) == (pass == 0)) {
+                    add_device(p, ids[j], sub_units, max_devices);
+                }
+            }
+            free(ids);
+        }
+    }
+    // Make sure some devices were found.
+    if (num_devs == 0) {
+        report("No devices detected. Program terminates.\n");
+        exit(-1);
+    }
+
+    // Create a context per platform, and the command queues of every device. Profiling is
+    // enabled so that kernel events report their execution time.
+    cl_queue_properties queueProperties[] = {CL_QUEUE_PROPERTIES, CL_QUEUE_PROFILING_ENABLE, 0};
+    num_platforms_cl = numPlatforms;
+    for (int i = 0; i < numPlatforms; i++) {
+        struct platform *p = &platforms_cl[i];
+        if (p->num_ids == 0) {
+            continue;
+        }
+        cl_context_properties contextProperties[] = {CL_CONTEXT_PLATFORM, (cl_context_properties)p->id, 0};
+        p->context = clCreateContext(contextProperties, p->num_ids, p->ids, NULL, NULL, &status);
+        if (status != CL_SUCCESS || p->context == NULL) {
+            report("clCreateContext failed. Program terminates.\n");
+            exit(-1);
+        }
+    }
+
+    // Print out some basic information about each device.
+    report("%d devices used\n", num_devs);
+    for (int i = 0; i < num_devs; i++) {
+        struct device *d = &devs[i];
+        char buf[100];
+        for (int j = 0; j < PIPELINE_SLOTS; j++) {
+            d->queue[j] = clCreateCommandQueueWithProperties(d->platform->context, d->id, queueProperties, &status);
+            if (status != CL_SUCCESS || d->queue[j] == NULL) {
+                report("clCreateCommandQueue failed. Program terminates.\n");
+                exit(-1);
+            }
+        }
+        report("Device %u: \n", i);
+        status = clGetDeviceInfo(d->id, CL_DEVICE_VENDOR, sizeof(buf), buf, NULL);
+        report("\tDevice: %s\n", buf);
+        report("\tName: %s%s\n", d->name, d->sub_device ? " (sub-device)" : "");
+        report("\tPlatform: %d, compute units: %u%s\n", (int)(d->platform - platforms_cl), d->compute_units, i == 0 ? ", primary" : "");
+        if (status != CL_SUCCESS) {
+            report("clGetDeviceInfo failed. Program terminates.\n");
+            exit(-1);
+        }
+    }
+    report("\n");
+
+    free(numDevices);
+    free(platforms);
+}
+
+// Builds the validation kernels, and the enumeration kernel when enumerating, for the
+// devices of every platform.
+void devices_build(int enumerating)
+{
+    for (int i = 0; i < num_platforms_cl; i++) {
+        struct platform *p = &platforms_cl[i];
+        if (p->num_ids == 0) {
+            continue;
+        }
+        p->program = build_program(p->context, "cl_valid.cl", p->num_ids, p->ids);
+        if (enumerating) {
+            p->enum_program = build_program(p->context, "cl_enum.cl", p->num_ids, p->ids);
+        }
+    }
+}
+
+// Creates a buffer in the context of a device, exiting on failure.
+cl_mem device_buffer(struct device *d, cl_mem_flags flags, size_t size, void *host)
+{
+    cl_mem buffer = clCreateBuffer(d->platform->context, flags, size, host, &status);
+    if (status != CL_SUCCESS || buffer == NULL) {
+        report("clCreateBuffer failed. Program terminates.\n");
+        exit(-1);
+    }
+    if (flags & CL_MEM_COPY_HOST_PTR) {
+        bytes_to_device += size;
+    }
+
+    return buffer;
+}
+
+// Stores size bytes of host data, or none if host is NULL, in a buffer of a device that
+// is kept from one problem to the next: it is only created again when it is too small.
+void device_store(struct device *d, cl_mem *buffer, size_t *capacity, cl_mem_flags flags, size_t size, void *host)
+{
+    if (*buffer == NULL || size > *capacity) {
+        if (*buffer != NULL) {
+            clReleaseMemObject(*buffer);
+        }
+        *buffer = device_buffer(d, flags | (host != NULL ? CL_MEM_COPY_HOST_PTR : 0), size, host);
+        *capacity = size;
+    } else if (host != NULL) {
+        status = clEnqueueWriteBuffer(d->queue[0], *buffer, CL_TRUE, 0, size, host, 0, NULL, NULL);
+        if (status != CL_SUCCESS) {
+            report("clEnqueueWriteBuffer failed. Program terminates.\n");
+            exit(-1);
+        }
+        bytes_to_device += size;
+    }
+}
+
+// Creates the kernels of a device and passes problem p, with its occurrence lists, to it.
+// The validation kernels are clvalid and clvalid_batch, or clvalid_coalesced and
+// clvalid_batch_coalesced if kernel_name is "coalesced" and the problem is not too large
+// for them on this device. Batches hold up to batch candidates. The work items and their
+// clause ranges (d_step, d_finish_host) are shared. When the device solved a problem
+// before, its kernels are kept and its buffers reused, unless the new problem needs larger ones.
+void device_setup(struct device *d, struct problem *p, char *kernel_name, int batch)
+{
+    cl_program program = d->platform->program;
+    int N = p->N, K = p->K, M = p->M;
+    size_t maxGroupSize;
+    int coalesced;
+
+    // The coalesced kernels need 16-bit literals and the vector in local memory.
+    cl_ulong localMemSize;
+    status = clGetDeviceInfo(d->id, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(cl_ulong), &localMemSize, NULL);
+    if (status != CL_SUCCESS) {
+        report("clGetDeviceInfo failed. Program terminates.\n");
+        exit(-1);
+    }
+    coalesced = (strcmp(kernel_name, "coalesced") == 0);
+    if (coalesced && (2 * N > 65536 || N + COALESCED_GROUP_SIZE * sizeof(int) > localMemSize)) {
+        report("Problem too large for the coalesced kernels on device %d, using the legacy kernels.\n", (int)(d - devs));
+        coalesced = 0;
+    }
+    if (d->kernel != NULL && d->coalesced != coalesced) {
+        clReleaseKernel(d->kernel);
+        clReleaseKernel(d->batch_kernel);
+        d->kernel = NULL;
+        d->batch_kernel = NULL;
+    }
+    d->coalesced = coalesced;
+
+    // Create a kernel from the vector validation function (named "clvalid_coalesced" or "clvalid").
+    if (d->kernel == NULL) {
+        d->kernel = clCreateKernel(program, d->coalesced ? "clvalid_coalesced" : "clvalid", &status);
+        if (status != CL_SUCCESS) {
+            report("clCreateKernel failed. Program terminates.\n");
+            exit(-1);
+        }
+    }
+    if (d->batch_kernel == NULL) {
+        d->batch_kernel = clCreateKernel(program, d->coalesced ? "clvalid_batch_coalesced" : "clvalid_batch", &status);
+        if (status != CL_SUCCESS) {
+            report("clCreateKernel failed. Program terminates.\n");
+            exit(-1);
+        }
+    }
+    if (d->occ_kernel == NULL) {
+        d->occ_kernel = clCreateKernel(program, "clvalid_occ", &status);
+        if (status != CL_SUCCESS) {
+            report("clCreateKernel failed. Program terminates.\n");
+            exit(-1);
+        }
+    }
+
+    status = clGetKernelWorkGroupInfo(d->kernel, d->id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxGroupSize, NULL);
+    if (status != CL_SUCCESS) {
+        report("clGetKernelWorkGroupInfo failed. Program terminates.\n");
+        exit(-1);
+    }
+    d->localWorkSize[0] = 1;
+    if (d->coalesced) {
+        // Define an index space from the device: work-groups as large as the kernel allows,
+        // enough of them to keep every compute unit busy, and no more than the clauses need.
+        while (d->localWorkSize[0] * 2 <= maxGroupSize && d->localWorkSize[0] * 2 <= COALESCED_GROUP_SIZE && d->localWorkSize[0] < K) {
+            d->localWorkSize[0] *= 2;
+        }
+        size_t groups = (K + d->localWorkSize[0] - 1) / d->localWorkSize[0];
+        if (groups > d->compute_units * GROUPS_PER_UNIT) {
+            groups = d->compute_units * GROUPS_PER_UNIT;
+        }
+        d->globalWorkSize[0] = groups * d->localWorkSize[0];
+    } else {
+        // Define an index space (global work size) of threads for execution.
+        // There are WI threads, rounded up to whole work-groups whose size is a power of
+        // two, so that each work-group can reduce its count in local memory.
+        while (d->localWorkSize[0] * 2 <= maxGroupSize && d->localWorkSize[0] * 2 <= WORK_GROUP_SIZE && d->localWorkSize[0] < WI) {
+            d->localWorkSize[0] *= 2;
+        }
+        d->globalWorkSize[0] = ((WI + d->localWorkSize[0] - 1) / d->localWorkSize[0]) * d->localWorkSize[0];
+    }
+
+    // Pass data to the device.
+    device_store(d, &d->d_finish, &d->finish_capacity, CL_MEM_READ_ONLY, WI * sizeof(int), d_finish_host);
+
+    // When the problem came from the binary cache, its clauses and offsets point into its
+    // mapping, so they are uploaded straight from the mapped file.
+    device_store(d, &d->d_problem, &d->problem_capacity, CL_MEM_READ_ONLY, p->Offsets[K] * sizeof(int), p->Problem);
+    device_store(d, &d->d_offsets, &d->offsets_capacity, CL_MEM_READ_ONLY, (K + 1) * sizeof(int), p->Offsets);
+
+    // The vector starts unassigned on both sides.
+    device_store(d, &d->d_vector, &d->vector_capacity, CL_MEM_READ_ONLY, N * sizeof(int), d_vector_copy);
+    if (d->d_count == NULL) {
+        d->d_count = device_buffer(d, CL_MEM_READ_WRITE, sizeof(int), NULL);
+    }
+
+    // Set kernel arguments.
+    if (d->coalesced) {
+        // Literal j of clause i goes to (j * K) + i, encoded by LIT_INDEX. Clauses shorter
+        // than M are padded with their first literal, which leaves them unchanged.
+        unsigned short *problem_t = (unsigned short*)malloc(K * M * sizeof(unsigned short));
+        if (problem_t == NULL) {
+            report("Memory exhausted. Program terminates.\n");
+            exit(-1);
+        }
+        for (int i = 0; i < K; i++) {
+            for (int j = 0; j < M; j++) {
+                int lit = (p->Offsets[i] + j < p->Offsets[i + 1]) ? p->Problem[p->Offsets[i] + j] : p->Problem[p->Offsets[i]];
+                problem_t[(j * K) + i] = LIT_INDEX(lit);
+            }
+        }
+        device_store(d, &d->d_problem_t, &d->problem_t_capacity, CL_MEM_READ_ONLY, K * M * sizeof(unsigned short), problem_t);
+        free(problem_t);
+        status = clSetKernelArg(d->kernel, 0, sizeof(cl_mem), &d->d_problem_t);
+        status |= clSetKernelArg(d->kernel, 1, sizeof(cl_mem), &d->d_vector);
+        status |= clSetKernelArg(d->kernel, 2, sizeof(cl_mem), &d->d_count);
+        status |= clSetKernelArg(d->kernel, 3, d->localWorkSize[0] * sizeof(int), NULL);
+        status |= clSetKernelArg(d->kernel, 4, N * sizeof(char), NULL);
+        status |= clSetKernelArg(d->kernel, 5, sizeof(int), &K);
+        status |= clSetKernelArg(d->kernel, 6, sizeof(int), &M);
+        status |= clSetKernelArg(d->kernel, 7, sizeof(int), &N);
+    } else {
+        status = clSetKernelArg(d->kernel, 0, sizeof(cl_mem), &d->d_problem);
+        status |= clSetKernelArg(d->kernel, 1, sizeof(cl_mem), &d->d_offsets);
+        status |= clSetKernelArg(d->kernel, 2, sizeof(cl_mem), &d->d_vector);
+        status |= clSetKernelArg(d->kernel, 3, sizeof(cl_mem), &d->d_finish);
+        status |= clSetKernelArg(d->kernel, 4, sizeof(cl_mem), &d->d_count);
+        status |= clSetKernelArg(d->kernel, 5, d->localWorkSize[0] * sizeof(int), NULL);
+        status |= clSetKernelArg(d->kernel, 6, sizeof(int), &d_step);
+        status |= clSetKernelArg(d->kernel, 7, sizeof(int), &WI);
+    }
+    if (status != CL_SUCCESS) {
+        report("clSetKernelArg failed. Program terminates.\n");
+        exit(-1);
+    }
+
+    // Batch buffers are allocated once per slot, for the largest batch. The candidates and
+    // flags arguments are set at each launch, from the slot of the batch.
+    for (int j = 0; j < PIPELINE_SLOTS; j++) {
+        device_store(d, &d->d_candidates[j], &d->candidates_capacity[j], CL_MEM_READ_ONLY, batch * N * sizeof(int), NULL);
+        device_store(d, &d->d_flags[j], &d->flags_capacity[j], CL_MEM_READ_WRITE, batch * sizeof(int), NULL);
+    }
+    if (d->coalesced) {
+        // A work-group per candidate and range of clauses, as large as the kernel allows. The
+        // number of work-groups per candidate is set at each launch, from the batch size.
+        status = clGetKernelWorkGroupInfo(d->batch_kernel, d->id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxGroupSize, NULL);
+        if (status != CL_SUCCESS) {
+            report("clGetKernelWorkGroupInfo failed. Program terminates.\n");
+            exit(-1);
+        }
+        d->batchLocalWorkSize[0] = 1;
+        d->batchLocalWorkSize[1] = 1;
+        while (d->batchLocalWorkSize[0] * 2 <= maxGroupSize && d->batchLocalWorkSize[0] * 2 <= COALESCED_GROUP_SIZE && d->batchLocalWorkSize[0] < K) {
+            d->batchLocalWorkSize[0] *= 2;
+        }
+        d->batchGroups = (K + d->batchLocalWorkSize[0] - 1) / d->batchLocalWorkSize[0];
+        status = clSetKernelArg(d->batch_kernel, 0, sizeof(cl_mem), &d->d_problem_t);
+        status |= clSetKernelArg(d->batch_kernel, 3, N * sizeof(char), NULL);
+        status |= clSetKernelArg(d->batch_kernel, 4, sizeof(int), &K);
+        status |= clSetKernelArg(d->batch_kernel, 5, sizeof(int), &M);
+        status |= clSetKernelArg(d->batch_kernel, 6, sizeof(int), &N);
+    } else {
+        status = clSetKernelArg(d->batch_kernel, 0, sizeof(cl_mem), &d->d_problem);
+        status |= clSetKernelArg(d->batch_kernel, 1, sizeof(cl_mem), &d->d_offsets);
+        status |= clSetKernelArg(d->batch_kernel, 3, sizeof(cl_mem), &d->d_finish);
+        status |= clSetKernelArg(d->batch_kernel, 5, sizeof(int), &d_step);
+        status |= clSetKernelArg(d->batch_kernel, 6, sizeof(int), &N);
+    }
+    if (status != CL_SUCCESS) {
+        report("clSetKernelArg failed. Program terminates.\n");
+        exit(-1);
+    }
+
+    // The occurrence lists are uploaded once; work-groups of clvalid_occ are sized for
+    // the longest list.
+    device_store(d, &d->d_occ_clauses, &d->occ_capacity, CL_MEM_READ_ONLY, (p->occ_offsets[2 * N] > 0 ? p->occ_offsets[2 * N] : 1) * sizeof(int), p->occ_clauses);
+    int longest = 0;
+    for (int i = 0; i < 2 * N; i++) {
+        if (p->occ_offsets[i + 1] - p->occ_offsets[i] > longest) {
+            longest = p->occ_offsets[i + 1] - p->occ_offsets[i];
+        }
+    }
+    status = clGetKernelWorkGroupInfo(d->occ_kernel, d->id, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &maxGroupSize, NULL);
+    if (status != CL_SUCCESS) {
+        report("clGetKernelWorkGroupInfo failed. Program terminates.\n");
+        exit(-1);
+    }
+    d->occLocalWorkSize[0] = 1;
+    while (d->occLocalWorkSize[0] * 2 <= maxGroupSize && d->occLocalWorkSize[0] * 2 <= WORK_GROUP_SIZE && d->occLocalWorkSize[0] < longest) {
+        d->occLocalWorkSize[0] *= 2;
+    }
+    status = clSetKernelArg(d->occ_kernel, 0, sizeof(cl_mem), &d->d_problem);
+    status |= clSetKernelArg(d->occ_kernel, 1, sizeof(cl_mem), &d->d_offsets);
+    status |= clSetKernelArg(d->occ_kernel, 2, sizeof(cl_mem), &d->d_occ_clauses);
+    status |= clSetKernelArg(d->occ_kernel, 3, sizeof(cl_mem), &d->d_vector);
+    status |= clSetKernelArg(d->occ_kernel, 4, sizeof(cl_mem), &d->d_count);
+    status |= clSetKernelArg(d->occ_kernel, 5, d->occLocalWorkSize[0] * sizeof(int), NULL);
+    if (status != CL_SUCCESS) {
+        report("clSetKernelArg failed. Program terminates.\n");
+        exit(-1);
+    }
+
+    // The enumeration kernel has a program of its own.
+    if (d->platform->enum_program != NULL) {
+        if (d->enum_kernel == NULL) {
+            d->enum_kernel = clCreateKernel(d->platform->enum_program, "clenum", &status);
+            if (status != CL_SUCCESS) {
+                report("clCreateKernel failed. Program terminates.\n");
+                exit(-1);
+            }
+            d->d_found = device_buffer(d, CL_MEM_READ_WRITE, sizeof(cl_uint), NULL);
+        }
+        status = clSetKernelArg(d->enum_kernel, 0, sizeof(cl_mem), &d->d_problem);
+        status |= clSetKernelArg(d->enum_kernel, 1, sizeof(cl_mem), &d->d_offsets);
+        status |= clSetKernelArg(d->enum_kernel, 2, sizeof(cl_mem), &d->d_found);
+        status |= clSetKernelArg(d->enum_kernel, 4, sizeof(int), &K);
+        status |= clSetKernelArg(d->enum_kernel, 5, sizeof(int), &N);
+        if (status != CL_SUCCESS) {
+            report("clSetKernelArg failed. Program terminates.\n");
+            exit(-1);
+        }
+    }
+}
+
+// Allocates the per-device tables of a work. Returns 0, or -1 on error.
+int work_init(struct work *w)
+{
+    w->share = (unsigned long*)calloc(num_devs, sizeof(unsigned long));
+    w->first = (cl_event*)calloc(num_devs, sizeof(cl_event));
+    w->run = (cl_event*)calloc(num_devs, sizeof(cl_event));
+    w->last = (cl_event*)calloc(num_devs, sizeof(cl_event));
+    w->pending = 0;
+    if (w->share == NULL || w->first == NULL || w->run == NULL || w->last == NULL) {
+        report("Memory exhausted. Program terminates.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Releases the tables of a work.
+void work_free(struct work *w)
+{
+    free(w->share);
+    free(w->first);
+    free(w->run);
+    free(w->last);
+}
+
+// Splits count candidates or assignments across the devices in proportion to their
+// throughput; devices not yet measured count as the average of the measured ones. While
+// there is enough work, every device gets some, so that its throughput keeps being measured.
+void split_work(struct work *w, unsigned long count)
+{
+    double measured = 0.0, sum = 0.0;
+    int i, fastest = 0, num_measured = 0;
+    unsigned long given = 0;
+
+    for (i = 0; i < num_devs; i++) {
+        if (devs[i].throughput > 0) {
+            measured += devs[i].throughput;
+            num_measured++;
+        }
+    }
+    double unmeasured = num_measured > 0 ? measured / num_measured : 1.0;
+    for (i = 0; i < num_devs; i++) {
+        sum += devs[i].throughput > 0 ? devs[i].throughput : unmeasured;
+    }
+
+    for (i = 0; i < num_devs; i++) {
+        double weight = devs[i].throughput > 0 ? devs[i].throughput : unmeasured;
+        w->share[i] = (unsigned long)(count * weight / sum);
+        if (w->share[i] == 0 && count >= (unsigned long)num_devs) {
+            w->share[i] = 1;
+        }
+        if (given + w->share[i] > count) {
+            w->share[i] = count - given;
+        }
+        given += w->share[i];
+        if (weight > (devs[fastest].throughput > 0 ? devs[fastest].throughput : unmeasured)) {
+            fastest = i;
+        }
+    }
+
+    // What rounding left goes to the fastest device.
+    w->share[fastest] += count - given;
+    w->pending = 1;
+}
+
+// Returns the run time of a kernel event, in seconds, and releases the event.
+float event_time(cl_event event)
+{
+    cl_ulong start, end;
+
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+    clGetEventProfilingInfo(event, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+    clReleaseEvent(event);
+
+    return (end - start) / 1000000000.0;
+}
+
+// Waits until every device has read its share of a pending work from host memory, so
+// that the host can reuse that memory.
+void work_uploaded(struct work *w)
+{
+    for (int i = 0; w->pending && i < num_devs; i++) {
+        if (w->share[i] > 0) {
+            clWaitForEvents(1, &w->first[i]);
+        }
+    }
+}
+
+// Waits for the devices given a share of a work, updates their throughput from the time
+// between the start of their first command and the end of their last, and adds their
+// kernel times. A work counts as one kernel launch, however many devices it was split
+// across. Returns the longest kernel time, the devices having run side by side.
+float merge_work(struct work *w)
+{
+    float longest = 0.0;
+    cl_ulong start, end;
+
+    kernel_launches++;
+    for (int i = 0; i < num_devs; i++) {
+        struct device *d = &devs[i];
+        if (w->share[i] == 0) {
+            continue;
+        }
+        clWaitForEvents(1, &w->last[i]);
+        clGetEventProfilingInfo(w->first[i], CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &start, NULL);
+        clGetEventProfilingInfo(w->last[i], CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &end, NULL);
+        clReleaseEvent(w->first[i]);
+        clReleaseEvent(w->last[i]);
+        if (end > start) {
+            double measure = w->share[i] / ((end - start) / 1000000000.0);
+            d->throughput = d->throughput > 0 ? (1.0 - THROUGHPUT_SMOOTHING) * d->throughput + THROUGHPUT_SMOOTHING * measure : measure;
+        }
+        float run = event_time(w->run[i]);
+        d->kernel_time += run;
+        d->items += w->share[i];
+        if (run > longest) {
+            longest = run;
+        }
+    }
+    w->pending = 0;
+
+    return longest;
+}
+
+// Prints how much of the work every device did, and at which throughput.
+void report_devices(char *unit)
+{
+    if (num_devs < 2) {
+        return;
+    }
+    report("\nDevices:\n");
+    for (int i = 0; i < num_devs; i++) {
+        struct device *d = &devs[i];
+        report("    Device %d, %s: %lu %s, %0.0f %s/sec, kernels %0.3f secs\n", i, d->name, d->items, unit, d->throughput, unit, d->kernel_time);
+    }
+}
+
+// Releases the devices, their buffers and kernels, and the contexts and programs of the platforms.
+void devices_free()
+{
+    for (int i = 0; i < num_devs; i++) {
+        struct device *d = &devs[i];
+        clReleaseKernel(d->kernel);
+        clReleaseKernel(d->batch_kernel);
+        clReleaseKernel(d->occ_kernel);
+        if (d->enum_kernel != NULL) {
+            clReleaseKernel(d->enum_kernel);
+            clReleaseMemObject(d->d_found);
+        }
+        for (int j = 0; j < PIPELINE_SLOTS; j++) {
+            clReleaseCommandQueue(d->queue[j]);
+            clReleaseMemObject(d->d_candidates[j]);
+            clReleaseMemObject(d->d_flags[j]);
+        }
+        clReleaseMemObject(d->d_problem);
+        clReleaseMemObject(d->d_offsets);
+        if (d->d_problem_t != NULL) {
+            clReleaseMemObject(d->d_problem_t);
+        }
+        clReleaseMemObject(d->d_finish);
+        clReleaseMemObject(d->d_vector);
+        clReleaseMemObject(d->d_count);
+        clReleaseMemObject(d->d_occ_clauses);
+        if (d->sub_device) {
+            clReleaseDevice(d->id);
+        }
+    }
+    for (int i = 0; i < num_platforms_cl; i++) {
+        struct platform *p = &platforms_cl[i];
+        if (p->num_ids > 0) {
+            clReleaseProgram(p->program);
+            if (p->enum_program != NULL) {
+                clReleaseProgram(p->enum_program);
+            }
+            clReleaseContext(p->context);
+        }
+        free(p->ids);
+    }
+    free(platforms_cl);
+    free(devs);
+}
@@ -1,130 +1,142 @@
-// This function adds a pointer to a new leaf search-tree node at the front of the frontier.
-int add_to_frontier(struct frontier_node *node)
+// Checks whether the current assignment of the engine is still acceptable, either by
+// propagating the new values or by validating the clauses each new value may have made
+// false. Without propagation, the trail position up to which values were checked is kept
+// in e->propagated, so backtracking leaves only the new values to check. Returns 1 if it
+// is, 0 if it is not and -1 if memory is exhausted.
+int consistent(struct engine *e)
 {
-    if (node == NULL) {
-        return -1;
+    COUNT_ADD(e->checks, 1);
+    if (propagation) {
+        int c = engine_propagate(e);
+        if (c == PROPAGATE_ERROR) {
+            return -1;
+        }
+        if (c >= 0) {
+            e->conflicts++;
+            COUNT_ADD(e->pruned, 1);
+            bump_conflict(e, c);
+            return 0;
+        }
+        return 1;
     }
 
-    node->previous = NULL;
-    node->next = head;
-
-    if (head == NULL) {
-        head = node;
-        tail = node;
-    } else {
-        head->previous = node;
-        head = node;
+    while (e->propagated < e->trail_size) {
+        if (!valid_literal(e->p, e->assignment, e->trail[e->propagated++])) {
+            COUNT_ADD(e->pruned, 1);
+            return 0;
+        }
     }
 
-    return 0;
+    return 1;
 }
 
-// Check whether a vector is a complete assignment and it is also valid.
-int solution(struct frontier_node *node)
+// Depth-first search below the values already on the trail, which are never undone
+// by backtracking. Each decision gives the proposition chosen by the decision heuristic
+// its preferred value and, once that subtree is exhausted, the other value. Backtracking
+// undoes the trail instead of copying vectors, so no memory is allocated while searching.
+// Returns 1 when the engine's assignment is a solution, 0 if the subtree has no solution
+// and -1 if the search was stopped through the engine's stop flag.
+int dfs(struct engine *e)
 {
-    for (int i = 0; i < N; i++) {
-        if (node->vector[i] == 0) {
-            return 0;
+    int d, lit, ok;
+    int base = e->trail_size;
+
+    while (1) {
+        // A complete acceptable assignment is a solution.
+        lit = pick_branch_literal(e);
+        if (lit == 0) {
+            return 1;
         }
-    }
 
-    return valid(node);
-}
+        // Open a new decision.
+        e->decisions[e->num_decisions] = e->trail_size;
+        e->flipped[e->num_decisions++] = 0;
+        COUNT_ADD(e->nodes, 1);
+        COUNT_MAX(e->max_depth, e->num_decisions);
+        engine_assign(e, lit, -1);
 
-// Given a partial assignment vector, for which a subset of the first propositions have values, 
-// this function pushes up to two new vectors to the frontier, which concern giving to the first unassigned 
-// proposition the values true=1 and false=-1, after checking that the new vectors are valid.
-void generate_children(struct frontier_node *node)
-{
-    int i;
-    int *vector = node->vector;
-
-    // Find the first proposition with no assigned value.
-    for (i = 0; i < N && vector[i] != 0; i++);
-
-    vector[i] = -1;
-    struct frontier_node *negative = (struct frontier_node*) malloc(sizeof(struct frontier_node));
-    negative->vector = (int*)malloc(N * sizeof(int));
-    if (negative == NULL || negative->vector == NULL) {
-        mem_error = -1;
-        return;
-    }
-    copy(vector, negative->vector);
-    // Check whether a "false" assignment is acceptable...
-    if (valid(negative)) {
-        // ...and pushes it to the frontier.
-        add_to_frontier(negative);
-    }
+        // Let the owner of the engine stop the search or take over part of it.
+        if ((e->nodes & 1023) == 0 && e->stop != NULL && __atomic_load_n(e->stop, __ATOMIC_ACQUIRE)) {
+            return -1;
+        }
+        if (e->split != NULL) {
+            e->split(e);
+        }
 
-    vector[i] = 1;
-    struct frontier_node *positive = (struct frontier_node*) malloc(sizeof(struct frontier_node));
-    positive->vector = (int*)malloc(N * sizeof(int));
-    if (positive == NULL || positive->vector == NULL) {
-        mem_error = -1;
-        return;
-    }
-    copy(vector, positive->vector);
-    // Check whether a "true" assignment is acceptable...
-    if (valid(positive)) {
-        // ...and pushes it to the frontier.
-        add_to_frontier(positive);
+        while ((ok = consistent(e)) <= 0) {
+            if (ok < 0) {
+                return -1;
+            }
+            // Backtrack to the deepest decision whose other value has not been tried.
+            while (e->num_decisions > 0 && e->flipped[e->num_decisions - 1]) {
+                e->num_decisions--;
+            }
+            if (e->num_decisions == 0) {
+                engine_undo(e, base);
+                return 0;
+            }
+
+            d = e->num_decisions - 1;
+            lit = e->trail[e->decisions[d]];
+            engine_undo(e, e->decisions[d]);
+            e->flipped[d] = 1;
+            engine_assign(e, -lit, -1);
+        }
     }
 }
 
-// This function implements the searching algorithm we've used,
-// checking the frontier head if it's a solution, otherwise creating its
-// children and pushes them to the frontier.
-struct frontier_node *search()
+// This function implements the searching algorithm we've used: a depth-first search from
+// the empty assignment. With the default heuristic it branches on the first unassigned
+// proposition, true first. Returns 1 when the engine's assignment is a solution, 0 if no
+// solution exists.
+int search(struct engine *e)
 {
-    struct frontier_node *current_node;
-
-    // Initializing the frontier.
-    struct frontier_node *root = (struct frontier_node*) malloc(sizeof(struct frontier_node));
-    root->vector = (int*)malloc(N * sizeof(int));
-    if (root == NULL || root->vector == NULL) {
-        mem_error = -1;
-        return NULL;
-    }
-    for (int i = 0; i < N; i++) {
-        root->vector[i] = 0;
-    }
+    int found = 0;
 
-    generate_children(root);
+    t1 = wall_clock();
 
-    t1 = clock();
+    e->num_decisions = 0;
+    found = consistent(e);
+    if (found > 0) {
+        found = dfs(e);
+    }
 
-    // While the frontier is not empty...
-    while (head != NULL) {
-        // Extract the first node from the frontier.
-        current_node = head;
+    t2 = wall_clock();
 
-        // If it is a solution return it.
-        if (solution(current_node)) {
-            t2 = clock();
-            return current_node;
-        }
+    return found;
+}
 
-        // Generate its children.
-        generate_children(current_node);
-
-        // Shift frontier head
-        if (current_node->previous != NULL) {
-            // Current node is no longer frontier head, so we link
-            // its previous with its next node.
-            current_node->previous->next = current_node->next;
-        } else {
-            // Node is still frontier head, so we move to next one.
-            head = current_node->next;
-            if (head != NULL) {
-                head->previous = NULL;
+// Searches the cubes one after the other with the depth-first search of the engine, from
+// the values of each cube. Returns 1 when the engine's assignment is a solution and 0 if
+// no cube has one.
+int search_cubes(struct engine *e)
+{
+    int i, j, found = 0;
+    struct timespec start, end;
+
+    t1 = wall_clock();
+
+    for (i = 0; i < num_cubes && !found; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        engine_undo(e, 0);
+        e->num_decisions = 0;
+        for (j = cube_offsets[i]; j < cube_offsets[i + 1] && literal_value(e, cube_lits[j]) != -1; j++) {
+            if (literal_value(e, cube_lits[j]) == 0) {
+                engine_assign(e, cube_lits[j], -1);
             }
         }
-
-        // Free node.
-        free(current_node);
+        if (j == cube_offsets[i + 1]) {
+            found = consistent(e);
+            if (found > 0) {
+                found = dfs(e);
+            }
+        }
+        cube_result[i] = found;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        cube_time[i] = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
     }
 
-    t2 = clock();
+    t2 = wall_clock();
 
-    return NULL;
+    return found;
 }
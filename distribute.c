@@ -0,0 +1,581 @@
+// -----------------------------------------------------------------------
+//
+// Multi-process solving. A coordinator loads the problem, splits it into
+// cubes with the lookahead cuber and hands them out to worker processes
+// over Unix-domain or TCP sockets; workers may run on other machines, or be
+// spawned on the same one. Every worker receives the problem itself, so no
+// file has to be shared, and solves one cube at a time with clause learning,
+// the cube as assumptions. A worker that finishes a cube gets the next one,
+// the cube of a worker that leaves goes back to the others, and the first
+// model found stops every worker.
+//
+// Messages are length-prefixed: a 32-bit length (in bytes, of what follows),
+// a 32-bit type, then 32-bit integers, all in network byte order.
+//
+// -----------------------------------------------------------------------
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define MSG_PROBLEM 1       // Coordinator to worker: N, K, M, Offsets and Problem.
+#define MSG_READY   2       // Worker to coordinator: the problem is loaded.
+#define MSG_CUBE    3       // Coordinator to worker: index and literals of a cube to solve.
+#define MSG_RESULT  4       // Worker to coordinator: index, result and nodes of a cube, then the solution if any.
+#define MSG_STOP    5       // Coordinator to worker: stop searching and exit.
+#define MSG_MAX_BYTES (1 << 30) // Longest message accepted.
+#define WATCH_INTERVAL 50   // Milliseconds between two checks of a searching worker's socket.
+
+// Connection of the coordinator to a worker.
+struct connection {
+    int fd;                 // Socket of the worker, -1 once it left.
+    int ready;              // Set once the worker loaded the problem.
+    int cube;               // Cube being solved by the worker, -1 if it is idle.
+    struct timespec start;  // Wall time at which the cube was sent.
+    unsigned long cubes_done; // Number of cubes solved by the worker.
+    unsigned long nodes;    // Nodes expanded by the worker.
+};
+
+// Flags shared by a worker and its watcher thread, always accessed atomically.
+int worker_stop;            // Set when the coordinator asks a searching worker to stop.
+int worker_searching;       // Set while the worker searches a cube.
+int worker_done;            // Set when the worker exits.
+
+// Sends a message of count integers. Returns 0, or -1 on error.
+int send_message(int fd, int type, int *data, int count)
+{
+    uint32_t *buf = (uint32_t*)malloc((count + 2) * sizeof(uint32_t));
+    int err;
+
+    if (buf == NULL) {
+        report("Error: malloc for message failed.\n");
+        return -1;
+    }
+    buf[0] = htonl((count + 1) * sizeof(uint32_t));
+    buf[1] = htonl(type);
+    for (int i = 0; i < count; i++) {
+        buf[i + 2] = htonl((uint32_t)data[i]);
+    }
+    err = write_all(fd, buf, (count + 2) * sizeof(uint32_t));
+    free(buf);
+
+    return err;
+}
+
+// Receives a message and stores its type and number of integers. Returns the integers, to
+// be freed by the caller, or NULL on error or end of stream.
+int *receive_message(int fd, int *type, int *count)
+{
+    uint32_t header[2];
+    int *data;
+
+    if (read_all(fd, header, sizeof(header)) < 0) {
+        return NULL;
+    }
+    header[0] = ntohl(header[0]);
+    if (header[0] < sizeof(uint32_t) || header[0] > MSG_MAX_BYTES || header[0] % sizeof(uint32_t) != 0) {
+        return NULL;
+    }
+    *type = ntohl(header[1]);
+    *count = header[0] / sizeof(uint32_t) - 1;
+    data = (int*)malloc((*count > 0 ? *count : 1) * sizeof(int));
+    if (data == NULL || read_all(fd, data, *count * sizeof(int)) < 0) {
+        free(data);
+        return NULL;
+    }
+    for (int i = 0; i < *count; i++) {
+        data[i] = (int)ntohl((uint32_t)data[i]);
+    }
+
+    return data;
+}
+
+// Opens a socket on an address, unix:<path> or tcp:<host>:<port>, listening on it for the
+// coordinator and connected to it for a worker. Returns the socket, or -1 on error.
+int open_socket(char *address, int listening)
+{
+    int fd = -1;
+
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(address + 5) >= sizeof(addr.sun_path)) {
+            report("Socket path %s is too long. Program terminates.\n", address + 5);
+            return -1;
+        }
+        strcpy(addr.sun_path, address + 5);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && listening) {
+            unlink(addr.sun_path);
+            if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+                close(fd);
+                fd = -1;
+            }
+        } else if (fd >= 0 && connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else if (strncmp(address, "tcp:", 4) == 0) {
+        char host[256];
+        char *port = strrchr(address + 4, ':');
+        struct addrinfo hints, *res, *ai;
+        if (port == NULL || port - (address + 4) >= (int)sizeof(host)) {
+            report("Wrong address %s, use tcp:<host>:<port>. Program terminates.\n", address);
+            return -1;
+        }
+        memcpy(host, address + 4, port - (address + 4));
+        host[port - (address + 4)] = '\0';
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = listening ? AI_PASSIVE : 0;
+        if (getaddrinfo(host[0] != '\0' ? host : NULL, port + 1, &hints, &res) != 0) {
+            report("Cannot resolve address %s. Program terminates.\n", address);
+            return -1;
+        }
+        for (ai = res; ai != NULL && fd < 0; ai = ai->ai_next) {
+            int one = 1;
+            fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            if (listening) {
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+                if (bind(fd, ai->ai_addr, ai->ai_addrlen) < 0 || listen(fd, SOMAXCONN) < 0) {
+                    close(fd);
+                    fd = -1;
+                }
+            } else {
+                if (connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+                    close(fd);
+                    fd = -1;
+                } else {
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                }
+            }
+        }
+        freeaddrinfo(res);
+    } else {
+        report("Wrong address %s, use unix:<path> or tcp:<host>:<port>. Program terminates.\n", address);
+        return -1;
+    }
+
+    if (fd < 0) {
+        report("Cannot %s %s. Program terminates.\n", listening ? "listen on" : "connect to", address);
+    }
+
+    return fd;
+}
+
+// Thread function of a worker that watches its socket while it searches: the coordinator
+// only writes to a searching worker to stop it, so a readable socket stops the search.
+void *worker_watch(void *arg)
+{
+    struct pollfd p;
+
+    p.fd = *(int*)arg;
+    p.events = POLLIN;
+    while (!__atomic_load_n(&worker_done, __ATOMIC_ACQUIRE)) {
+        p.revents = 0;
+        if (poll(&p, 1, WATCH_INTERVAL) > 0 && __atomic_load_n(&worker_searching, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&worker_stop, 1, __ATOMIC_RELEASE);
+        }
+        if (p.revents != 0 && !__atomic_load_n(&worker_searching, __ATOMIC_ACQUIRE)) {
+            // Let the worker read the message before looking again.
+            struct timespec pause = {0, WATCH_INTERVAL * 1000000L};
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+// Builds p from the integers of a problem message: N, K, M, Offsets and Problem. The message
+// is checked in full first, so that a malformed one cannot index out of bounds: N positive
+// and small enough for a model to fit in a result message, K at most the integers sent, M
+// positive unless there is no clause, Offsets starting from 0 and growing by 1 to M literals
+// per clause up to the literals sent, and every literal nonzero with a proposition of at most
+// N. Returns 0, or -1 if the message is malformed or memory is exhausted.
+int problem_from_message(struct problem *p, int *msg, int count)
+{
+    int i, n, k, m;
+    int *offsets, *lits;
+
+    memset(p, 0, sizeof(struct problem));
+    if (count < 4) {
+        return -1;
+    }
+    n = msg[0];
+    k = msg[1];
+    m = msg[2];
+    if (n <= 0 || n > MSG_MAX_BYTES / (int)sizeof(int) - 4 || k < 0 || k > count - 4 || m < 0 || (m == 0 && k > 0)) {
+        return -1;
+    }
+    offsets = msg + 3;
+    lits = msg + 4 + k;
+    if (offsets[0] != 0 || offsets[k] != count - 4 - k) {
+        return -1;
+    }
+    for (i = 0; i < k; i++) {
+        if (offsets[i + 1] <= offsets[i] || offsets[i + 1] - offsets[i] > m) {
+            return -1;
+        }
+    }
+    for (i = 0; i < offsets[k]; i++) {
+        if (lits[i] == 0 || lits[i] < -n || lits[i] > n) {
+            return -1;
+        }
+    }
+
+    p->Offsets = (int*)malloc((k + 1) * sizeof(int));
+    p->Problem = (int*)malloc((offsets[k] > 0 ? offsets[k] : 1) * sizeof(int));
+    if (p->Offsets == NULL || p->Problem == NULL) {
+        report("Error: malloc for worker failed.\n");
+        problem_free(p);
+        return -1;
+    }
+    memcpy(p->Offsets, offsets, (k + 1) * sizeof(int));
+    memcpy(p->Problem, lits, offsets[k] * sizeof(int));
+    p->N = n;
+    p->K = k;
+    p->M = m;
+
+    return 0;
+}
+
+// Worker process: loads the problem sent by the coordinator at address, then solves the
+// cubes it is sent until it is stopped. Returns 0, or -1 on error.
+int run_worker(char *address)
+{
+    int fd, type, count, found, err = 0;
+    int *msg = NULL, *reply;
+    unsigned long nodes;
+    pthread_t watcher;
+    struct engine e;
+
+    fd = open_socket(address, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // The problem is the first message.
+    msg = receive_message(fd, &type, &count);
+    if (msg == NULL || type != MSG_PROBLEM || problem_from_message(&input, msg, count) < 0) {
+        report("Worker: wrong problem message from %s. Program terminates.\n", address);
+        return -1;
+    }
+    reply = (int*)malloc((input.N + 4) * sizeof(int));
+    if (reply == NULL) {
+        report("Error: malloc for worker failed.\n");
+        return -1;
+    }
+    free(msg);
+    msg = NULL;
+    if (engine_init(&e, &input) < 0 || heuristic_init(&e, HEURISTIC_VSIDS, 1) < 0) {
+        return -1;
+    }
+    e.stop = &worker_stop;
+
+    __atomic_store_n(&worker_done, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&worker_searching, 0, __ATOMIC_RELEASE);
+    if (pthread_create(&watcher, NULL, worker_watch, &fd) != 0) {
+        report("Error: pthread_create failed.\n");
+        return -1;
+    }
+    if (send_message(fd, MSG_READY, NULL, 0) < 0) {
+        err = -1;
+    }
+
+    // Solve cubes until the coordinator stops the worker or goes away.
+    while (err == 0 && (msg = receive_message(fd, &type, &count)) != NULL && type == MSG_CUBE && count >= 1) {
+        backjump(&e, 0);
+        if (set_assumptions(&e, msg + 1, count - 1) < 0) {
+            report("Worker: wrong cube message from %s. Program terminates.\n", address);
+            err = -1;
+            break;
+        }
+        nodes = e.nodes;
+        __atomic_store_n(&worker_stop, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&worker_searching, 1, __ATOMIC_RELEASE);
+        found = cdcl_search(&e);
+        __atomic_store_n(&worker_searching, 0, __ATOMIC_RELEASE);
+        if (found < 0) {
+            // Stopped: the stop message is read next. Otherwise memory is exhausted.
+            err = __atomic_load_n(&worker_stop, __ATOMIC_ACQUIRE) ? 0 : -1;
+            free(msg);
+            msg = NULL;
+            continue;
+        }
+
+        nodes = e.nodes - nodes;
+        reply[0] = msg[0];
+        reply[1] = found;
+        reply[2] = (int)(nodes & 0xFFFFFFFFUL);
+        reply[3] = (int)(nodes >> 32);
+        if (found) {
+            memcpy(reply + 4, e.assignment, e.N * sizeof(int));
+        }
+        free(msg);
+        msg = NULL;
+        if (send_message(fd, MSG_RESULT, reply, found ? e.N + 4 : 4) < 0) {
+            break;
+        }
+    }
+    free(msg);
+
+    __atomic_store_n(&worker_done, 1, __ATOMIC_RELEASE);
+    pthread_join(watcher, NULL);
+    close(fd);
+    engine_free(&e);
+    free(reply);
+
+    return err;
+}
+
+// Sends the next pending cube to an idle worker, if any. Returns -1 if the worker left.
+int assign_cube(struct connection *c, int *pending, int *num_pending)
+{
+    int i, size, err;
+    int *msg;
+
+    if (c->fd < 0 || !c->ready || c->cube >= 0 || *num_pending == 0) {
+        return 0;
+    }
+    i = pending[--(*num_pending)];
+    size = cube_offsets[i + 1] - cube_offsets[i];
+    msg = (int*)malloc((size + 1) * sizeof(int));
+    if (msg == NULL) {
+        report("Error: malloc for message failed.\n");
+        pending[(*num_pending)++] = i;
+        return -1;
+    }
+    msg[0] = i;
+    memcpy(msg + 1, cube_lits + cube_offsets[i], size * sizeof(int));
+    err = send_message(c->fd, MSG_CUBE, msg, size + 1);
+    free(msg);
+    if (err < 0) {
+        pending[(*num_pending)++] = i;
+        return -1;
+    }
+    c->cube = i;
+    clock_gettime(CLOCK_MONOTONIC, &c->start);
+
+    return 0;
+}
+
+// Coordinator: splits a problem into cubes, listens on address, spawns the given number of
+// local workers and hands the cubes out to every worker that connects. Returns 1 and stores
+// the solution in vector, 0 if no solution exists and -1 on error.
+int coordinate(struct problem *p, char *address, int workers, int *vector)
+{
+    int i, type, count, listen_fd, live, remaining, num_pending;
+    int found = 0, error = 0, spawned = 0, exited = 0;
+    int num_conns = 0, conns_capacity = 16;
+    int *msg, *problem_msg, *pending;
+    struct connection *conns;
+    struct pollfd *fds;
+    struct timespec start, cubed, end, now;
+    char connect_arg[256];
+
+    signal(SIGPIPE, SIG_IGN);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    t1 = wall_clock();
+
+    if (make_cubes(p) < 0 || cube_results_init() < 0) {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &cubed);
+
+    pending = (int*)malloc((num_cubes + 1) * sizeof(int));
+    conns = (struct connection*)malloc(conns_capacity * sizeof(struct connection));
+    fds = (struct pollfd*)malloc((conns_capacity + 1) * sizeof(struct pollfd));
+    problem_msg = (int*)malloc((4 + p->K + p->Offsets[p->K]) * sizeof(int));
+    if (pending == NULL || conns == NULL || fds == NULL || problem_msg == NULL) {
+        report("Error: malloc for coordinator failed.\n");
+        return -1;
+    }
+    problem_msg[0] = p->N;
+    problem_msg[1] = p->K;
+    problem_msg[2] = p->M;
+    memcpy(problem_msg + 3, p->Offsets, (p->K + 1) * sizeof(int));
+    memcpy(problem_msg + 4 + p->K, p->Problem, p->Offsets[p->K] * sizeof(int));
+
+    // The first cubes are handed out first.
+    for (i = 0; i < num_cubes; i++) {
+        pending[i] = num_cubes - 1 - i;
+    }
+    num_pending = num_cubes;
+    remaining = num_cubes;
+
+    listen_fd = -1;
+    if (remaining > 0) {
+        listen_fd = open_socket(address, 1);
+        if (listen_fd < 0) {
+            return -1;
+        }
+        snprintf(connect_arg, sizeof(connect_arg), "--connect=%s", address);
+        for (i = 0; i < workers; i++) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(listen_fd);
+                execl("/proc/self/exe", "sat_CPU", connect_arg, (char*)NULL);
+                _exit(127);
+            }
+            if (pid > 0) {
+                spawned++;
+            }
+        }
+    }
+
+    while (remaining > 0 && !found && !error) {
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        for (i = 0; i < num_conns; i++) {
+            fds[i + 1].fd = conns[i].fd;
+            fds[i + 1].events = POLLIN;
+            fds[i + 1].revents = 0;
+        }
+        // Spawned workers are checked once a second, in case they all die before connecting.
+        if (poll(fds, num_conns + 1, spawned > 0 ? 1000 : -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            report("Error: poll failed.\n");
+            error = 1;
+            break;
+        }
+
+        // A new worker gets the problem.
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listen_fd, NULL, NULL);
+            if (fd >= 0) {
+                if (num_conns == conns_capacity) {
+                    conns_capacity *= 2;
+                    conns = (struct connection*)realloc(conns, conns_capacity * sizeof(struct connection));
+                    fds = (struct pollfd*)realloc(fds, (conns_capacity + 1) * sizeof(struct pollfd));
+                    if (conns == NULL || fds == NULL) {
+                        report("Error: malloc for coordinator failed.\n");
+                        return -1;
+                    }
+                }
+                memset(&conns[num_conns], 0, sizeof(struct connection));
+                conns[num_conns].fd = fd;
+                conns[num_conns].cube = -1;
+                if (send_message(fd, MSG_PROBLEM, problem_msg, 4 + p->K + p->Offsets[p->K]) < 0) {
+                    close(fd);
+                    conns[num_conns].fd = -1;
+                }
+                num_conns++;
+            }
+        }
+
+        for (i = 0; i < num_conns && !found; i++) {
+            struct connection *c = &conns[i];
+            if (c->fd < 0 || !(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            msg = receive_message(c->fd, &type, &count);
+            if (msg != NULL && type == MSG_READY) {
+                c->ready = 1;
+            } else if (msg != NULL && type == MSG_RESULT && count >= 4 && msg[0] == c->cube &&
+                       (msg[1] == 0 || msg[1] == 1) && count == (msg[1] ? p->N + 4 : 4) &&
+                       (msg[1] == 0 || problem_satisfied(p, msg + 4))) {
+                // A model is only accepted once it is checked against the clauses.
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                cube_result[c->cube] = msg[1];
+                cube_time[c->cube] = (now.tv_sec - c->start.tv_sec) + (now.tv_nsec - c->start.tv_nsec) / 1e9;
+                c->nodes += (unsigned long)(unsigned int)msg[2] | ((unsigned long)(unsigned int)msg[3] << 32);
+                c->cubes_done++;
+                c->cube = -1;
+                remaining--;
+                if (msg[1]) {
+                    memcpy(vector, msg + 4, p->N * sizeof(int));
+                    found = 1;
+                }
+            } else {
+                // The worker left or broke the protocol: its cube goes back to the others.
+                if (c->cube >= 0) {
+                    pending[num_pending++] = c->cube;
+                    c->cube = -1;
+                }
+                close(c->fd);
+                c->fd = -1;
+            }
+            free(msg);
+        }
+
+        // Hand the pending cubes out to the idle workers.
+        for (i = 0, live = 0; i < num_conns; i++) {
+            if (!found && assign_cube(&conns[i], pending, &num_pending) < 0) {
+                close(conns[i].fd);
+                conns[i].fd = -1;
+            }
+            live += (conns[i].fd >= 0);
+        }
+
+        // Without workers left once the spawned ones are all gone, nobody else is expected.
+        while (exited < spawned && waitpid(-1, NULL, WNOHANG) > 0) {
+            exited++;
+        }
+        if (live == 0 && spawned > 0 && exited == spawned) {
+            report("Error: every worker left before the problem was solved.\n");
+            error = 1;
+        }
+    }
+
+    // Stop every worker, the searching ones through their sockets.
+    for (i = 0; i < num_conns; i++) {
+        if (conns[i].fd >= 0) {
+            send_message(conns[i].fd, MSG_STOP, NULL, 0);
+            close(conns[i].fd);
+        }
+    }
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        if (strncmp(address, "unix:", 5) == 0) {
+            unlink(address + 5);
+        }
+    }
+    for (; exited < spawned; exited++) {
+        waitpid(-1, NULL, 0);
+    }
+
+    t2 = wall_clock();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Report the cubes, how long each took, and how the work was spread over the workers.
+    double lookahead_time = (cubed.tv_sec - start.tv_sec) + (cubed.tv_nsec - start.tv_nsec) / 1e9;
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    unsigned long nodes = 0;
+    report("\nCoordinator on %s, %d workers connected, %d cubes:\n", address, num_conns, num_cubes);
+    report("    Lookahead: %0.3f secs, %lu failed literals, %lu cubes refuted\n", lookahead_time, cube_failed, cube_refuted);
+    report_cubes();
+    for (i = 0; i < num_conns; i++) {
+        report("    Worker %d: %lu nodes, %lu cubes solved\n", i, conns[i].nodes, conns[i].cubes_done);
+        nodes += conns[i].nodes;
+    }
+    report("    Wall time: %0.3f secs\n", wall);
+    engine.nodes = nodes;
+
+    free(conns);
+    free(fds);
+    free(pending);
+    free(problem_msg);
+    free(cube_result);
+    free(cube_time);
+    free(cube_lits);
+    free(cube_offsets);
+
+    if (error) {
+        return -1;
+    }
+
+    return found;
+}
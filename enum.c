@@ -0,0 +1,108 @@
+// -----------------------------------------------------------------------
+//
+// Exhaustive enumeration on the GPU. Instead of driving the device one
+// search node at a time, every work item evaluates one complete assignment
+// with the clenum kernel. The 2^N assignments are handed to the device in
+// chunks, in the order of the depth-first search, and each chunk reports
+// the smallest satisfying number it holds, so the first chunk with a
+// solution gives the solution the depth-first search would find. Every
+// chunk is split into consecutive ranges, one per device, sized by the
+// throughput of the devices; the first range with a solution holds the
+// smallest one of the chunk.
+//
+// -----------------------------------------------------------------------
+
+#define ENUM_AUTO_N 32         // Problems with at most this many propositions are enumerated by default.
+#define ENUM_MAX_N 62          // Largest number of propositions that can be enumerated.
+#define ENUM_CHUNK (1 << 20)   // Assignments evaluated per kernel launch.
+
+// Enumerates every complete assignment of problem p, which the devices hold, on the device.
+// Returns 1 and stores the first satisfying assignment in vector, 0 if no solution exists
+// and -1 on error.
+int enumerate(struct problem *p, int *vector)
+{
+    int N = p->N;
+    const cl_uint none = 0xFFFFFFFF; // Value of found when a chunk has no solution.
+    cl_uint *found;
+    struct work chunk;
+    cl_ulong base, count, total, first;
+    size_t enumWorkSize[1];
+    int i;
+
+    if (N > ENUM_MAX_N) {
+        report("Too many propositions for exhaustive enumeration. Program terminates.\n");
+        return -1;
+    }
+    found = (cl_uint*)malloc(num_devs * sizeof(cl_uint));
+    if (found == NULL || work_init(&chunk) < 0) {
+        report("Memory exhausted. Program terminates.\n");
+        return -1;
+    }
+
+    t1 = wall_clock();
+
+    total = 1ULL << N;
+    for (base = 0; base < total; base += count) {
+        count = (total - base < ENUM_CHUNK) ? total - base : ENUM_CHUNK;
+
+        struct timespec S_idle_timer;
+        clock_gettime(CLOCK_MONOTONIC, &S_idle_timer);
+
+        split_work(&chunk, count);
+        first = base;
+        for (i = 0; i < num_devs; i++) {
+            struct device *d = &devs[i];
+            if (chunk.share[i] == 0) {
+                continue;
+            }
+
+            status = clEnqueueFillBuffer(d->queue[0], d->d_found, &none, sizeof(cl_uint), 0, sizeof(cl_uint), 0, NULL, &chunk.first[i]);
+            status |= clSetKernelArg(d->enum_kernel, 3, sizeof(cl_ulong), &first);
+            if (status != CL_SUCCESS) {
+                report("clEnqueueFillBuffer failed\n");
+                return -1;
+            }
+
+            // Run kernel over the device's range of the chunk.
+            enumWorkSize[0] = chunk.share[i];
+            status = clEnqueueNDRangeKernel(d->queue[0], d->enum_kernel, 1, NULL, enumWorkSize, NULL, 0, NULL, &chunk.run[i]);
+            if (status != CL_SUCCESS) {
+                report("clEnqueueNDRangeKernel failed\n");
+                return -1;
+            }
+
+            // Copy back the smallest satisfying number to the host.
+            status = clEnqueueReadBuffer(d->queue[0], d->d_found, CL_FALSE, 0, sizeof(cl_uint), &found[i], 0, NULL, &chunk.last[i]);
+            if (status != CL_SUCCESS) {
+                report("clEnqueueReadBuffer failed\n");
+                return -1;
+            }
+            clFlush(d->queue[0]);
+            bytes_from_device += sizeof(cl_uint);
+            first += chunk.share[i];
+        }
+
+        add_kernel_times(&S_idle_timer, merge_work(&chunk));
+
+        // The ranges follow the order of the devices.
+        first = base;
+        for (i = 0; i < num_devs; i++) {
+            if (chunk.share[i] > 0 && found[i] != none) {
+                for (int j = 0; j < N; j++) {
+                    vector[j] = (((first + found[i]) >> (N - 1 - j)) & 1) ? -1 : 1;
+                }
+                t2 = wall_clock();
+                free(found);
+                work_free(&chunk);
+                return 1;
+            }
+            first += chunk.share[i];
+        }
+    }
+
+    t2 = wall_clock();
+    free(found);
+    work_free(&chunk);
+
+    return 0;
+}
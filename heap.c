@@ -0,0 +1,117 @@
+// -----------------------------------------------------------------------
+//
+// Binary max-heap of propositions ordered by a key table, used by the
+// decision heuristics to find the unassigned proposition of highest score.
+// Ties are broken in favour of the lower proposition index.
+//
+// -----------------------------------------------------------------------
+
+// Heap structure.
+struct heap {
+    int *heap;      // Propositions in heap order.
+    int *index;     // Position of each proposition in the heap, -1 if absent.
+    int size;       // Number of propositions in the heap.
+    double *key;    // Key of each proposition.
+};
+
+// Allocates an empty heap for n propositions ordered by key.
+int heap_init(struct heap *h, int n, double *key)
+{
+    h->heap = (int*)malloc(n * sizeof(int));
+    h->index = (int*)malloc(n * sizeof(int));
+    if (h->heap == NULL || h->index == NULL) {
+        report("Error: malloc for heap failed.\n");
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        h->index[i] = -1;
+    }
+    h->size = 0;
+    h->key = key;
+
+    return 0;
+}
+
+// Releases the heap tables.
+void heap_free(struct heap *h)
+{
+    free(h->heap);
+    free(h->index);
+}
+
+// Checks whether proposition a must be above proposition b.
+int heap_before(struct heap *h, int a, int b)
+{
+    return h->key[a] > h->key[b] || (h->key[a] == h->key[b] && a < b);
+}
+
+// Moves the proposition at position i up to its place.
+void heap_up(struct heap *h, int i)
+{
+    int v = h->heap[i];
+
+    while (i > 0 && heap_before(h, v, h->heap[(i - 1) / 2])) {
+        h->heap[i] = h->heap[(i - 1) / 2];
+        h->index[h->heap[i]] = i;
+        i = (i - 1) / 2;
+    }
+    h->heap[i] = v;
+    h->index[v] = i;
+}
+
+// Moves the proposition at position i down to its place.
+void heap_down(struct heap *h, int i)
+{
+    int child;
+    int v = h->heap[i];
+
+    while (2 * i + 1 < h->size) {
+        child = 2 * i + 1;
+        if (child + 1 < h->size && heap_before(h, h->heap[child + 1], h->heap[child])) {
+            child++;
+        }
+        if (!heap_before(h, h->heap[child], v)) {
+            break;
+        }
+        h->heap[i] = h->heap[child];
+        h->index[h->heap[i]] = i;
+        i = child;
+    }
+    h->heap[i] = v;
+    h->index[v] = i;
+}
+
+// Inserts a proposition that is not in the heap.
+void heap_insert(struct heap *h, int v)
+{
+    if (h->index[v] >= 0) {
+        return;
+    }
+    h->heap[h->size] = v;
+    h->index[v] = h->size++;
+    heap_up(h, h->size - 1);
+}
+
+// Removes and returns the proposition of highest key, or -1 if the heap is empty.
+int heap_pop(struct heap *h)
+{
+    if (h->size == 0) {
+        return -1;
+    }
+    int v = h->heap[0];
+    h->index[v] = -1;
+    if (--h->size > 0) {
+        h->heap[0] = h->heap[h->size];
+        heap_down(h, 0);
+    }
+
+    return v;
+}
+
+// Restores the heap order after the key of a proposition increased.
+void heap_increased(struct heap *h, int v)
+{
+    if (h->index[v] >= 0) {
+        heap_up(h, h->index[v]);
+    }
+}
@@ -0,0 +1,172 @@
+// -----------------------------------------------------------------------
+//
+// Decision heuristics. The engine either branches on the first unassigned
+// proposition, as the original search did, or keeps the unassigned
+// propositions in a heap ordered by a score: the conflict activity of VSIDS,
+// or the static Jeroslow-Wang or MOMS scores computed once from Problem.
+// With phase saving a decision reuses the last value of its proposition.
+//
+// -----------------------------------------------------------------------
+
+#define VAR_DECAY 0.95  // Decay factor of VSIDS activities.
+#define MOMS_WEIGHT 10  // MOMS weights the sum of occurrences by 2^MOMS_WEIGHT.
+
+// Converts the name of a heuristic to its HEURISTIC_* value, -1 if it is unknown.
+int heuristic_from_name(char *name)
+{
+    if (strcmp(name, "first") == 0) {
+        return HEURISTIC_FIRST;
+    } else if (strcmp(name, "vsids") == 0) {
+        return HEURISTIC_VSIDS;
+    } else if (strcmp(name, "jw") == 0) {
+        return HEURISTIC_JW;
+    } else if (strcmp(name, "moms") == 0) {
+        return HEURISTIC_MOMS;
+    }
+
+    return -1;
+}
+
+// Sets the decision heuristic of an initialized engine and computes its scores.
+int heuristic_init(struct engine *e, int heuristic, int phase_saving)
+{
+    int i, j, size, min_size;
+    int *lits;
+
+    e->heuristic = heuristic;
+    e->phase_saving = phase_saving;
+    e->var_increment = 1.0;
+    e->activity = (double*)calloc(e->N, sizeof(double));
+    e->lit_score = (double*)calloc(2 * e->N, sizeof(double));
+    e->saved_phase = (int*)calloc(e->N, sizeof(int));
+    if (e->activity == NULL || e->lit_score == NULL || e->saved_phase == NULL) {
+        report("Error: malloc for heuristic failed.\n");
+        return -1;
+    }
+
+    if (heuristic == HEURISTIC_JW) {
+        // Every clause adds 2^-size to the score of its literals.
+        for (i = 0; i < e->K; i++) {
+            lits = clause_literals(e->p, i, &size);
+            for (j = 0; j < size; j++) {
+                e->lit_score[LIT_INDEX(lits[j])] += ldexp(1.0, -size);
+            }
+        }
+        for (i = 0; i < e->N; i++) {
+            e->activity[i] = e->lit_score[2 * i] + e->lit_score[2 * i + 1];
+        }
+    } else if (heuristic == HEURISTIC_MOMS) {
+        // Count the occurrences of every literal in the clauses of minimum size.
+        for (i = 0, min_size = -1; i < e->K; i++) {
+            clause_literals(e->p, i, &size);
+            if (min_size < 0 || size < min_size) {
+                min_size = size;
+            }
+        }
+        for (i = 0; i < e->K; i++) {
+            lits = clause_literals(e->p, i, &size);
+            if (size == min_size) {
+                for (j = 0; j < size; j++) {
+                    e->lit_score[LIT_INDEX(lits[j])] += 1.0;
+                }
+            }
+        }
+        for (i = 0; i < e->N; i++) {
+            double positive = e->lit_score[2 * i];
+            double negative = e->lit_score[2 * i + 1];
+            e->activity[i] = ldexp(positive + negative, MOMS_WEIGHT) + positive * negative;
+        }
+    }
+
+    if (heuristic != HEURISTIC_FIRST) {
+        if (heap_init(&e->order, e->N, e->activity) < 0) {
+            return -1;
+        }
+        for (i = 0; i < e->N; i++) {
+            if (e->assignment[i] == 0) {
+                heap_insert(&e->order, i);
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Diversifies the decisions of an engine with numbers drawn from rand(): every proposition
+// gets a random saved value, used through phase saving, and its score grows by a random
+// fraction, so propositions of equal score are tried in a different order.
+void heuristic_randomize(struct engine *e)
+{
+    e->phase_saving = 1;
+    for (int i = 0; i < e->N; i++) {
+        e->saved_phase[i] = (rand() & 1) ? 1 : -1;
+        if (e->heuristic != HEURISTIC_FIRST) {
+            e->activity[i] += (e->activity[i] + e->var_increment) * 1e-3 * rand() / RAND_MAX;
+            heap_increased(&e->order, i);
+        }
+    }
+}
+
+// Increases the VSIDS activity of a proposition, rescaling all activities on overflow.
+void bump_variable(struct engine *e, int var)
+{
+    if (e->heuristic != HEURISTIC_VSIDS) {
+        return;
+    }
+    e->activity[var] += e->var_increment;
+    if (e->activity[var] > 1e100) {
+        for (int i = 0; i < e->N; i++) {
+            e->activity[i] *= 1e-100;
+        }
+        e->var_increment *= 1e-100;
+    }
+    heap_increased(&e->order, var);
+}
+
+// Makes older conflicts weigh less than the following ones.
+void decay_variables(struct engine *e)
+{
+    e->var_increment /= VAR_DECAY;
+}
+
+// Chooses the literal of the next decision, or returns 0 if every proposition has a value.
+int pick_branch_literal(struct engine *e)
+{
+    int var;
+
+    if (e->heuristic == HEURISTIC_FIRST) {
+        for (var = 0; var < e->N && e->assignment[var] != 0; var++);
+        if (var == e->N) {
+            return 0;
+        }
+    } else {
+        do {
+            var = heap_pop(&e->order);
+            if (var < 0) {
+                return 0;
+            }
+        } while (e->assignment[var] != 0);
+    }
+
+    // Reuse the saved value, else prefer the literal of higher static score, else true.
+    if (e->phase_saving && e->saved_phase[var] != 0) {
+        return e->saved_phase[var] * (var + 1);
+    }
+    if (e->lit_score[2 * var + 1] > e->lit_score[2 * var]) {
+        return -(var + 1);
+    }
+
+    return var + 1;
+}
+
+// Bumps the propositions of a conflicting clause, for searches that do not analyse conflicts.
+void bump_conflict(struct engine *e, int c)
+{
+    int size;
+    int *lits = engine_clause(e, c, &size);
+
+    for (int i = 0; i < size; i++) {
+        bump_variable(e, VAR(lits[i]));
+    }
+    decay_variables(e);
+}
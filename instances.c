@@ -0,0 +1,628 @@
+// -----------------------------------------------------------------------
+//
+// Many-instance mode. A list of problem files, or a stream of DIMACS
+// problems on standard input, is solved by one process that is set up
+// once: the OpenCL devices, contexts and programs are initialized a single
+// time and their buffers reused from one problem to the next. Every problem
+// is loaded into the input problem, handed to the search and released
+// once solved, and one result line per problem is written to standard
+// output, in input order:
+//
+//     <name> SAT|UNSAT|UNKNOWN|ERROR <seconds> [<model>]
+//
+// where the model, when requested, lists the propositions as signed
+// numbers. Independent problems can be solved concurrently by worker
+// processes, each set up once, which get the next problem as soon as they
+// answer the previous one. Everything else the searches print is dropped.
+//
+// The frontend defines instances_setup(), called once by every process
+// that solves problems, and search_instance(), called for each problem
+// once it is preprocessed.
+//
+// -----------------------------------------------------------------------
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define INSTANCE_UNKNOWN 2  // Result of a search that gave up without an answer.
+
+// Problem source of a many-instance run.
+struct source {
+    FILE *fp;               // List of problem files, or stream of problems.
+    int stream;             // Set if fp holds the problems themselves rather than their file names.
+    char *line;             // Line being read.
+    size_t line_capacity;   // Allocated size of line.
+    char *next;             // Problem line read ahead, which starts the next problem of the stream.
+    int count;              // Problems read so far.
+};
+
+// A problem to solve: its file name, or its text with a name made of its position in the stream.
+struct job {
+    int index;              // Position of the problem in the source, from 0.
+    char *name;             // File name, or stdin:<position from 1>.
+    char *text;             // Text of the problem, or NULL to read the file.
+    size_t size;            // Size of the text.
+};
+
+// Job header sent to a worker process, followed by the name and the text.
+struct job_header {
+    int32_t index;
+    int32_t name_size;
+    int64_t text_size;      // -1 when the worker reads the file itself.
+};
+
+// Worker process solving problems of a concurrent run.
+struct solver_process {
+    pid_t pid;              // The process, -1 once it is gone.
+    int fd;                 // Socket to the process.
+    struct job job;         // Problem being solved, with index -1 if the worker is idle.
+    int answered;           // Problems the worker answered.
+};
+
+int instance_jobs = 1;      // Worker processes solving problems concurrently, 1 to solve them in turn.
+int instance_models;        // If set, result lines end with the model.
+char **ordered_lines;       // Result lines waiting for those of earlier problems, by problem index.
+int ordered_capacity;       // Allocated size of ordered_lines.
+int ordered_next;           // Index of the next result line to write.
+unsigned long instance_counts[4]; // Problems found SAT, UNSAT, UNKNOWN and in error.
+
+void instances_setup(void);
+int search_instance(struct problem *p, int *vector);
+void output_error(struct job *j);
+
+// Opens the source of the problems: a list of files, one per line, or a stream of problems,
+// read from a file or from standard input if name is "-". Returns 0, or -1 on error.
+int source_open(struct source *s, char *name, int stream)
+{
+    memset(s, 0, sizeof(struct source));
+    s->stream = stream;
+    s->fp = (strcmp(name, "-") == 0) ? stdin : fopen(name, "r");
+    if (s->fp == NULL) {
+        report("Cannot open %s. Program terminates.\n", name);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Appends a line to the text of a job, growing it as needed. Returns 0, or -1 on error.
+int job_append(struct job *j, size_t *capacity, char *line, size_t length)
+{
+    if (j->size + length + 1 > *capacity) {
+        size_t grown_capacity = *capacity > 0 ? 2 * *capacity : 4096;
+        while (grown_capacity < j->size + length + 1) {
+            grown_capacity *= 2;
+        }
+        char *grown = (char*)realloc(j->text, grown_capacity);
+        if (grown == NULL) {
+            return -1;
+        }
+        j->text = grown;
+        *capacity = grown_capacity;
+    }
+    memcpy(j->text + j->size, line, length);
+    j->size += length;
+    j->text[j->size] = '\0';
+
+    return 0;
+}
+
+// Reads the next problem of a source. A list gives a file name per line, skipping empty
+// lines and lines starting with '#'. A stream gives DIMACS problems back to back, each
+// starting with its problem line. Returns 1, 0 at the end of the source, or -1 on error.
+int source_next(struct source *s, struct job *j)
+{
+    ssize_t length;
+    size_t capacity = 0;
+    int started = 0;
+    char name[32];
+
+    memset(j, 0, sizeof(struct job));
+    if (!s->stream) {
+        while ((length = getline(&s->line, &s->line_capacity, s->fp)) >= 0) {
+            while (length > 0 && (s->line[length - 1] == '\n' || s->line[length - 1] == '\r' ||
+                                  s->line[length - 1] == ' ' || s->line[length - 1] == '\t')) {
+                s->line[--length] = '\0';
+            }
+            if (length > 0 && s->line[0] != '#') {
+                j->index = s->count++;
+                j->name = strdup(s->line);
+                return j->name != NULL ? 1 : -1;
+            }
+        }
+        return 0;
+    }
+
+    // The problem line read ahead starts this problem, and the next one ends it. Comments
+    // before a problem line go with its problem.
+    if (s->next != NULL) {
+        if (job_append(j, &capacity, s->next, strlen(s->next)) < 0) {
+            return -1;
+        }
+        free(s->next);
+        s->next = NULL;
+        started = 1;
+    }
+    while ((length = getline(&s->line, &s->line_capacity, s->fp)) >= 0) {
+        if (s->line[0] == 'p') {
+            // Data before the problem line is a job of its own, reported as an error.
+            if (started || (j->text != NULL && skip_blanks(j->text, j->text + j->size, 1) < j->text + j->size)) {
+                s->next = strdup(s->line);
+                if (s->next == NULL) {
+                    return -1;
+                }
+                break;
+            }
+            started = 1;
+        }
+        if (job_append(j, &capacity, s->line, length) < 0) {
+            return -1;
+        }
+    }
+    // Data without a problem line is no DIMACS problem: it is passed on, to be reported as
+    // an error, unless it only holds comments.
+    if (!started && (j->text == NULL || skip_blanks(j->text, j->text + j->size, 1) == j->text + j->size)) {
+        free(j->text);
+        j->text = NULL;
+        return 0;
+    }
+    j->index = s->count++;
+    snprintf(name, sizeof(name), "stdin:%d", s->count);
+    j->name = strdup(name);
+
+    return j->name != NULL ? 1 : -1;
+}
+
+// Releases the source of the problems.
+void source_close(struct source *s)
+{
+    if (s->fp != stdin) {
+        fclose(s->fp);
+    }
+    free(s->line);
+    free(s->next);
+}
+
+// Releases the name and text of a job.
+void job_free(struct job *j)
+{
+    free(j->name);
+    free(j->text);
+    j->name = NULL;
+    j->text = NULL;
+}
+
+// Builds the result line of a problem. Returns it, to be freed, or NULL on error.
+char *result_line(char *name, int result, double seconds, int *model, int n)
+{
+    const char *results_names[] = {"UNSAT", "SAT", "UNKNOWN"};
+    char *line, *pos;
+
+    line = (char*)malloc(strlen(name) + 64 + (instance_models && result == 1 ? 12 * (size_t)n : 0));
+    if (line == NULL) {
+        return NULL;
+    }
+    pos = line + sprintf(line, "%s %s %0.3f", name, result >= 0 ? results_names[result] : "ERROR", seconds);
+    if (instance_models && result == 1) {
+        for (int i = 0; i < n; i++) {
+            pos += sprintf(pos, " %d", model[i] < 0 ? -(i + 1) : i + 1);
+        }
+    }
+    sprintf(pos, "\n");
+
+    return line;
+}
+
+// Parses the problem of a stream job into the input problem. The job must hold a DIMACS
+// problem line and its clauses, and nothing else but comments and blanks: data before the
+// problem line or after the last clause is another problem, or not a problem at all, and
+// makes the job an error rather than being dropped. Returns 0, or -1 on error.
+int stream_problem(struct job *j)
+{
+    char *end = j->text + j->size;
+    char *rest;
+
+    if (*skip_blanks(j->text, end, 1) != 'p') {
+        report("Data before the DIMACS problem line. Program terminates.\n");
+        return -1;
+    }
+    if (parse_problem(&input, j->text, end, &rest) < 0) {
+        problem_free(&input);
+        return -1;
+    }
+
+    // The end marker of some DIMACS benchmark files, and what follows it, are ignored.
+    rest = skip_blanks(rest, end, 1);
+    if (rest < end && *rest != '%') {
+        report("Data after the last clause of the DIMACS problem. Program terminates.\n");
+        problem_free(&input);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Solves a problem of a many-instance run, preprocessing it first if requested, and stores
+// its model over the original propositions. Returns 1 if a solution was found, 0 if none
+// exists, INSTANCE_UNKNOWN if the search gave up, or -1 on error.
+int solve_instance(struct problem *p, int *model)
+{
+    int n = p->N;
+    int found, reduced = PRE_REDUCED;
+
+    if (preprocessing) {
+        reduced = preprocess(p, &reduction);
+        if (reduced == PRE_SAT) {
+            int *original = preprocess_model(&reduction, p->N, NULL);
+            if (original == NULL) {
+                reduced = -1;
+            } else {
+                memcpy(model, original, n * sizeof(int));
+                free(original);
+            }
+        }
+        if (reduced != PRE_REDUCED) {
+            preprocess_free(&reduction);
+            return reduced == PRE_SAT ? 1 : (reduced == PRE_UNSAT ? 0 : -1);
+        }
+    }
+
+    if (occurrences_init(p) < 0) {
+        return -1;
+    }
+    found = search_instance(p, model);
+    occurrences_free(p);
+
+    // The model of the reduced problem is extended to the original propositions.
+    if (preprocessing) {
+        if (found == 1) {
+            int *original = preprocess_model(&reduction, p->N, model);
+            if (original == NULL) {
+                found = -1;
+            } else {
+                memcpy(model, original, n * sizeof(int));
+                free(original);
+            }
+        }
+        preprocess_free(&reduction);
+    }
+
+    return found;
+}
+
+// Loads and solves the problem of a job. Returns its result line, to be freed, or NULL on error.
+char *solve_job(struct job *j)
+{
+    double start = wall_clock();
+    int result = -1, n = 0, err;
+    int *model = NULL;
+
+    if (j->text != NULL) {
+        err = stream_problem(j);
+    } else {
+        err = readfile(j->name);
+    }
+    if (err == 0) {
+        n = input.N;
+        model = (int*)calloc(n, sizeof(int));
+        if (model != NULL) {
+            result = solve_instance(&input, model);
+        }
+    }
+    free_problem();
+
+    char *line = result_line(j->name, result, wall_clock() - start, model, n);
+    free(model);
+
+    return line;
+}
+
+// Sends a job to a worker process. Returns 0, or -1 on error.
+int send_job(int fd, struct job *j)
+{
+    struct job_header h;
+
+    h.index = j->index;
+    h.name_size = strlen(j->name);
+    h.text_size = j->text != NULL ? (int64_t)j->size : -1;
+    if (write_all(fd, &h, sizeof(h)) < 0 || write_all(fd, j->name, h.name_size) < 0 ||
+        (j->text != NULL && write_all(fd, j->text, j->size) < 0)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Receives a job from the parent process. Returns 0, or -1 at the end of the run.
+int receive_job(int fd, struct job *j)
+{
+    struct job_header h;
+
+    memset(j, 0, sizeof(struct job));
+    if (read_all(fd, &h, sizeof(h)) < 0 || h.name_size < 0) {
+        return -1;
+    }
+    j->index = h.index;
+    j->name = (char*)calloc(h.name_size + 1, 1);
+    j->text = h.text_size >= 0 ? (char*)malloc(h.text_size + 1) : NULL;
+    if (j->name == NULL || (h.text_size >= 0 && j->text == NULL) ||
+        read_all(fd, j->name, h.name_size) < 0 ||
+        (j->text != NULL && read_all(fd, j->text, h.text_size) < 0)) {
+        job_free(j);
+        return -1;
+    }
+    if (j->text != NULL) {
+        j->size = h.text_size;
+        j->text[j->size] = '\0';
+    }
+
+    return 0;
+}
+
+// Worker process: sets the solver up, then solves the problems the parent sends until it
+// closes the socket, answering each with its result line.
+void solver_main(int fd)
+{
+    struct job j;
+
+    instances_setup();
+    while (receive_job(fd, &j) == 0) {
+        char *line = solve_job(&j);
+        int32_t size = line != NULL ? strlen(line) : 0;
+        if (write_all(fd, &size, sizeof(size)) < 0 || write_all(fd, line, size) < 0) {
+            _exit(-1);
+        }
+        free(line);
+        job_free(&j);
+    }
+    _exit(0);
+}
+
+// Starts a worker process. The sockets of the other workers are closed in it.
+// Returns 0, or -1 on error.
+int spawn_solver(struct solver_process *workers, int w)
+{
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        report("Error: socketpair failed.\n");
+        return -1;
+    }
+    fflush(NULL);
+    workers[w].pid = fork();
+    if (workers[w].pid < 0) {
+        report("Error: fork failed.\n");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (workers[w].pid == 0) {
+        for (int i = 0; i < instance_jobs; i++) {
+            if (i != w && workers[i].pid > 0) {
+                close(workers[i].fd);
+            }
+        }
+        close(fds[0]);
+        solver_main(fds[1]);
+    }
+    close(fds[1]);
+    workers[w].fd = fds[0];
+    workers[w].job.index = -1;
+    workers[w].answered = 0;
+
+    return 0;
+}
+
+// Reports the problem of a worker process that died as an error, and replaces the worker
+// unless it died before answering any problem, which means it cannot be set up.
+// Returns the change in the number of live workers.
+int solver_died(struct solver_process *workers, int w)
+{
+    struct solver_process *p = &workers[w];
+
+    output_error(&p->job);
+    job_free(&p->job);
+    p->job.index = -1;
+    close(p->fd);
+    waitpid(p->pid, NULL, 0);
+    p->pid = -1;
+    if (p->answered > 0 && spawn_solver(workers, w) == 0) {
+        return 0;
+    }
+
+    return -1;
+}
+
+// Writes the result line of a job once those of every earlier problem are written.
+void output_line(struct job *j, char *line)
+{
+    int index = j->index;
+
+    if (line == NULL) {
+        report("Error: malloc for result lines failed.\n");
+        exit(-1);
+    }
+
+    // The result follows the name.
+    char *result = line + strlen(j->name) + 1;
+    if (strncmp(result, "SAT ", 4) == 0) {
+        instance_counts[0]++;
+    } else if (strncmp(result, "UNSAT ", 6) == 0) {
+        instance_counts[1]++;
+    } else if (strncmp(result, "UNKNOWN ", 8) == 0) {
+        instance_counts[2]++;
+    } else {
+        instance_counts[3]++;
+    }
+
+    if (index >= ordered_capacity) {
+        int capacity = ordered_capacity > 0 ? 2 * ordered_capacity : 256;
+        while (capacity <= index) {
+            capacity *= 2;
+        }
+        char **grown = (char**)realloc(ordered_lines, capacity * sizeof(char*));
+        if (grown == NULL) {
+            report("Error: malloc for result lines failed.\n");
+            exit(-1);
+        }
+        memset(grown + ordered_capacity, 0, (capacity - ordered_capacity) * sizeof(char*));
+        ordered_lines = grown;
+        ordered_capacity = capacity;
+    }
+    ordered_lines[index] = line;
+
+    while (ordered_next < ordered_capacity && ordered_lines[ordered_next] != NULL) {
+        fputs(ordered_lines[ordered_next], stdout);
+        fflush(stdout);
+        free(ordered_lines[ordered_next]);
+        ordered_lines[ordered_next++] = NULL;
+    }
+}
+
+// Writes the result line of a problem that could not be solved.
+void output_error(struct job *j)
+{
+    output_line(j, result_line(j->name, -1, 0.0, NULL, 0));
+}
+
+// Hands the problems of a source out to the worker processes, and writes their result
+// lines in order. A worker that dies takes the problem it was solving with it: that
+// problem is reported as an error and the worker replaced, unless it died before
+// answering any problem, which means it cannot be set up.
+void run_solvers(struct source *s)
+{
+    struct solver_process *workers;
+    struct pollfd *fds;
+    int *polled;
+    int busy = 0, alive = 0, more = 1;
+    struct job j;
+
+    workers = (struct solver_process*)calloc(instance_jobs, sizeof(struct solver_process));
+    fds = (struct pollfd*)calloc(instance_jobs, sizeof(struct pollfd));
+    polled = (int*)calloc(instance_jobs, sizeof(int));
+    if (workers == NULL || fds == NULL || polled == NULL) {
+        report("Error: malloc for worker processes failed.\n");
+        exit(-1);
+    }
+    for (int w = 0; w < instance_jobs; w++) {
+        workers[w].pid = -1;
+        if (spawn_solver(workers, w) == 0) {
+            alive++;
+        }
+    }
+
+    while (more || busy > 0) {
+        // Give every idle worker a problem.
+        for (int w = 0; w < instance_jobs && more; w++) {
+            if (workers[w].pid < 0 || workers[w].job.index >= 0) {
+                continue;
+            }
+            int got = source_next(s, &j);
+            if (got <= 0) {
+                more = 0;
+                break;
+            }
+            workers[w].job = j;
+            if (send_job(workers[w].fd, &j) < 0) {
+                alive += solver_died(workers, w);
+                continue;
+            }
+            busy++;
+        }
+        if (alive == 0) {
+            // No worker can solve problems: report the ones left as errors.
+            while (more && source_next(s, &j) > 0) {
+                output_error(&j);
+                job_free(&j);
+            }
+            break;
+        }
+        if (busy == 0) {
+            continue;
+        }
+
+        // Wait for an answer, or for a worker to die.
+        int count = 0;
+        for (int w = 0; w < instance_jobs; w++) {
+            if (workers[w].pid > 0 && workers[w].job.index >= 0) {
+                fds[count].fd = workers[w].fd;
+                fds[count].events = POLLIN;
+                polled[count++] = w;
+            }
+        }
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            report("Error: poll failed.\n");
+            exit(-1);
+        }
+        for (int i = 0; i < count; i++) {
+            struct solver_process *p = &workers[polled[i]];
+            int32_t size;
+            char *line = NULL;
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            busy--;
+            if (read_all(p->fd, &size, sizeof(size)) == 0 && size > 0 &&
+                (line = (char*)malloc(size + 1)) != NULL && read_all(p->fd, line, size) == 0) {
+                line[size] = '\0';
+                output_line(&p->job, line);
+                p->answered++;
+                job_free(&p->job);
+                p->job.index = -1;
+            } else {
+                free(line);
+                alive += solver_died(workers, polled[i]);
+            }
+        }
+    }
+
+    // Closing the sockets ends the workers.
+    for (int w = 0; w < instance_jobs; w++) {
+        if (workers[w].pid > 0) {
+            close(workers[w].fd);
+            waitpid(workers[w].pid, NULL, 0);
+        }
+    }
+    free(workers);
+    free(fds);
+    free(polled);
+}
+
+// Solves every problem of a list of files, or of a stream of DIMACS problems if stream is
+// set, and writes one result line per problem to standard output. A summary is printed
+// to standard error. Returns 0, or -1 if the source cannot be read.
+int run_instances(char *name, int stream)
+{
+    struct source s;
+    struct job j;
+    double start = wall_clock();
+
+    if (source_open(&s, name, stream) < 0) {
+        return -1;
+    }
+
+    // Result lines go to the standard output, everything else the searches print is dropped.
+    quiet = 1;
+
+    if (instance_jobs > 1) {
+        run_solvers(&s);
+    } else {
+        instances_setup();
+        while (source_next(&s, &j) > 0) {
+            output_line(&j, solve_job(&j));
+            job_free(&j);
+        }
+    }
+    source_close(&s);
+
+    fprintf(stderr, "Solved %d problems in %0.3f secs: %lu SAT, %lu UNSAT, %lu UNKNOWN, %lu ERROR\n",
+            s.count, wall_clock() - start, instance_counts[0], instance_counts[1], instance_counts[2], instance_counts[3]);
+    free(ordered_lines);
+
+    return 0;
+}
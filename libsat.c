@@ -0,0 +1,304 @@
+// -----------------------------------------------------------------------
+//
+// libsat: the solver modules both programs are built on, and the solver
+// handle of sat.h over them. A handle owns its clauses, in a problem of
+// its own, and a conflict-driven engine built over that problem on the
+// first search. Later searches reuse the
+// engine: the search backjumps to decision level 0 and decides the new
+// assumptions first, so the clauses it learned still prune. When clauses
+// or propositions were added in between, the engine is built again over
+// every clause, and the learned clauses, the values forced at level 0 and
+// the scores and saved values of the propositions are carried over.
+//
+// -----------------------------------------------------------------------
+
+#include "sat.h"
+
+// Common code file
+#include "core.c"
+
+// Heap of propositions used by the decision heuristics
+#include "heap.c"
+
+// Unit propagation engine
+#include "propagate.c"
+
+// Statistics, phase timers and progress lines
+#include "stats.c"
+
+// Decision heuristics
+#include "heuristic.c"
+
+// Preprocessing functions
+#include "preprocess.c"
+
+// Occurrence lists of the literals
+#include "occur.c"
+
+// Lookahead cuber functions
+#include "cube.c"
+
+// Conflict-Driven Clause Learning functions
+#include "cdcl.c"
+
+// Solver handle.
+struct sat_solver {
+    struct problem problem; // The clauses added so far.
+    int capacity;           // Allocated size of problem.Problem.
+    int offsets_capacity;   // Allocated size of problem.Offsets.
+    struct engine e;        // Engine over the clauses, with the clauses it learned.
+    int built;              // Set once the engine is built.
+    int refuted;            // Set once the clauses have no solution: an empty clause was added, or a search refuted them.
+    int result;             // Result of the last search.
+    int *assumed;           // Assumptions of the last search, without repeated literals.
+    int assumed_capacity;   // Allocated size of assumed.
+};
+
+// Creates a solver without clauses. Returns NULL if memory is exhausted. Failures are
+// reported through the return values of sat.h only: the modules are made quiet.
+SAT_API sat_solver *sat_new(void)
+{
+    sat_solver *s = (sat_solver*)calloc(1, sizeof(sat_solver));
+    quiet = 1;
+    if (s == NULL) {
+        return NULL;
+    }
+
+    s->capacity = 1024;
+    s->offsets_capacity = 64;
+    s->problem.Problem = (int*)malloc(s->capacity * sizeof(int));
+    s->problem.Offsets = (int*)malloc(s->offsets_capacity * sizeof(int));
+    if (s->problem.Problem == NULL || s->problem.Offsets == NULL) {
+        problem_free(&s->problem);
+        free(s);
+        return NULL;
+    }
+    s->problem.Offsets[0] = 0;
+
+    return s;
+}
+
+// Releases a solver.
+SAT_API void sat_delete(sat_solver *s)
+{
+    if (s == NULL) {
+        return;
+    }
+    if (s->built) {
+        engine_free(&s->e);
+    }
+    problem_free(&s->problem);
+    free(s->assumed);
+    free(s);
+}
+
+// Adds a clause of size literals. An empty clause makes every later search fail.
+// Returns 0, or SAT_ERROR if a literal is 0 or memory is exhausted.
+SAT_API int sat_add_clause(sat_solver *s, const int *lits, int size)
+{
+    struct problem *p = &s->problem;
+    int i, start;
+
+    if (size == 0) {
+        s->refuted = 1;
+        return 0;
+    }
+    for (i = 0; i < size; i++) {
+        if (lits[i] == 0) {
+            return SAT_ERROR;
+        }
+    }
+
+    if (p->K + 2 > s->offsets_capacity) {
+        int capacity = 2 * s->offsets_capacity;
+        int *grown = (int*)realloc(p->Offsets, capacity * sizeof(int));
+        if (grown == NULL) {
+            return SAT_ERROR;
+        }
+        p->Offsets = grown;
+        s->offsets_capacity = capacity;
+    }
+
+    // Offsets[K] counts the literals while the clause is appended, then it becomes its start.
+    start = p->Offsets[p->K];
+    for (i = 0; i < size; i++) {
+        if (add_literal(p, lits[i], &s->capacity) < 0) {
+            p->Offsets[p->K] = start;
+            return SAT_ERROR;
+        }
+        if (abs(lits[i]) > p->N) {
+            p->N = abs(lits[i]);
+        }
+    }
+    p->Offsets[p->K + 1] = p->Offsets[p->K];
+    p->Offsets[p->K] = start;
+    p->K++;
+    if (size > p->M) {
+        p->M = size;
+    }
+
+    return 0;
+}
+
+// Adds the clauses of a problem file, in the original format or in DIMACS CNF. The file is
+// parsed every time: the binary cache of the programs is neither read nor written.
+// Returns 0, or SAT_ERROR if the file cannot be read.
+SAT_API int sat_read(sat_solver *s, const char *filename)
+{
+    struct problem read;
+    int i, err = 0;
+
+    if (problem_read(&read, (char*)filename, 0) < 0) {
+        return SAT_ERROR;
+    }
+    for (i = 0; i < read.K && err == 0; i++) {
+        err = sat_add_clause(s, read.Problem + read.Offsets[i], read.Offsets[i + 1] - read.Offsets[i]);
+    }
+    if (err == 0 && read.N > s->problem.N) {
+        s->problem.N = read.N;
+    }
+    problem_free(&read);
+
+    return err;
+}
+
+// Builds the engine of a solver over its clauses, with VSIDS and phase saving. The state
+// of the previous engine is carried over: learned clauses follow from the clauses, so they
+// hold with more clauses as well, and so do the values forced at decision level 0.
+// Returns 0, or -1 if memory is exhausted.
+int sat_build(sat_solver *s)
+{
+    struct engine *e = &s->e;
+    struct engine old = s->e;
+    int i, rebuilt = s->built;
+
+    if (rebuilt) {
+        backjump(&old, 0);
+    }
+    if (engine_init(e, &s->problem) < 0 || heuristic_init(e, HEURISTIC_VSIDS, 1) < 0) {
+        if (rebuilt) {
+            engine_free(&old);
+        }
+        s->built = 0;
+        return -1;
+    }
+
+    if (rebuilt) {
+        // The scores and saved values of the propositions.
+        e->var_increment = old.var_increment;
+        for (i = 0; i < old.N; i++) {
+            e->activity[i] = old.activity[i];
+            e->saved_phase[i] = old.saved_phase[i];
+            heap_increased(&e->order, i);
+        }
+
+        // The learned clauses, numbered after the new clauses, then the values of level 0.
+        e->clause_increment = old.clause_increment;
+        for (i = 0; i < old.num_learnts; i++) {
+            if (add_learnt(e, old.learnt_lits + old.learnt_start[i], old.learnt_length[i]) < 0) {
+                engine_free(&old);
+                s->built = 0;
+                return -1;
+            }
+        }
+        for (i = 0; i < old.trail_size; i++) {
+            if (literal_value(e, old.trail[i]) == 0) {
+                engine_assign(e, old.trail[i], -1);
+            }
+        }
+        engine_free(&old);
+    }
+    s->built = 1;
+
+    return 0;
+}
+
+// Searches for a solution of the clauses in which the count assumption literals are true.
+// Returns SAT_SAT, SAT_UNSAT or SAT_ERROR.
+SAT_API int sat_solve(sat_solver *s, const int *assumptions, int count)
+{
+    struct problem *p = &s->problem;
+    int i, c;
+
+    s->result = SAT_UNSAT;
+    for (i = 0; i < count; i++) {
+        if (assumptions[i] == 0) {
+            return SAT_ERROR;
+        }
+        if (abs(assumptions[i]) > p->N) {
+            p->N = abs(assumptions[i]);
+        }
+    }
+    if (s->refuted) {
+        return SAT_UNSAT;
+    }
+    if (p->N == 0) {
+        s->result = SAT_SAT;
+        return SAT_SAT;
+    }
+
+    // The engine is built again only when clauses or propositions were added.
+    if (!s->built || p->N != s->e.N || p->K != s->e.K) {
+        if (sat_build(s) < 0) {
+            return SAT_ERROR;
+        }
+    }
+    // Repeated assumptions are dropped from a copy of them.
+    if (count > s->assumed_capacity) {
+        int *grown = (int*)realloc(s->assumed, count * sizeof(int));
+        if (grown == NULL) {
+            return SAT_ERROR;
+        }
+        s->assumed = grown;
+        s->assumed_capacity = count;
+    }
+    if (count > 0) {
+        memcpy(s->assumed, assumptions, count * sizeof(int));
+    }
+    backjump(&s->e, 0);
+    if (set_assumptions(&s->e, s->assumed, count) < 0) {
+        return SAT_ERROR;
+    }
+    s->result = cdcl_search(&s->e);
+    s->e.assumptions = NULL;
+    s->e.num_assumptions = 0;
+
+    // A search that fails without a decision either found an assumption false at level 0, or
+    // a conflict there, which refutes the clauses whatever the assumptions. That conflict
+    // leaves the engine inconsistent, so it is recognized by propagating level 0 again, and
+    // later searches answer at once.
+    if (s->result == SAT_UNSAT && s->e.num_decisions == 0) {
+        s->e.propagated = 0;
+        c = engine_propagate(&s->e);
+        if (c == PROPAGATE_ERROR) {
+            s->result = SAT_ERROR;
+        } else if (c >= 0) {
+            s->refuted = 1;
+        }
+    }
+
+    return s->result;
+}
+
+// Returns the value of a proposition in the solution of the last search: 1 true, -1 false,
+// or 0 if the last search found no solution or the proposition is out of range.
+SAT_API int sat_value(sat_solver *s, int var)
+{
+    if (s->result != SAT_SAT || var < 1 || var > s->e.N) {
+        return 0;
+    }
+
+    return s->e.assignment[var - 1];
+}
+
+// Returns the number of propositions of the clauses added so far.
+SAT_API int sat_variables(sat_solver *s)
+{
+    return s->problem.N;
+}
+
+// Returns the number of clauses added so far.
+SAT_API int sat_clauses(sat_solver *s)
+{
+    return s->problem.K;
+}
@@ -0,0 +1,88 @@
+// -----------------------------------------------------------------------
+//
+// Link check of the library: a client whose own globals and functions are
+// named like the solver's internals (N, K, Problem, engine, search). It
+// links only if the library exports nothing but the functions of sat.h,
+// and then solves a small problem through the handle. It also reads a
+// problem file, which must leave no binary cache next to it, searches
+// under more assumptions than propositions, repeated or already true, and
+// makes wrong calls, which must fail without printing anything.
+//
+// -----------------------------------------------------------------------
+
+#include <stdio.h>
+#include <unistd.h>
+#include "sat.h"
+
+#define CHECK_FILE "libsat_check.cnf"
+
+int N = 3;                  // Named like the number of propositions of a problem.
+int K;                      // Named like the number of clauses of a problem.
+int *Problem;               // Named like the clause table of a problem.
+int engine;                 // Clashes with the engine of the programs.
+
+// Clashes with the depth-first search of the programs.
+int search(void)
+{
+    return N;
+}
+
+// Reads (1 or 2) and (-1) from a file and adds (-2 or 3), assumes 2 and 3 many times, then
+// makes two wrong calls. Returns 0 when the solution is 1 false, 2 true, 3 true, with or
+// without the assumptions, no cache was written and the wrong calls failed, and 1 otherwise.
+int main()
+{
+    int clause[2] = {-2, 3};
+    int zero[2] = {1, 0};
+    int repeated[8] = {2, 3, 2, 3, 3, 2, 3, 3};
+    int result;
+    FILE *f = fopen(CHECK_FILE, "w");
+    sat_solver *s = sat_new();
+
+    if (s == NULL) {
+        printf("libsat check: sat_new failed\n");
+        return 1;
+    }
+    if (f == NULL) {
+        printf("libsat check: cannot write %s\n", CHECK_FILE);
+        sat_delete(s);
+        return 1;
+    }
+    fprintf(f, "p cnf 2 2\n1 2 0\n-1 0\n");
+    fclose(f);
+    result = sat_read(s, CHECK_FILE);
+    if (result == 0) {
+        result = access(CHECK_FILE ".satbin", F_OK) == 0 ? -2 : 0;
+    }
+    unlink(CHECK_FILE);
+    unlink(CHECK_FILE ".satbin");
+    if (result != 0) {
+        printf("libsat check: %s\n", result == -2 ? "sat_read wrote a cache" : "sat_read failed");
+        sat_delete(s);
+        return 1;
+    }
+
+    sat_add_clause(s, clause, 2);
+    result = sat_solve(s, NULL, 0);
+    if (result != SAT_SAT || sat_value(s, 1) != -1 || sat_value(s, 2) != 1 || sat_value(s, 3) != 1 ||
+        search() != 3 || engine != 0) {
+        printf("libsat check: wrong answer\n");
+        sat_delete(s);
+        return 1;
+    }
+    result = sat_solve(s, repeated, 8);
+    if (result != SAT_SAT || sat_value(s, 1) != -1 || sat_value(s, 2) != 1 || sat_value(s, 3) != 1) {
+        printf("libsat check: wrong answer under repeated assumptions\n");
+        sat_delete(s);
+        return 1;
+    }
+    if (sat_add_clause(s, zero, 2) != SAT_ERROR || sat_read(s, CHECK_FILE) != SAT_ERROR) {
+        printf("libsat check: wrong call accepted\n");
+        sat_delete(s);
+        return 1;
+    }
+    sat_delete(s);
+    printf("libsat check: ok\n");
+
+    return 0;
+}
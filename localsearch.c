@@ -0,0 +1,367 @@
+// -----------------------------------------------------------------------
+//
+// Stochastic local search. Starting from a random complete assignment, the
+// search repeatedly picks a false clause at random and flips one of its
+// propositions, chosen by ProbSAT (with a probability that decreases with
+// the number of clauses the flip would make false, its break count) or by
+// WalkSAT (a flip that breaks nothing, else a random one with some noise,
+// else the one that breaks least). Break and make counts and the list of
+// false clauses are updated incrementally through the occurrence lists, so a
+// flip only visits the clauses of the flipped proposition. Every thread runs
+// independent restarts from its own seed; the first to reach an assignment
+// with no false clause stops the others. Local search cannot prove that no
+// solution exists: it gives up at the flip or time limit.
+//
+// -----------------------------------------------------------------------
+
+#include <pthread.h>
+
+#define SLS_PROBSAT 0           // ProbSAT flip selection.
+#define SLS_WALKSAT 1           // WalkSAT flip selection.
+#define SLS_DEFAULT_FLIPS 1000000 // Default number of flips per restart.
+#define SLS_DEFAULT_TIME 60     // Default time limit, in seconds.
+#define SLS_BREAK_MAX 64        // Break counts from this one on share one ProbSAT probability.
+#define SLS_WALKSAT_NOISE 0.567 // Probability of a random WalkSAT flip when every flip breaks a clause.
+
+// Local search worker structure.
+struct sls_worker {
+    int id;                 // Index of the worker.
+    struct problem *p;      // Problem searched, with its occurrence lists.
+    pthread_t thread;       // Thread running the worker.
+    uint64_t random;        // State of the worker's random number generator.
+    int *value;             // Value of each proposition: 1 true, -1 false.
+    int *true_count;        // Per clause, the number of its literals that are true.
+    int *critical;          // Per clause with a single true literal, the proposition of that literal.
+    int *break_count;       // Per proposition, the clauses its flip would make false.
+    int *make_count;        // Per proposition, the false clauses its flip would make true.
+    int *false_clauses;     // The clauses that are false.
+    int *false_position;    // Per clause, its position in false_clauses, -1 if it is true.
+    int num_false;          // Number of false clauses.
+    int *stop;              // The search stops once it points to a non-zero value, set atomically.
+    unsigned long flips;    // Number of flips made by the worker.
+    unsigned long restarts; // Number of random assignments the worker started from.
+};
+
+int sls_algorithm;          // Flip selection, SLS_PROBSAT or SLS_WALKSAT.
+unsigned long sls_max_flips = SLS_DEFAULT_FLIPS; // Flips per restart, 0 for no limit.
+double sls_time_limit = SLS_DEFAULT_TIME; // Seconds before the search gives up, 0 for no limit.
+struct sls_worker *sls_workers; // The worker threads.
+int sls_found;              // Set by the first worker that finds a solution. Always accessed atomically.
+int sls_timeout;            // Set once the time limit is reached. Always accessed atomically.
+int *sls_solution;          // The solution found.
+struct timespec sls_start;  // Wall time at which the search started.
+double sls_probability[SLS_BREAK_MAX]; // ProbSAT weight of each break count.
+
+// Returns the next number of a worker's xorshift64* generator.
+uint64_t sls_random(struct sls_worker *w)
+{
+    w->random ^= w->random >> 12;
+    w->random ^= w->random << 25;
+    w->random ^= w->random >> 27;
+
+    return w->random * 2685821657736338717ULL;
+}
+
+// Returns whether the time limit is reached.
+int sls_timed_out()
+{
+    struct timespec now;
+
+    if (sls_time_limit <= 0) {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec - sls_start.tv_sec) + (now.tv_nsec - sls_start.tv_nsec) / 1e9 >= sls_time_limit) {
+        __atomic_store_n(&sls_timeout, 1, __ATOMIC_RELEASE);
+    }
+
+    return __atomic_load_n(&sls_timeout, __ATOMIC_ACQUIRE);
+}
+
+// Adds a clause to the false clauses, and to the make count of its propositions.
+void sls_clause_false(struct sls_worker *w, int c)
+{
+    struct problem *p = w->p;
+    w->false_position[c] = w->num_false;
+    w->false_clauses[w->num_false++] = c;
+    for (int j = p->Offsets[c]; j < p->Offsets[c + 1]; j++) {
+        w->make_count[VAR(p->Problem[j])]++;
+    }
+}
+
+// Removes a clause from the false clauses, and from the make count of its propositions.
+void sls_clause_true(struct sls_worker *w, int c)
+{
+    struct problem *p = w->p;
+    int last = w->false_clauses[--w->num_false];
+
+    w->false_clauses[w->false_position[c]] = last;
+    w->false_position[last] = w->false_position[c];
+    w->false_position[c] = -1;
+    for (int j = p->Offsets[c]; j < p->Offsets[c + 1]; j++) {
+        w->make_count[VAR(p->Problem[j])]--;
+    }
+}
+
+// Starts a restart from a random assignment and computes its counts from scratch.
+void sls_restart(struct sls_worker *w)
+{
+    struct problem *p = w->p;
+    int i, j, lit;
+
+    for (i = 0; i < p->K; i++) {
+        w->true_count[i] = 0;
+        w->false_position[i] = -1;
+    }
+    for (i = 0; i < p->N; i++) {
+        w->value[i] = (sls_random(w) >> 32) & 1 ? 1 : -1;
+        w->break_count[i] = 0;
+        w->make_count[i] = 0;
+        lit = w->value[i] * (i + 1);
+        for (j = p->occ_offsets[LIT_INDEX(lit)]; j < p->occ_offsets[LIT_INDEX(lit) + 1]; j++) {
+            w->true_count[p->occ_clauses[j]]++;
+            w->critical[p->occ_clauses[j]] = i;
+        }
+    }
+    w->num_false = 0;
+    for (i = 0; i < p->K; i++) {
+        if (w->true_count[i] == 0) {
+            sls_clause_false(w, i);
+        } else if (w->true_count[i] == 1) {
+            w->break_count[w->critical[i]]++;
+        }
+    }
+    w->restarts++;
+}
+
+// Flips a proposition and updates the counts of the clauses holding it.
+void sls_flip(struct sls_worker *w, int var)
+{
+    struct problem *p = w->p;
+    int i, j, c, lit;
+
+    w->value[var] = -w->value[var];
+    lit = w->value[var] * (var + 1);
+
+    // Clauses where the proposition became true.
+    for (i = p->occ_offsets[LIT_INDEX(lit)]; i < p->occ_offsets[LIT_INDEX(lit) + 1]; i++) {
+        c = p->occ_clauses[i];
+        if (++w->true_count[c] == 1) {
+            sls_clause_true(w, c);
+            w->critical[c] = var;
+            w->break_count[var]++;
+        } else if (w->true_count[c] == 2) {
+            w->break_count[w->critical[c]]--;
+        }
+    }
+
+    // Clauses where the proposition became false.
+    for (i = p->occ_offsets[LIT_INDEX(-lit)]; i < p->occ_offsets[LIT_INDEX(-lit) + 1]; i++) {
+        c = p->occ_clauses[i];
+        if (--w->true_count[c] == 0) {
+            sls_clause_false(w, c);
+            w->break_count[var]--;
+        } else if (w->true_count[c] == 1) {
+            for (j = p->Offsets[c]; w->value[VAR(p->Problem[j])] != (p->Problem[j] > 0 ? 1 : -1); j++);
+            w->critical[c] = VAR(p->Problem[j]);
+            w->break_count[w->critical[c]]++;
+        }
+    }
+    w->flips++;
+}
+
+// Picks the proposition to flip in a false clause, as ProbSAT or WalkSAT does.
+int sls_pick(struct sls_worker *w, int c)
+{
+    struct problem *p = w->p;
+    int j, var, best;
+    double sum, r;
+
+    if (sls_algorithm == SLS_PROBSAT) {
+        sum = 0.0;
+        for (j = p->Offsets[c]; j < p->Offsets[c + 1]; j++) {
+            var = VAR(p->Problem[j]);
+            sum += sls_probability[w->break_count[var] < SLS_BREAK_MAX ? w->break_count[var] : SLS_BREAK_MAX - 1];
+        }
+        r = (sls_random(w) >> 11) * (1.0 / 9007199254740992.0) * sum;
+        for (j = p->Offsets[c]; j < p->Offsets[c + 1] - 1; j++) {
+            var = VAR(p->Problem[j]);
+            r -= sls_probability[w->break_count[var] < SLS_BREAK_MAX ? w->break_count[var] : SLS_BREAK_MAX - 1];
+            if (r <= 0.0) {
+                break;
+            }
+        }
+        return VAR(p->Problem[j]);
+    }
+
+    // WalkSAT: least breaking flip, ties broken by the larger make count.
+    best = VAR(p->Problem[p->Offsets[c]]);
+    for (j = p->Offsets[c] + 1; j < p->Offsets[c + 1]; j++) {
+        var = VAR(p->Problem[j]);
+        if (w->break_count[var] < w->break_count[best] ||
+            (w->break_count[var] == w->break_count[best] && w->make_count[var] > w->make_count[best])) {
+            best = var;
+        }
+    }
+    if (w->break_count[best] > 0 && (sls_random(w) >> 11) * (1.0 / 9007199254740992.0) < SLS_WALKSAT_NOISE) {
+        j = p->Offsets[c] + (int)(sls_random(w) % (p->Offsets[c + 1] - p->Offsets[c]));
+        best = VAR(p->Problem[j]);
+    }
+
+    return best;
+}
+
+// Runs restarts until a solution is found, the worker's stop flag is set or the time
+// runs out. Returns 1 when w->value is a solution, 0 otherwise.
+int sls_walk(struct sls_worker *w)
+{
+    unsigned long flips;
+
+    while (!__atomic_load_n(w->stop, __ATOMIC_ACQUIRE) && !__atomic_load_n(&sls_timeout, __ATOMIC_ACQUIRE)) {
+        sls_restart(w);
+        for (flips = 0; w->num_false > 0 && (sls_max_flips == 0 || flips < sls_max_flips); flips++) {
+            if ((flips & 4095) == 0 && (__atomic_load_n(w->stop, __ATOMIC_ACQUIRE) || sls_timed_out())) {
+                break;
+            }
+            sls_flip(w, sls_pick(w, w->false_clauses[sls_random(w) % w->num_false]));
+        }
+        if (w->num_false == 0) {
+            return 1;
+        }
+        sls_timed_out();
+    }
+
+    return 0;
+}
+
+// Thread function of a worker: the first to find a solution stores it and stops the others.
+void *sls_run(void *arg)
+{
+    struct sls_worker *w = (struct sls_worker*)arg;
+
+    if (sls_walk(w) && !__atomic_exchange_n(&sls_found, 1, __ATOMIC_SEQ_CST)) {
+        memcpy(sls_solution, w->value, w->p->N * sizeof(int));
+    }
+
+    return NULL;
+}
+
+// Sets the ProbSAT weights of the break counts: polynomial for clauses of up to 3
+// literals, exponential for longer ones, with the constants of the ProbSAT paper.
+void sls_probabilities(struct problem *p)
+{
+    for (int b = 0; b < SLS_BREAK_MAX; b++) {
+        if (p->M <= 3) {
+            sls_probability[b] = pow(1.0 + b, -2.38);
+        } else {
+            sls_probability[b] = pow(p->M <= 5 ? 3.7 : 5.4, -b);
+        }
+    }
+}
+
+// Prepares the shared state of a search of a problem: its probabilities, and its start time
+// for the time limit.
+void sls_init(struct problem *p)
+{
+    __atomic_store_n(&sls_found, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&sls_timeout, 0, __ATOMIC_RELEASE);
+    sls_probabilities(p);
+    clock_gettime(CLOCK_MONOTONIC, &sls_start);
+}
+
+// Allocates the tables of a worker on a problem, whose occurrence lists are built, and seeds
+// its generator from rand(). The worker stops once stop points to a non-zero value.
+// Returns 0, or -1 on error.
+int sls_worker_init(struct sls_worker *w, struct problem *p, int id, int *stop)
+{
+    w->id = id;
+    w->p = p;
+    w->random = ((uint64_t)rand() << 32) ^ (uint64_t)rand() ^ ((uint64_t)(id + 1) << 16) ^ 1;
+    w->stop = stop;
+    w->flips = 0;
+    w->restarts = 0;
+    w->value = (int*)malloc(p->N * sizeof(int));
+    w->break_count = (int*)malloc(p->N * sizeof(int));
+    w->make_count = (int*)malloc(p->N * sizeof(int));
+    w->true_count = (int*)malloc(p->K * sizeof(int));
+    w->critical = (int*)malloc(p->K * sizeof(int));
+    w->false_clauses = (int*)malloc(p->K * sizeof(int));
+    w->false_position = (int*)malloc(p->K * sizeof(int));
+    if (w->value == NULL || w->break_count == NULL || w->make_count == NULL || w->true_count == NULL ||
+        w->critical == NULL || w->false_clauses == NULL || w->false_position == NULL) {
+        report("Error: malloc for local search failed.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Releases the tables of a worker.
+void sls_worker_free(struct sls_worker *w)
+{
+    free(w->value);
+    free(w->break_count);
+    free(w->make_count);
+    free(w->true_count);
+    free(w->critical);
+    free(w->false_clauses);
+    free(w->false_position);
+}
+
+// Local search of a problem, whose occurrence lists are built, on several threads, each from
+// its own seed drawn from rand(). Returns 1 and stores the solution in vector, 0 if no
+// solution was found within the limits and -1 on error.
+int local_search(struct problem *p, int threads, int *vector)
+{
+    int i;
+    struct timespec end;
+
+    sls_solution = vector;
+    sls_workers = (struct sls_worker*)calloc(threads, sizeof(struct sls_worker));
+    if (sls_workers == NULL) {
+        report("Error: malloc for local search failed.\n");
+        return -1;
+    }
+    for (i = 0; i < threads; i++) {
+        if (sls_worker_init(&sls_workers[i], p, i, &sls_found) < 0) {
+            return -1;
+        }
+    }
+
+    sls_init(p);
+    t1 = wall_clock();
+
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&sls_workers[i].thread, NULL, sls_run, &sls_workers[i]) != 0) {
+            report("Error: pthread_create failed.\n");
+            return -1;
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(sls_workers[i].thread, NULL);
+    }
+
+    t2 = wall_clock();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Report the flips and restarts of the workers.
+    double wall = (end.tv_sec - sls_start.tv_sec) + (end.tv_nsec - sls_start.tv_nsec) / 1e9;
+    unsigned long flips = 0;
+    report("\nLocal search (%s) on %d threads:\n", sls_algorithm == SLS_PROBSAT ? "ProbSAT" : "WalkSAT", threads);
+    for (i = 0; i < threads; i++) {
+        struct sls_worker *w = &sls_workers[i];
+        report("    Thread %d: %lu flips, %lu restarts\n", i, w->flips, w->restarts);
+        flips += w->flips;
+    }
+    report("    Wall time: %0.3f secs, %0.0f flips/sec\n", wall, wall > 0 ? flips / wall : 0.0);
+    if (__atomic_load_n(&sls_timeout, __ATOMIC_ACQUIRE) && !__atomic_load_n(&sls_found, __ATOMIC_ACQUIRE)) {
+        report("    Time limit of %0.0f secs reached.\n", sls_time_limit);
+    }
+
+    for (i = 0; i < threads; i++) {
+        sls_worker_free(&sls_workers[i]);
+    }
+    free(sls_workers);
+
+    return __atomic_load_n(&sls_found, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,85 @@
+// -----------------------------------------------------------------------
+//
+// Occurrence lists of the literals. Giving a value to a proposition can only
+// make false the clauses holding the literal that became false, so a search
+// that checked the vector before the assignment only needs to check those
+// clauses after it, instead of all K. The lists are stored back to back in
+// flat tables aligned to cache lines, built once after the problem is read.
+//
+// -----------------------------------------------------------------------
+
+#define CACHE_LINE 64       // Alignment of the occurrence tables, in bytes.
+
+// Allocates a table of count integers aligned to a cache line.
+int *aligned_table(int count)
+{
+    void *table;
+    size_t size = ((count * sizeof(int) + CACHE_LINE - 1) / CACHE_LINE) * CACHE_LINE;
+
+    if (posix_memalign(&table, CACHE_LINE, size > 0 ? size : CACHE_LINE) != 0) {
+        return NULL;
+    }
+
+    return (int*)table;
+}
+
+// Builds the occurrence lists of every literal of p: occ_offsets holds the position in
+// occ_clauses of the list of each literal, by LIT_INDEX, and its end in occ_offsets[2 * N].
+// A clause holding the same literal twice is listed once.
+int occurrences_init(struct problem *p)
+{
+    int i, j, idx;
+    int *fill;
+    int *offsets, *clauses;
+
+    offsets = p->occ_offsets = aligned_table(2 * p->N + 1);
+    clauses = p->occ_clauses = aligned_table(p->Offsets[p->K]);
+    fill = (int*)calloc(2 * p->N, sizeof(int));
+    if (offsets == NULL || clauses == NULL || fill == NULL) {
+        report("Error: malloc for occurrence lists failed.\n");
+        free(fill);
+        return -1;
+    }
+
+    // Count the occurrences of each literal, then place the lists back to back.
+    for (i = 0; i < 2 * p->N + 1; i++) {
+        offsets[i] = 0;
+    }
+    for (i = 0; i < p->Offsets[p->K]; i++) {
+        offsets[LIT_INDEX(p->Problem[i]) + 1]++;
+    }
+    for (i = 0; i < 2 * p->N; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    // Clauses are visited in order, so a repeated literal follows its own clause.
+    for (i = 0; i < p->K; i++) {
+        for (j = p->Offsets[i]; j < p->Offsets[i + 1]; j++) {
+            idx = LIT_INDEX(p->Problem[j]);
+            if (fill[idx] == 0 || clauses[offsets[idx] + fill[idx] - 1] != i) {
+                clauses[offsets[idx] + fill[idx]++] = i;
+            }
+        }
+    }
+
+    // Close the gaps left by repeated literals.
+    for (i = 0, j = 0; i < 2 * p->N; i++) {
+        int start = offsets[i];
+        offsets[i] = j;
+        memmove(clauses + j, clauses + start, fill[i] * sizeof(int));
+        j += fill[i];
+    }
+    offsets[2 * p->N] = j;
+    free(fill);
+
+    return 0;
+}
+
+// Releases the occurrence lists of p.
+void occurrences_free(struct problem *p)
+{
+    free(p->occ_offsets);
+    free(p->occ_clauses);
+    p->occ_offsets = NULL;
+    p->occ_clauses = NULL;
+}
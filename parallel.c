@@ -0,0 +1,307 @@
+// -----------------------------------------------------------------------
+//
+// Parallel depth-first search with work stealing. The search tree is split
+// into cubes, partial assignments of the first propositions, handed out to
+// worker threads. Each worker owns an engine and a deque of cubes: it takes
+// cubes from the bottom of its own deque and, when that is empty, steals
+// from the top of the others. A worker whose deque is empty while others
+// are idle gives away the untried value of its shallowest open decision as
+// a new cube. The first worker to find a solution stops all the others.
+//
+// -----------------------------------------------------------------------
+
+#include <pthread.h>
+#include <sched.h>
+
+#define CUBES_PER_THREAD 4  // Initial cubes per worker.
+#define DEQUE_EXTRA 4       // Deque slots for cubes given away during the search.
+
+// Worker structure.
+struct worker {
+    int id;                 // Index of the worker.
+    pthread_t thread;       // Thread running the worker.
+    struct engine e;        // Engine of the worker's searches.
+    pthread_mutex_t lock;   // Protects the deque.
+    int *cubes;             // Deque of cubes, capacity rows of N literals.
+    int *cube_size;         // Number of literals of each cube in the deque.
+    int capacity;           // Number of cubes the deque can hold.
+    int top;                // Deque position of the oldest cube, taken by thieves.
+    int count;              // Number of cubes in the deque.
+    int *cube;              // The cube being searched.
+    unsigned long cubes_done;  // Number of cubes searched by the worker.
+    unsigned long steals;   // Number of cubes stolen from other workers.
+    unsigned long shared;   // Number of cubes given away.
+};
+
+struct worker *workers;     // The worker threads.
+int num_workers;            // Number of worker threads.
+int pending_cubes;          // Cubes in deques or being searched. No work is left when it is 0.
+int idle_workers;           // Workers looking for a cube.
+int solution_found;         // Set by the first worker that finds a solution, -1 on error. Always accessed atomically.
+int *parallel_solution;     // The solution found.
+
+// Pushes a cube at the bottom of a worker's deque. Returns 0 if the deque is full.
+int push_cube(struct worker *w, int *lits, int size)
+{
+    int pushed = 0;
+
+    pthread_mutex_lock(&w->lock);
+    if (w->count < w->capacity) {
+        int slot = (w->top + w->count) % w->capacity;
+        memcpy(w->cubes + (slot * w->e.N), lits, size * sizeof(int));
+        w->cube_size[slot] = size;
+        w->count++;
+        __atomic_add_fetch(&pending_cubes, 1, __ATOMIC_SEQ_CST);
+        pushed = 1;
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return pushed;
+}
+
+// Takes a cube from a deque into the worker's current cube, from the bottom when the
+// worker takes its own work and from the top when it steals. Returns the cube size or -1.
+int take_cube(struct worker *w, struct worker *from, int steal)
+{
+    int size = -1;
+    int slot;
+
+    pthread_mutex_lock(&from->lock);
+    if (from->count > 0) {
+        if (steal) {
+            slot = from->top;
+            from->top = (from->top + 1) % from->capacity;
+        } else {
+            slot = (from->top + from->count - 1) % from->capacity;
+        }
+        from->count--;
+        size = from->cube_size[slot];
+        memcpy(w->cube, from->cubes + (slot * from->e.N), size * sizeof(int));
+    }
+    pthread_mutex_unlock(&from->lock);
+
+    return size;
+}
+
+// Split callback of the workers' engines: when other workers are idle and the deque is
+// empty, the untried value of the shallowest open decision becomes a cube of its own.
+void share_work(struct engine *e)
+{
+    struct worker *w = (struct worker*)e->owner;
+    int d, i, size, queued;
+
+    if (__atomic_load_n(&idle_workers, __ATOMIC_RELAXED) == 0) {
+        return;
+    }
+    pthread_mutex_lock(&w->lock);
+    queued = w->count;
+    pthread_mutex_unlock(&w->lock);
+    if (queued > 0) {
+        return;
+    }
+    for (d = 0; d < e->num_decisions && e->flipped[d]; d++);
+    if (d == e->num_decisions) {
+        return;
+    }
+
+    // The new cube keeps the values below the decision and flips the decision.
+    size = 0;
+    for (i = 0; i < e->decisions[0]; i++) {
+        e->buffer[size++] = e->trail[i];
+    }
+    for (i = 0; i < d; i++) {
+        e->buffer[size++] = e->trail[e->decisions[i]];
+    }
+    e->buffer[size++] = -e->trail[e->decisions[d]];
+
+    if (push_cube(w, e->buffer, size)) {
+        e->flipped[d] = 1;
+        w->shared++;
+    }
+}
+
+// Searches the subtree of the worker's current cube. Returns the result of dfs().
+int search_cube(struct worker *w, int size)
+{
+    struct engine *e = &w->e;
+    int found;
+
+    engine_undo(e, 0);
+    e->num_decisions = 0;
+    for (int i = 0; i < size; i++) {
+        int value = literal_value(e, w->cube[i]);
+        if (value == -1) {
+            return 0;
+        }
+        if (value == 0) {
+            engine_assign(e, w->cube[i], -1);
+        }
+    }
+    found = consistent(e);
+    if (found <= 0) {
+        return found;
+    }
+
+    return dfs(e);
+}
+
+// Thread function of a worker: searches cubes until a solution is found or no work is left.
+void *worker_run(void *arg)
+{
+    struct worker *w = (struct worker*)arg;
+    int size, found;
+
+    while (!__atomic_load_n(&solution_found, __ATOMIC_ACQUIRE)) {
+        // Take a cube of the worker's own deque, or steal one.
+        size = take_cube(w, w, 0);
+        if (size < 0) {
+            __atomic_add_fetch(&idle_workers, 1, __ATOMIC_SEQ_CST);
+            while (size < 0 && !__atomic_load_n(&solution_found, __ATOMIC_ACQUIRE) &&
+                   __atomic_load_n(&pending_cubes, __ATOMIC_SEQ_CST) > 0) {
+                for (int i = 1; i < num_workers && size < 0; i++) {
+                    size = take_cube(w, &workers[(w->id + i) % num_workers], 1);
+                }
+                if (size < 0) {
+                    sched_yield();
+                }
+            }
+            __atomic_sub_fetch(&idle_workers, 1, __ATOMIC_SEQ_CST);
+            if (size < 0) {
+                break;
+            }
+            w->steals++;
+        }
+
+        found = search_cube(w, size);
+        w->cubes_done++;
+        if (found == 1 && !__atomic_exchange_n(&solution_found, 1, __ATOMIC_SEQ_CST)) {
+            memcpy(parallel_solution, w->e.assignment, w->e.N * sizeof(int));
+        }
+        if (found < 0) {
+            // Memory is exhausted: stop every worker, unless one already found a solution.
+            int none = 0;
+            __atomic_compare_exchange_n(&solution_found, &none, -1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        }
+        __atomic_sub_fetch(&pending_cubes, 1, __ATOMIC_SEQ_CST);
+    }
+
+    return NULL;
+}
+
+// Releases the first count workers, their engines and their deques, then the workers.
+void workers_free(int count)
+{
+    for (int i = 0; i < count; i++) {
+        pthread_mutex_destroy(&workers[i].lock);
+        stats_untrack(&workers[i].e);
+        engine_free(&workers[i].e);
+        free(workers[i].cubes);
+        free(workers[i].cube_size);
+        free(workers[i].cube);
+    }
+    free(workers);
+}
+
+// Depth-first search of a problem on several threads. The engines of the workers use the
+// given heuristic settings. Returns 1 and stores the solution in vector, 0 if no solution
+// exists and -1 on error.
+int parallel_search(struct problem *p, int threads, int heuristic, int phase_saving, int *vector)
+{
+    int i, j, c, prefix, cubes;
+    int *lits;
+    struct timespec start, end;
+
+    num_workers = threads;
+    pending_cubes = 0;
+    idle_workers = 0;
+    solution_found = 0;
+    parallel_solution = vector;
+
+    // Split on enough leading propositions to give every worker a few cubes.
+    for (prefix = 0; prefix < p->N && (1 << prefix) < CUBES_PER_THREAD * threads; prefix++);
+    cubes = 1 << prefix;
+
+    workers = (struct worker*)calloc(threads, sizeof(struct worker));
+    lits = (int*)malloc(p->N * sizeof(int));
+    if (workers == NULL || lits == NULL) {
+        report("Error: malloc for workers failed.\n");
+        free(workers);
+        free(lits);
+        return -1;
+    }
+    for (i = 0; i < threads; i++) {
+        struct worker *w = &workers[i];
+        w->id = i;
+        pthread_mutex_init(&w->lock, NULL);
+        w->capacity = (cubes + threads - 1) / threads + DEQUE_EXTRA;
+        w->cubes = (int*)malloc(w->capacity * p->N * sizeof(int));
+        w->cube_size = (int*)malloc(w->capacity * sizeof(int));
+        w->cube = (int*)malloc(p->N * sizeof(int));
+        if (w->cubes == NULL || w->cube_size == NULL || w->cube == NULL) {
+            report("Error: malloc for workers failed.\n");
+            workers_free(i + 1);
+            free(lits);
+            return -1;
+        }
+        if (engine_init(&w->e, p) < 0 || heuristic_init(&w->e, heuristic, phase_saving) < 0) {
+            workers_free(i + 1);
+            free(lits);
+            return -1;
+        }
+        w->e.stop = &solution_found;
+        w->e.split = share_work;
+        w->e.owner = w;
+        stats_track(&w->e);
+    }
+
+    // Cube c gives proposition j the value false when bit prefix - 1 - j of c is set,
+    // so cubes are numbered in depth-first order. Worker c % threads gets cube c, pushed
+    // from the last so that every worker starts from its first cube.
+    for (c = cubes - 1; c >= 0; c--) {
+        for (j = 0; j < prefix; j++) {
+            lits[j] = ((c >> (prefix - 1 - j)) & 1) ? -(j + 1) : j + 1;
+        }
+        push_cube(&workers[c % threads], lits, prefix);
+    }
+    free(lits);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    t1 = wall_clock();
+
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]) != 0) {
+            // Stop the workers already started before releasing them.
+            report("Error: pthread_create failed.\n");
+            __atomic_store_n(&solution_found, -1, __ATOMIC_RELEASE);
+            while (--i >= 0) {
+                pthread_join(workers[i].thread, NULL);
+            }
+            workers_free(threads);
+            return -1;
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    t2 = wall_clock();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Report how the work was spread over the workers.
+    double wall = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    unsigned long nodes = 0;
+    report("\nParallel search on %d threads, %d initial cubes:\n", threads, cubes);
+    for (i = 0; i < threads; i++) {
+        struct worker *w = &workers[i];
+        report("    Thread %d: %lu nodes, %lu cubes searched, %lu stolen, %lu shared\n",
+               i, w->e.nodes, w->cubes_done, w->steals, w->shared);
+        nodes += w->e.nodes;
+        engine_add_counts(&engine, &w->e);
+    }
+    report("    Wall time: %0.3f secs, %0.0f nodes/sec\n", wall, wall > 0 ? nodes / wall : 0.0);
+    engine.nodes = nodes;
+
+    workers_free(threads);
+
+    return __atomic_load_n(&solution_found, __ATOMIC_ACQUIRE);
+}
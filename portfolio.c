@@ -0,0 +1,202 @@
+// -----------------------------------------------------------------------
+//
+// Portfolio search. Whether a problem has a solution is not known in advance,
+// and neither is the algorithm that settles it fastest, so several engines
+// race on separate threads over the shared, read-only Problem table: the
+// depth-first search, clause learning, local search and variants of them
+// with other heuristics or randomized decisions. The first engine to reach a
+// definitive answer (a solution, or a proof from a complete engine that none
+// exists) stops all the others through a shared flag.
+//
+// -----------------------------------------------------------------------
+
+#define PORTFOLIO_DFS  0    // Depth-first search.
+#define PORTFOLIO_CDCL 1    // Conflict-driven clause learning.
+#define PORTFOLIO_SLS  2    // Stochastic local search, which can only find solutions.
+
+// Strategy of a portfolio member.
+struct strategy {
+    char *name;             // Name reported for the member.
+    int algorithm;          // One of PORTFOLIO_*.
+    int heuristic;          // Decision heuristic of the engine.
+    int phase_saving;       // If set, decisions reuse the last value of the proposition.
+    int randomized;         // If set, decisions are diversified with heuristic_randomize().
+};
+
+// Strategies of the members, in the order they are given threads. Members beyond
+// the table reuse its strategies with randomized decisions.
+struct strategy strategies[] = {
+    {"depth-first", PORTFOLIO_DFS, HEURISTIC_FIRST, 0, 0},
+    {"CDCL", PORTFOLIO_CDCL, HEURISTIC_VSIDS, 1, 0},
+    {"local search", PORTFOLIO_SLS, HEURISTIC_FIRST, 0, 0},
+    {"CDCL", PORTFOLIO_CDCL, HEURISTIC_VSIDS, 1, 1},
+    {"depth-first", PORTFOLIO_DFS, HEURISTIC_JW, 0, 0},
+    {"depth-first", PORTFOLIO_DFS, HEURISTIC_MOMS, 0, 0}
+};
+#define NUM_STRATEGIES ((int)(sizeof(strategies) / sizeof(strategies[0])))
+
+// Portfolio member structure.
+struct member {
+    int id;                 // Index of the member.
+    pthread_t thread;       // Thread running the member.
+    struct strategy s;      // Strategy of the member.
+    struct problem *p;      // Problem the member searches.
+    struct engine e;        // Engine of the complete algorithms.
+    struct sls_worker w;    // Worker of the local search.
+    int result;             // Result of the member's search, -1 if it was stopped.
+    double time;            // Wall time at which the member returned, in seconds.
+};
+
+struct member *members;     // The portfolio members.
+int portfolio_done;         // Set by the first member with a definitive answer. Always accessed atomically.
+int portfolio_winner;       // Index of that member.
+int *portfolio_solution;    // The solution found.
+struct timespec portfolio_start; // Wall time at which the portfolio started.
+
+// Writes the name of a member's strategy, with its heuristic and its randomization.
+void strategy_name(struct member *m, char *name, int size)
+{
+    static char *heuristics[] = {"first", "vsids", "jw", "moms"};
+
+    if (m->s.algorithm == PORTFOLIO_SLS) {
+        snprintf(name, size, "%s (%s)", m->s.name, sls_algorithm == SLS_PROBSAT ? "ProbSAT" : "WalkSAT");
+    } else {
+        snprintf(name, size, "%s (%s%s)", m->s.name, heuristics[m->s.heuristic], m->s.randomized ? ", randomized" : "");
+    }
+}
+
+// Thread function of a member: runs its search and, when the answer is definitive and the
+// first one, stores the solution and stops the others.
+void *member_run(void *arg)
+{
+    struct member *m = (struct member*)arg;
+    struct timespec end;
+    int *vector;
+
+    if (m->s.algorithm == PORTFOLIO_SLS) {
+        m->result = sls_walk(&m->w) ? 1 : -1;
+        vector = m->w.value;
+    } else {
+        m->e.num_decisions = 0;
+        if (m->s.algorithm == PORTFOLIO_CDCL) {
+            m->result = cdcl_search(&m->e);
+        } else {
+            m->result = consistent(&m->e);
+            if (m->result > 0) {
+                m->result = dfs(&m->e);
+            }
+        }
+        vector = m->e.assignment;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    m->time = (end.tv_sec - portfolio_start.tv_sec) + (end.tv_nsec - portfolio_start.tv_nsec) / 1e9;
+    if (m->result >= 0 && !__atomic_exchange_n(&portfolio_done, 1, __ATOMIC_SEQ_CST)) {
+        portfolio_winner = m->id;
+        if (m->result == 1) {
+            memcpy(portfolio_solution, vector, m->p->N * sizeof(int));
+        }
+    }
+
+    return NULL;
+}
+
+// Races the portfolio strategies over a problem on the given number of threads. Returns 1
+// and stores the solution in vector, 0 if no solution exists and -1 on error. The strategy
+// of the winner is stored in name. The occurrence lists of the problem, which the local
+// search walks, must be built.
+int portfolio(struct problem *p, int threads, int *vector, char *name, int size)
+{
+    int i, err;
+    struct timespec end;
+
+    __atomic_store_n(&portfolio_done, 0, __ATOMIC_RELEASE);
+    portfolio_winner = -1;
+    portfolio_solution = vector;
+
+    members = (struct member*)calloc(threads, sizeof(struct member));
+    if (members == NULL) {
+        report("Error: malloc for portfolio failed.\n");
+        return -1;
+    }
+    for (i = 0; i < threads; i++) {
+        struct member *m = &members[i];
+        m->id = i;
+        m->p = p;
+        m->s = strategies[i % NUM_STRATEGIES];
+        m->s.randomized |= (i >= NUM_STRATEGIES);
+        if (m->s.algorithm == PORTFOLIO_SLS) {
+            err = sls_worker_init(&m->w, p, i, &portfolio_done);
+        } else {
+            err = engine_init(&m->e, p);
+            if (err == 0) {
+                err = heuristic_init(&m->e, m->s.heuristic, m->s.phase_saving);
+            }
+            if (err == 0 && m->s.randomized) {
+                heuristic_randomize(&m->e);
+            }
+            m->e.stop = &portfolio_done;
+            stats_track(&m->e);
+        }
+        if (err < 0) {
+            return -1;
+        }
+    }
+
+    sls_init(p);
+    clock_gettime(CLOCK_MONOTONIC, &portfolio_start);
+    t1 = wall_clock();
+
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&members[i].thread, NULL, member_run, &members[i]) != 0) {
+            report("Error: pthread_create failed.\n");
+            return -1;
+        }
+    }
+    for (i = 0; i < threads; i++) {
+        pthread_join(members[i].thread, NULL);
+    }
+
+    t2 = wall_clock();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Report what every member did and which one won.
+    double wall = (end.tv_sec - portfolio_start.tv_sec) + (end.tv_nsec - portfolio_start.tv_nsec) / 1e9;
+    char member_name[64];
+    unsigned long nodes = 0;
+    report("\nPortfolio of %d engines:\n", threads);
+    for (i = 0; i < threads; i++) {
+        struct member *m = &members[i];
+        strategy_name(m, member_name, sizeof(member_name));
+        if (m->s.algorithm == PORTFOLIO_SLS) {
+            report("    Engine %d, %s: %lu flips, %lu restarts", i, member_name, m->w.flips, m->w.restarts);
+        } else {
+            report("    Engine %d, %s: %lu nodes", i, member_name, m->e.nodes);
+            nodes += m->e.nodes;
+            engine_add_counts(&engine, &m->e);
+        }
+        report(", %s after %0.3f secs\n", i == portfolio_winner ? "won" : (m->result >= 0 ? "finished" : "stopped"), m->time);
+    }
+    report("    Wall time: %0.3f secs\n", wall);
+    __atomic_store_n(&engine.nodes, nodes, __ATOMIC_RELAXED);
+
+    // Without a winner, every complete engine failed.
+    int found = -1;
+    if (portfolio_winner >= 0) {
+        found = members[portfolio_winner].result;
+        strategy_name(&members[portfolio_winner], name, size);
+        report("    Winner: engine %d, %s, after %0.3f secs\n", portfolio_winner, name, members[portfolio_winner].time);
+    }
+
+    for (i = 0; i < threads; i++) {
+        if (members[i].s.algorithm == PORTFOLIO_SLS) {
+            sls_worker_free(&members[i].w);
+        } else {
+            stats_untrack(&members[i].e);
+            engine_free(&members[i].e);
+        }
+    }
+    free(members);
+
+    return found;
+}
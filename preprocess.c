@@ -0,0 +1,744 @@
+// -----------------------------------------------------------------------
+//
+// CNF preprocessing, run between reading the problem and searching. Clauses
+// lose their duplicate literals and tautologies are dropped; unit clauses are
+// propagated; a clause subsumed by another one is removed, and self-subsuming
+// resolution removes a literal from a clause when resolving it with another
+// clause on that literal gives a subset of it; pure literals are made true;
+// bounded variable elimination replaces the clauses of a proposition by their
+// resolvents when that does not add clauses. The remaining clauses keep their
+// order and the remaining propositions are renumbered from 1. Every removal
+// that matters for the values of the removed propositions is recorded on a
+// reconstruction stack, so a model of the reduced problem extends to a model
+// of the original one.
+//
+// -----------------------------------------------------------------------
+
+#define PRE_MAX_ROUNDS 8        // Rounds of subsumption, pure literals and elimination.
+#define PRE_SUBSUME_OCCS 1000   // Clauses whose propositions are all in more clauses than this are not checked for subsumption.
+#define PRE_ELIM_OCCS 16        // Propositions in more clauses than this are not eliminated.
+#define PRE_RESOLVENT_SIZE 20   // Elimination is given up if a resolvent is longer than this.
+
+// Results of preprocess().
+#define PRE_UNSAT 0             // The problem has no solution.
+#define PRE_REDUCED 1           // The reduced problem is left for the search.
+#define PRE_SAT 2               // No clause is left: every assignment of the reduced problem is a solution.
+
+// Reduction of a problem by preprocess(): what extends a model of the reduced problem
+// to one of the original problem.
+struct reduction {
+    int N;                  // Number of propositions of the original problem.
+    int *map;               // Original index of each proposition of the reduced problem.
+    int *stack;             // Reconstruction stack: clauses with the literal to make true first, each followed by its size.
+    int stack_size;         // Number of entries of the reconstruction stack.
+    int stack_capacity;     // Allocated size of the reconstruction stack.
+};
+
+// Preprocessor structure.
+struct preprocessor {
+    int N;                  // Number of propositions of the problem.
+    struct reduction *r;    // Reduction the removals are recorded in.
+    int **lits;             // Literals of each clause, NULL once the clause is removed.
+    int *size;              // Number of literals of each clause.
+    uint64_t *signature;    // Per clause, one bit for each of its propositions modulo 64.
+    char *queued;           // Whether each clause waits in the subsumption queue.
+    int num_clauses;        // Number of clauses, removed ones included.
+    int clause_capacity;    // Allocated number of clauses.
+    int live_clauses;       // Number of clauses not removed.
+    int **occ;              // Per literal, the clauses holding it, removed ones included.
+    int *occ_count;         // Per literal, the number of entries of its list.
+    int *occ_capacity;      // Per literal, the allocated size of its list.
+    int *live;              // Per literal, the number of clauses not removed holding it.
+    int *value;             // Per proposition, the value given by a unit or a pure literal, or 0.
+    char *gone;             // Per proposition, whether it was assigned or eliminated.
+    int *queue;             // Clauses to check for subsumption, from queue_head on.
+    int queue_head;         // Position of the next clause of the queue.
+    int queue_size;         // Number of entries of the queue.
+    int queue_capacity;     // Allocated size of the queue.
+    int *units;             // Unit literals waiting to be propagated.
+    int num_units;          // Number of waiting unit literals.
+    int units_capacity;     // Allocated size of units.
+    int *mark;              // Per literal, stamp of the last clause that marked it.
+    int stamp;              // Current marking stamp.
+    int *buffer;            // Scratch copy of occurrence lists.
+    int buffer_capacity;    // Allocated size of buffer.
+    int *resolvents;        // Resolvents of an elimination, each after its size.
+    int resolvents_capacity; // Allocated size of resolvents.
+    int unsat;              // Set once the empty clause is derived.
+    unsigned long changes;  // Number of removed clauses and literals, to detect a fixpoint.
+    int tautologies;        // Clauses removed as tautologies.
+    int duplicate_lits;     // Literals removed as duplicates.
+    int duplicate_clauses;  // Clauses removed as copies of another one.
+    int subsumed;           // Clauses removed as subsumed by a shorter one.
+    int strengthened;       // Literals removed by self-subsuming resolution.
+    int fixed;              // Propositions fixed by unit clauses.
+    int pure;               // Propositions fixed as pure literals.
+    int eliminated;         // Propositions removed by variable elimination.
+};
+
+int preprocessing;          // If set, the problem is preprocessed before the search.
+struct reduction reduction; // Reduction of the input problem.
+
+// Grows a table of integers to hold at least size entries. Returns 0, or -1 on error.
+int pre_reserve(int **table, int *capacity, int size)
+{
+    if (size > *capacity) {
+        int grown_capacity = *capacity > 0 ? 2 * *capacity : 16;
+        while (grown_capacity < size) {
+            grown_capacity *= 2;
+        }
+        int *grown = (int*)realloc(*table, grown_capacity * sizeof(int));
+        if (grown == NULL) {
+            report("Error: realloc for preprocessing failed.\n");
+            return -1;
+        }
+        *table = grown;
+        *capacity = grown_capacity;
+    }
+
+    return 0;
+}
+
+// Pushes a clause on the reconstruction stack, first, one of its literals, in front.
+int pre_push(struct reduction *r, int *lits, int size, int first)
+{
+    if (pre_reserve(&r->stack, &r->stack_capacity, r->stack_size + size + 1) < 0) {
+        return -1;
+    }
+    r->stack[r->stack_size++] = first;
+    for (int i = 0; i < size; i++) {
+        if (lits[i] != first) {
+            r->stack[r->stack_size++] = lits[i];
+        }
+    }
+    r->stack[r->stack_size++] = size;
+
+    return 0;
+}
+
+// Copies the clauses of an occurrence list that are not removed to the scratch buffer.
+// Returns their number, or -1 on error.
+int pre_copy_occ(struct preprocessor *p, int lit)
+{
+    int idx = LIT_INDEX(lit);
+    int count = 0;
+
+    if (pre_reserve(&p->buffer, &p->buffer_capacity, p->occ_count[idx]) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < p->occ_count[idx]; i++) {
+        if (p->lits[p->occ[idx][i]] != NULL) {
+            p->buffer[count++] = p->occ[idx][i];
+        }
+    }
+
+    return count;
+}
+
+// Queues a clause for subsumption.
+int pre_enqueue(struct preprocessor *p, int c)
+{
+    if (p->queued[c]) {
+        return 0;
+    }
+    if (pre_reserve(&p->queue, &p->queue_capacity, p->queue_size + 1) < 0) {
+        return -1;
+    }
+    p->queue[p->queue_size++] = c;
+    p->queued[c] = 1;
+
+    return 0;
+}
+
+// Adds a clause without duplicate literals, tautologies or assigned propositions.
+int pre_add_clause(struct preprocessor *p, int *lits, int size)
+{
+    int c = p->num_clauses;
+    int i, idx;
+
+    if (c == p->clause_capacity) {
+        int capacity = p->clause_capacity > 0 ? 2 * p->clause_capacity : 64;
+        int **grown_lits = (int**)realloc(p->lits, capacity * sizeof(int*));
+        int *grown_size = (int*)realloc(p->size, capacity * sizeof(int));
+        uint64_t *grown_signature = (uint64_t*)realloc(p->signature, capacity * sizeof(uint64_t));
+        char *grown_queued = (char*)realloc(p->queued, capacity * sizeof(char));
+        if (grown_lits != NULL) p->lits = grown_lits;
+        if (grown_size != NULL) p->size = grown_size;
+        if (grown_signature != NULL) p->signature = grown_signature;
+        if (grown_queued != NULL) p->queued = grown_queued;
+        if (grown_lits == NULL || grown_size == NULL || grown_signature == NULL || grown_queued == NULL) {
+            report("Error: realloc for preprocessing failed.\n");
+            return -1;
+        }
+        p->clause_capacity = capacity;
+    }
+
+    p->lits[c] = (int*)malloc(size * sizeof(int));
+    if (p->lits[c] == NULL) {
+        report("Error: malloc for preprocessing failed.\n");
+        return -1;
+    }
+    memcpy(p->lits[c], lits, size * sizeof(int));
+    p->size[c] = size;
+    p->signature[c] = 0;
+    p->queued[c] = 0;
+    for (i = 0; i < size; i++) {
+        idx = LIT_INDEX(lits[i]);
+        if (pre_reserve(&p->occ[idx], &p->occ_capacity[idx], p->occ_count[idx] + 1) < 0) {
+            return -1;
+        }
+        p->occ[idx][p->occ_count[idx]++] = c;
+        p->live[idx]++;
+        p->signature[c] |= 1ULL << (VAR(lits[i]) & 63);
+    }
+    p->num_clauses++;
+    p->live_clauses++;
+
+    if (size == 1) {
+        if (pre_reserve(&p->units, &p->units_capacity, p->num_units + 1) < 0) {
+            return -1;
+        }
+        p->units[p->num_units++] = lits[0];
+    }
+
+    return pre_enqueue(p, c);
+}
+
+// Removes a clause.
+void pre_remove_clause(struct preprocessor *p, int c)
+{
+    for (int i = 0; i < p->size[c]; i++) {
+        p->live[LIT_INDEX(p->lits[c][i])]--;
+    }
+    free(p->lits[c]);
+    p->lits[c] = NULL;
+    p->live_clauses--;
+    p->changes++;
+}
+
+// Removes a literal from a clause. A clause left with one literal makes it a unit,
+// and a clause left empty proves that the problem has no solution.
+int pre_strengthen(struct preprocessor *p, int c, int lit)
+{
+    int i, j, idx = LIT_INDEX(lit);
+
+    for (i = 0, j = 0; i < p->size[c]; i++) {
+        if (p->lits[c][i] != lit) {
+            p->lits[c][j++] = p->lits[c][i];
+        }
+    }
+    p->size[c] = j;
+    p->live[idx]--;
+    for (i = 0; i < p->occ_count[idx] && p->occ[idx][i] != c; i++);
+    if (i < p->occ_count[idx]) {
+        p->occ[idx][i] = p->occ[idx][--p->occ_count[idx]];
+    }
+    p->signature[c] = 0;
+    for (i = 0; i < p->size[c]; i++) {
+        p->signature[c] |= 1ULL << (VAR(p->lits[c][i]) & 63);
+    }
+    p->changes++;
+
+    if (p->size[c] == 0) {
+        p->unsat = 1;
+        return 0;
+    }
+    if (p->size[c] == 1) {
+        if (pre_reserve(&p->units, &p->units_capacity, p->num_units + 1) < 0) {
+            return -1;
+        }
+        p->units[p->num_units++] = p->lits[c][0];
+    }
+
+    return pre_enqueue(p, c);
+}
+
+// Makes a literal true: the clauses holding it are removed and the literal is removed
+// from the clauses holding its negation. The literal goes on the reconstruction stack.
+int pre_assign(struct preprocessor *p, int lit)
+{
+    int i, count, var = VAR(lit);
+
+    if (p->value[var] != 0) {
+        if (p->value[var] != (lit > 0 ? 1 : -1)) {
+            p->unsat = 1;
+        }
+        return 0;
+    }
+    p->value[var] = (lit > 0) ? 1 : -1;
+    p->gone[var] = 1;
+    if (pre_push(p->r, &lit, 1, lit) < 0) {
+        return -1;
+    }
+
+    count = pre_copy_occ(p, lit);
+    if (count < 0) {
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        pre_remove_clause(p, p->buffer[i]);
+    }
+    count = pre_copy_occ(p, -lit);
+    if (count < 0) {
+        return -1;
+    }
+    for (i = 0; i < count && !p->unsat; i++) {
+        if (pre_strengthen(p, p->buffer[i], -lit) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Propagates the waiting unit literals.
+int pre_propagate(struct preprocessor *p)
+{
+    while (p->num_units > 0 && !p->unsat) {
+        int lit = p->units[--p->num_units];
+        if (p->value[VAR(lit)] == 0) {
+            p->fixed++;
+        }
+        if (pre_assign(p, lit) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Removes the clauses subsumed by clause c, and the literals that self-subsuming
+// resolution with c removes from other clauses. Both kinds of clauses hold the
+// proposition of c with the fewest occurrences, so only those are visited.
+int pre_subsume(struct preprocessor *p, int c)
+{
+    int i, j, d, count, same, flipped, flipped_lit, best;
+
+    best = p->lits[c][0];
+    for (i = 1; i < p->size[c]; i++) {
+        int lit = p->lits[c][i];
+        if (p->live[LIT_INDEX(lit)] + p->live[LIT_INDEX(-lit)] < p->live[LIT_INDEX(best)] + p->live[LIT_INDEX(-best)]) {
+            best = lit;
+        }
+    }
+
+    if (p->live[LIT_INDEX(best)] + p->live[LIT_INDEX(-best)] > PRE_SUBSUME_OCCS) {
+        return 0;
+    }
+
+    p->stamp++;
+    for (i = 0; i < p->size[c]; i++) {
+        p->mark[LIT_INDEX(p->lits[c][i])] = p->stamp;
+    }
+
+    for (int sign = 1; sign >= -1; sign -= 2) {
+        count = pre_copy_occ(p, sign * best);
+        if (count < 0) {
+            return -1;
+        }
+        for (i = 0; i < count && p->lits[c] != NULL && !p->unsat; i++) {
+            d = p->buffer[i];
+            if (d == c || p->lits[d] == NULL || p->size[d] < p->size[c] || (p->signature[c] & ~p->signature[d]) != 0) {
+                continue;
+            }
+            same = 0;
+            flipped = 0;
+            flipped_lit = 0;
+            for (j = 0; j < p->size[d]; j++) {
+                if (p->mark[LIT_INDEX(p->lits[d][j])] == p->stamp) {
+                    same++;
+                } else if (p->mark[LIT_INDEX(-p->lits[d][j])] == p->stamp) {
+                    flipped++;
+                    flipped_lit = p->lits[d][j];
+                }
+            }
+            if (same == p->size[c]) {
+                if (p->size[d] == p->size[c]) {
+                    p->duplicate_clauses++;
+                } else {
+                    p->subsumed++;
+                }
+                pre_remove_clause(p, d);
+            } else if (same == p->size[c] - 1 && flipped == 1) {
+                p->strengthened++;
+                if (pre_strengthen(p, d, flipped_lit) < 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Resolves clauses a and b on a proposition, a holding lit and b its negation. The
+// resolvent goes to the resolvents table at position *used, its size first. Returns 1,
+// 0 if the resolvent is a tautology and is not stored, or -1 on error.
+int pre_resolve(struct preprocessor *p, int a, int b, int lit, int *used)
+{
+    int i, size = 0;
+    int *out;
+
+    if (pre_reserve(&p->resolvents, &p->resolvents_capacity, *used + 1 + p->size[a] + p->size[b]) < 0) {
+        return -1;
+    }
+    out = p->resolvents + *used + 1;
+
+    p->stamp++;
+    for (i = 0; i < p->size[a]; i++) {
+        if (p->lits[a][i] != lit) {
+            p->mark[LIT_INDEX(p->lits[a][i])] = p->stamp;
+            out[size++] = p->lits[a][i];
+        }
+    }
+    for (i = 0; i < p->size[b]; i++) {
+        int l = p->lits[b][i];
+        if (l == -lit || p->mark[LIT_INDEX(l)] == p->stamp) {
+            continue;
+        }
+        if (p->mark[LIT_INDEX(-l)] == p->stamp) {
+            return 0;
+        }
+        out[size++] = l;
+    }
+    p->resolvents[*used] = size;
+    *used += size + 1;
+
+    return 1;
+}
+
+// Eliminates a proposition when its clauses can be replaced by at most as many resolvents,
+// none longer than PRE_RESOLVENT_SIZE. The clauses of the literal with fewer occurrences
+// go on the reconstruction stack, after them the negation of that literal.
+int pre_eliminate(struct preprocessor *p, int var)
+{
+    int i, j, lit, other, pos, neg, size, used, added;
+    int *clauses;
+
+    pos = p->live[2 * var];
+    neg = p->live[2 * var + 1];
+    if (pos == 0 || neg == 0 || pos + neg > PRE_ELIM_OCCS) {
+        return 0;
+    }
+    lit = (pos <= neg) ? var + 1 : -(var + 1);
+
+    // Collect the clauses of both literals, those of lit first.
+    clauses = (int*)malloc((pos + neg) * sizeof(int));
+    if (clauses == NULL) {
+        report("Error: malloc for preprocessing failed.\n");
+        return -1;
+    }
+    pos = pre_copy_occ(p, lit);
+    if (pos < 0) {
+        free(clauses);
+        return -1;
+    }
+    memcpy(clauses, p->buffer, pos * sizeof(int));
+    neg = pre_copy_occ(p, -lit);
+    if (neg < 0) {
+        free(clauses);
+        return -1;
+    }
+    memcpy(clauses + pos, p->buffer, neg * sizeof(int));
+
+    // Build the resolvents, giving up as soon as they are too many or too long.
+    used = 0;
+    added = 0;
+    for (i = 0; i < pos; i++) {
+        for (j = pos; j < pos + neg; j++) {
+            int start = used;
+            int stored = pre_resolve(p, clauses[i], clauses[j], lit, &used);
+            if (stored < 0) {
+                free(clauses);
+                return -1;
+            }
+            if (stored && (++added > pos + neg || p->resolvents[start] > PRE_RESOLVENT_SIZE)) {
+                free(clauses);
+                return 0;
+            }
+        }
+    }
+
+    // Replace the clauses by the resolvents.
+    for (i = 0; i < pos; i++) {
+        if (pre_push(p->r, p->lits[clauses[i]], p->size[clauses[i]], lit) < 0) {
+            free(clauses);
+            return -1;
+        }
+    }
+    other = -lit;
+    if (pre_push(p->r, &other, 1, other) < 0) {
+        free(clauses);
+        return -1;
+    }
+    for (i = 0; i < pos + neg; i++) {
+        pre_remove_clause(p, clauses[i]);
+    }
+    free(clauses);
+    for (i = 0; i < used; i += size + 1) {
+        size = p->resolvents[i];
+        if (size == 0) {
+            p->unsat = 1;
+            return 0;
+        }
+        if (pre_add_clause(p, p->resolvents + i + 1, size) < 0) {
+            return -1;
+        }
+    }
+    p->gone[var] = 1;
+    p->eliminated++;
+
+    return 0;
+}
+
+// Releases the working tables of the preprocessor.
+void pre_free(struct preprocessor *p)
+{
+    for (int i = 0; i < p->num_clauses; i++) {
+        free(p->lits[i]);
+    }
+    for (int i = 0; i < 2 * p->N && p->occ != NULL; i++) {
+        free(p->occ[i]);
+    }
+    free(p->lits);
+    free(p->size);
+    free(p->signature);
+    free(p->queued);
+    free(p->occ);
+    free(p->occ_count);
+    free(p->occ_capacity);
+    free(p->live);
+    free(p->value);
+    free(p->gone);
+    free(p->queue);
+    free(p->units);
+    free(p->mark);
+    free(p->buffer);
+    free(p->resolvents);
+}
+
+// Replaces the clauses of problem by the clauses left, with the propositions left
+// renumbered from 1.
+int pre_compact(struct preprocessor *p, struct problem *problem)
+{
+    int i, j, total, *renumber;
+    struct problem reduced;
+
+    renumber = (int*)malloc(p->N * sizeof(int));
+    p->r->map = (int*)malloc(p->N * sizeof(int));
+    if (renumber == NULL || p->r->map == NULL) {
+        report("Error: malloc for preprocessing failed.\n");
+        free(renumber);
+        return -1;
+    }
+    memset(&reduced, 0, sizeof(reduced));
+    for (i = 0; i < p->N; i++) {
+        renumber[i] = -1;
+        if (p->live[2 * i] + p->live[2 * i + 1] > 0) {
+            renumber[i] = reduced.N;
+            p->r->map[reduced.N++] = i;
+        }
+    }
+
+    total = 0;
+    for (i = 0; i < p->num_clauses; i++) {
+        if (p->lits[i] != NULL) {
+            total += p->size[i];
+        }
+    }
+    reduced.Problem = (int*)malloc((total > 0 ? total : 1) * sizeof(int));
+    reduced.Offsets = (int*)malloc((p->live_clauses + 1) * sizeof(int));
+    if (reduced.Problem == NULL || reduced.Offsets == NULL) {
+        report("Error: malloc for Problem failed.\n");
+        free(renumber);
+        problem_free(&reduced);
+        return -1;
+    }
+
+    reduced.Offsets[0] = 0;
+    for (i = 0; i < p->num_clauses; i++) {
+        if (p->lits[i] == NULL) {
+            continue;
+        }
+        for (j = 0; j < p->size[i]; j++) {
+            int lit = p->lits[i][j];
+            reduced.Problem[reduced.Offsets[reduced.K] + j] = (lit > 0) ? renumber[lit - 1] + 1 : -(renumber[-lit - 1] + 1);
+        }
+        reduced.Offsets[reduced.K + 1] = reduced.Offsets[reduced.K] + p->size[i];
+        if (p->size[i] > reduced.M) {
+            reduced.M = p->size[i];
+        }
+        reduced.K++;
+    }
+    free(renumber);
+
+    problem_free(problem);
+    *problem = reduced;
+
+    return 0;
+}
+
+// Preprocesses a problem, whose clauses are replaced by those of the reduced problem, and
+// records in r how to extend its models. Returns PRE_REDUCED when the reduced problem is
+// left for the search, PRE_UNSAT or PRE_SAT when preprocessing decided the problem on its
+// own, or -1 on error.
+int preprocess(struct problem *problem, struct reduction *r)
+{
+    struct preprocessor pre;
+    struct preprocessor *p = &pre;
+    int i, j, size, round, left, result;
+    int *lits;
+    unsigned long changes;
+    double start = wall_clock();
+    int N = problem->N;
+    int K = problem->K;
+
+    memset(p, 0, sizeof(pre));
+    memset(r, 0, sizeof(struct reduction));
+    p->N = N;
+    p->r = r;
+    r->N = N;
+    p->occ = (int**)calloc(2 * N, sizeof(int*));
+    p->occ_count = (int*)calloc(2 * N, sizeof(int));
+    p->occ_capacity = (int*)calloc(2 * N, sizeof(int));
+    p->live = (int*)calloc(2 * N, sizeof(int));
+    p->mark = (int*)calloc(2 * N, sizeof(int));
+    p->value = (int*)calloc(N, sizeof(int));
+    p->gone = (char*)calloc(N, sizeof(char));
+    lits = (int*)malloc((problem->M > 0 ? problem->M : 1) * sizeof(int));
+    if (p->occ == NULL || p->occ_count == NULL || p->occ_capacity == NULL || p->live == NULL ||
+        p->mark == NULL || p->value == NULL || p->gone == NULL || lits == NULL) {
+        report("Error: malloc for preprocessing failed.\n");
+        return -1;
+    }
+
+    // Load the clauses without duplicate literals and tautologies.
+    for (i = 0; i < K; i++) {
+        p->stamp++;
+        size = 0;
+        for (j = problem->Offsets[i]; j < problem->Offsets[i + 1]; j++) {
+            int lit = problem->Problem[j];
+            if (p->mark[LIT_INDEX(-lit)] == p->stamp) {
+                break;
+            }
+            if (p->mark[LIT_INDEX(lit)] == p->stamp) {
+                p->duplicate_lits++;
+                continue;
+            }
+            p->mark[LIT_INDEX(lit)] = p->stamp;
+            lits[size++] = lit;
+        }
+        if (j < problem->Offsets[i + 1]) {
+            p->tautologies++;
+        } else if (pre_add_clause(p, lits, size) < 0) {
+            return -1;
+        }
+    }
+    free(lits);
+
+    // Simplify until nothing changes any more.
+    for (round = 0; round < PRE_MAX_ROUNDS && !p->unsat; round++) {
+        changes = p->changes;
+
+        if (pre_propagate(p) < 0) {
+            return -1;
+        }
+        while (p->queue_head < p->queue_size && !p->unsat) {
+            int c = p->queue[p->queue_head++];
+            p->queued[c] = 0;
+            if (p->lits[c] != NULL && (pre_subsume(p, c) < 0 || pre_propagate(p) < 0)) {
+                return -1;
+            }
+        }
+        p->queue_head = 0;
+        p->queue_size = 0;
+
+        for (i = 0; i < N && !p->unsat; i++) {
+            if (p->gone[i]) {
+                continue;
+            }
+            if (p->live[2 * i] > 0 && p->live[2 * i + 1] == 0) {
+                p->pure++;
+                if (pre_assign(p, i + 1) < 0) {
+                    return -1;
+                }
+            } else if (p->live[2 * i + 1] > 0 && p->live[2 * i] == 0) {
+                p->pure++;
+                if (pre_assign(p, -(i + 1)) < 0) {
+                    return -1;
+                }
+            } else if (pre_eliminate(p, i) < 0 || pre_propagate(p) < 0) {
+                return -1;
+            }
+        }
+
+        if (p->changes == changes && p->num_units == 0 && p->queue_size == 0) {
+            break;
+        }
+    }
+
+    for (i = 0, left = 0; i < N; i++) {
+        left += (p->live[2 * i] + p->live[2 * i + 1] > 0);
+    }
+    report("\nPreprocessing: %d of %d clauses and %d of %d propositions removed in %0.3f secs\n",
+           K - p->live_clauses, K, N - left, N, wall_clock() - start);
+    report("    %d tautologies, %d duplicate literals, %d duplicate clauses, %d subsumed clauses,\n",
+           p->tautologies, p->duplicate_lits, p->duplicate_clauses, p->subsumed);
+    report("    %d literals removed by self-subsumption, %d units, %d pure literals, %d eliminated propositions\n",
+           p->strengthened, p->fixed, p->pure, p->eliminated);
+
+    if (p->unsat) {
+        result = PRE_UNSAT;
+    } else if (pre_compact(p, problem) < 0) {
+        return -1;
+    } else {
+        result = (problem->K == 0) ? PRE_SAT : PRE_REDUCED;
+    }
+    pre_free(p);
+
+    return result;
+}
+
+// Extends a model of the reduced problem, with reduced_N propositions, to the r->N
+// propositions of the original problem. Propositions left out of the reduced problem
+// start true; the reconstruction stack is then replayed from the top, making the first
+// literal of each clause true when no literal of it is. Returns the model, or NULL on error.
+int *preprocess_model(struct reduction *r, int reduced_N, int *vector)
+{
+    int i, j, top, size, satisfied;
+    int *model, *lits;
+
+    model = (int*)malloc(r->N * sizeof(int));
+    if (model == NULL) {
+        report("Error: malloc for the model failed.\n");
+        return NULL;
+    }
+    for (i = 0; i < r->N; i++) {
+        model[i] = 1;
+    }
+    for (i = 0; i < reduced_N; i++) {
+        model[r->map[i]] = (vector[i] < 0) ? -1 : 1;
+    }
+
+    for (top = r->stack_size; top > 0; top -= size + 1) {
+        size = r->stack[top - 1];
+        lits = r->stack + (top - 1 - size);
+        satisfied = 0;
+        for (j = 0; j < size && !satisfied; j++) {
+            satisfied = (model[VAR(lits[j])] == ((lits[j] > 0) ? 1 : -1));
+        }
+        if (!satisfied) {
+            model[VAR(lits[0])] = (lits[0] > 0) ? 1 : -1;
+        }
+    }
+
+    return model;
+}
+
+// Releases the reconstruction tables of a reduction.
+void preprocess_free(struct reduction *r)
+{
+    free(r->map);
+    free(r->stack);
+    memset(r, 0, sizeof(struct reduction));
+}
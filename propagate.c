@@ -0,0 +1,360 @@
+// -----------------------------------------------------------------------
+//
+// Two-watched-literal unit propagation engine built around a problem's clauses.
+// Every clause watches two of its literals. When a proposition gets a value,
+// only the clauses watching the literal that just became false are visited,
+// so the cost of an assignment depends on the clauses touching the assigned
+// proposition rather than on the number of clauses K.
+//
+// -----------------------------------------------------------------------
+
+// Index of a literal in the per-literal tables: proposition p maps to
+// 2 * (p - 1) when positive and to 2 * (p - 1) + 1 when negated.
+#define LIT_INDEX(lit) ((lit) > 0 ? 2 * ((lit) - 1) : 2 * (-(lit) - 1) + 1)
+
+// Index of the proposition of a literal in the per-proposition tables.
+#define VAR(lit) (((lit) > 0 ? (lit) : -(lit)) - 1)
+
+// Decision heuristics of the engine.
+#define HEURISTIC_FIRST 0   // First unassigned proposition.
+#define HEURISTIC_VSIDS 1   // Variable state independent decaying sum of conflict activity.
+#define HEURISTIC_JW    2   // Static two-sided Jeroslow-Wang score.
+#define HEURISTIC_MOMS  3   // Static maximum occurrences in clauses of minimum size.
+
+// Updates a search counter of an engine: nodes, checks, pruned or max_depth. Only the
+// thread searching with the engine writes them, but the progress thread reads them in the
+// meantime, so both sides access them atomically. Relaxed order is enough for figures
+// that are only approximate.
+#define COUNT_ADD(counter, n) __atomic_store_n(&(counter), (counter) + (n), __ATOMIC_RELAXED)
+#define COUNT_MAX(counter, value) do { if ((value) > (counter)) __atomic_store_n(&(counter), (value), __ATOMIC_RELAXED); } while (0)
+
+// Result of engine_propagate() when a watch list cannot grow.
+#define PROPAGATE_ERROR -2
+
+// Propagation engine structure.
+struct engine {
+    struct problem *p;      // Problem whose clauses the engine holds.
+    int N;                  // Number of propositions of the problem when the engine was built.
+    int K;                  // Number of clauses of the problem when the engine was built.
+    int *assignment;        // Value of each proposition: 1 true, -1 false, 0 unassigned.
+    int *trail;             // Assigned literals, in assignment order.
+    int trail_size;         // Number of literals on the trail.
+    int propagated;         // Trail position up to which literals have been propagated.
+    int *watch0;            // First watched literal of each clause.
+    int *watch1;            // Second watched literal of each clause.
+    int **watches;          // Per literal, the clauses watching it.
+    int *watch_count;       // Per literal, the number of clauses watching it.
+    int *watch_capacity;    // Per literal, the allocated size of its watch list.
+    int *decisions;         // Trail position of each open decision.
+    int *flipped;           // Whether the second value of each open decision is being tried.
+    int num_decisions;      // Number of open decisions.
+    int *level;             // Decision level at which each proposition was assigned.
+    int *reason;            // Clause that forced each proposition, -1 for decisions.
+    int *learnt_lits;       // Literals of the learned clauses, stored back to back.
+    int learnt_lits_size;   // Number of used entries of learnt_lits.
+    int learnt_lits_capacity; // Allocated size of learnt_lits.
+    int *learnt_start;      // Position in learnt_lits of each learned clause.
+    int *learnt_length;     // Number of literals of each learned clause.
+    double *learnt_activity; // Conflict activity of each learned clause.
+    int num_learnts;        // Number of learned clauses, numbered after the K clauses of the problem.
+    int learnt_capacity;    // Allocated number of learned clauses.
+    int max_learnts;        // Number of learned clauses that triggers a clause database reduction.
+    double clause_increment; // Activity added to a learned clause taking part in a conflict.
+    unsigned long conflicts; // Number of conflicts met by conflict-driven search.
+    char *seen;             // Per proposition, mark used by conflict analysis.
+    int *buffer;            // Scratch space for the clause being learned.
+    int heuristic;          // Decision heuristic, one of HEURISTIC_*.
+    int phase_saving;       // If set, decisions reuse the last value of the proposition.
+    struct heap order;      // Unassigned propositions ordered by score (all but HEURISTIC_FIRST).
+    double *activity;       // Score of each proposition.
+    double var_increment;   // Activity added to a proposition taking part in a conflict.
+    double *lit_score;      // Static score of each literal, used to pick the value to try first.
+    int *saved_phase;       // Last value given to each proposition.
+    unsigned long nodes;    // Number of decisions, i.e. search nodes expanded.
+    unsigned long checks;   // Consistency checks of new values, by propagation or validation.
+    unsigned long pruned;   // Checks that failed, each pruning a node and its children.
+    int max_depth;          // Deepest decision level reached.
+    unsigned long allocations; // Tables grown while searching.
+    int *assumptions;       // Literals conflict-driven search decides first, one per level.
+    int num_assumptions;    // Number of assumptions.
+    int *stop;              // If not NULL, the search stops once it points to a non-zero value, set atomically.
+    void (*split)(struct engine *e); // If not NULL, called after every decision to share work.
+    void *owner;            // Data of whoever drives the engine, for split.
+};
+
+int propagation;        // If set, search prunes with unit propagation instead of valid_literal().
+struct engine engine;   // The engine holding the assignment and trail of the search.
+
+// Returns the literals of clause c of a problem and stores their number in size.
+int *clause_literals(struct problem *p, int c, int *size)
+{
+    *size = p->Offsets[c + 1] - p->Offsets[c];
+    return p->Problem + p->Offsets[c];
+}
+
+// Returns the literals of a clause of the engine, either one of the K clauses of
+// its problem or a learned clause, and stores their number in size.
+int *engine_clause(struct engine *e, int c, int *size)
+{
+    if (c < e->K) {
+        return clause_literals(e->p, c, size);
+    }
+    *size = e->learnt_length[c - e->K];
+    return e->learnt_lits + e->learnt_start[c - e->K];
+}
+
+// Returns the value of a literal under the engine's assignment: 1 true, -1 false, 0 unassigned.
+int literal_value(struct engine *e, int lit)
+{
+    if (lit > 0) {
+        return e->assignment[lit - 1];
+    }
+    return -e->assignment[-lit - 1];
+}
+
+// Appends clause c to the watch list of a literal.
+int watch(struct engine *e, int lit, int c)
+{
+    int idx = LIT_INDEX(lit);
+
+    if (e->watch_count[idx] == e->watch_capacity[idx]) {
+        int capacity = e->watch_capacity[idx] > 0 ? 2 * e->watch_capacity[idx] : 4;
+        int *list = (int*)realloc(e->watches[idx], capacity * sizeof(int));
+        if (list == NULL) {
+            report("Error: realloc for watch list failed.\n");
+            return -1;
+        }
+        e->watches[idx] = list;
+        e->watch_capacity[idx] = capacity;
+        e->allocations++;
+    }
+    e->watches[idx][e->watch_count[idx]++] = c;
+
+    return 0;
+}
+
+// Allocates the engine tables for a problem and sets up the two watched literals of
+// every clause. The problem must outlive the engine, and keep its clauses.
+int engine_init(struct engine *e, struct problem *p)
+{
+    int i, j, size;
+    int *lits;
+    int N = p->N;
+    int K = p->K;
+
+    e->assignment = (int*)calloc(N, sizeof(int));
+    e->trail = (int*)malloc(N * sizeof(int));
+    e->decisions = (int*)malloc(N * sizeof(int));
+    e->flipped = (int*)malloc(N * sizeof(int));
+    e->level = (int*)malloc(N * sizeof(int));
+    e->reason = (int*)malloc(N * sizeof(int));
+    e->seen = (char*)calloc(N, sizeof(char));
+    e->buffer = (int*)malloc((N + 1) * sizeof(int));
+    e->watch0 = (int*)malloc(K * sizeof(int));
+    e->watch1 = (int*)malloc(K * sizeof(int));
+    e->watches = (int**)calloc(2 * N, sizeof(int*));
+    e->watch_count = (int*)calloc(2 * N, sizeof(int));
+    e->watch_capacity = (int*)calloc(2 * N, sizeof(int));
+    if (e->assignment == NULL || e->trail == NULL || e->decisions == NULL || e->flipped == NULL ||
+        e->level == NULL || e->reason == NULL || e->seen == NULL || e->buffer == NULL ||
+        e->watch0 == NULL || e->watch1 == NULL || e->watches == NULL || e->watch_count == NULL || e->watch_capacity == NULL) {
+        report("Error: malloc for propagation engine failed.\n");
+        return -1;
+    }
+    e->p = p;
+    e->N = N;
+    e->K = K;
+    e->trail_size = 0;
+    e->propagated = 0;
+    e->num_decisions = 0;
+    e->learnt_lits = NULL;
+    e->learnt_lits_size = 0;
+    e->learnt_lits_capacity = 0;
+    e->learnt_start = NULL;
+    e->learnt_length = NULL;
+    e->learnt_activity = NULL;
+    e->num_learnts = 0;
+    e->learnt_capacity = 0;
+    e->max_learnts = 0;
+    e->clause_increment = 1.0;
+    e->conflicts = 0;
+    e->nodes = 0;
+    e->checks = 0;
+    e->pruned = 0;
+    e->max_depth = 0;
+    e->allocations = 0;
+    e->assumptions = NULL;
+    e->num_assumptions = 0;
+    e->heuristic = HEURISTIC_FIRST;
+    e->phase_saving = 0;
+    e->activity = NULL;
+    e->lit_score = NULL;
+    e->saved_phase = NULL;
+    e->stop = NULL;
+    e->split = NULL;
+    e->owner = NULL;
+
+    // Size every watch list by the occurrences of its literal, which bounds
+    // how many clauses can ever watch it, so propagation never reallocates.
+    for (i = 0; i < K; i++) {
+        lits = clause_literals(p, i, &size);
+        for (j = 0; j < size; j++) {
+            e->watch_capacity[LIT_INDEX(lits[j])]++;
+        }
+    }
+    for (i = 0; i < 2 * N; i++) {
+        if (e->watch_capacity[i] > 0) {
+            e->watches[i] = (int*)malloc(e->watch_capacity[i] * sizeof(int));
+            if (e->watches[i] == NULL) {
+                report("Error: malloc for watch list failed.\n");
+                return -1;
+            }
+        }
+    }
+
+    // Watch the first literal and the first one that differs from it.
+    for (i = 0; i < K; i++) {
+        lits = clause_literals(p, i, &size);
+        e->watch0[i] = lits[0];
+        e->watch1[i] = lits[size > 1 ? 1 : 0];
+        for (j = 1; j < size; j++) {
+            if (lits[j] != lits[0]) {
+                e->watch1[i] = lits[j];
+                break;
+            }
+        }
+        if (watch(e, e->watch0[i], i) < 0 || watch(e, e->watch1[i], i) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Releases the engine tables.
+void engine_free(struct engine *e)
+{
+    for (int i = 0; i < 2 * e->N; i++) {
+        free(e->watches[i]);
+    }
+    free(e->watches);
+    free(e->watch_count);
+    free(e->watch_capacity);
+    free(e->watch0);
+    free(e->watch1);
+    free(e->learnt_activity);
+    free(e->learnt_length);
+    free(e->learnt_start);
+    free(e->learnt_lits);
+    if (e->heuristic != HEURISTIC_FIRST) {
+        heap_free(&e->order);
+    }
+    free(e->saved_phase);
+    free(e->lit_score);
+    free(e->activity);
+    free(e->buffer);
+    free(e->seen);
+    free(e->reason);
+    free(e->level);
+    free(e->flipped);
+    free(e->decisions);
+    free(e->trail);
+    free(e->assignment);
+}
+
+// Gives a value to an unassigned proposition by making the literal true, at the
+// current decision level. Reason is the clause that forced it, or -1 for a decision.
+void engine_assign(struct engine *e, int lit, int reason)
+{
+    int var = VAR(lit);
+
+    e->assignment[var] = (lit > 0) ? 1 : -1;
+    e->level[var] = e->num_decisions;
+    e->reason[var] = reason;
+    e->trail[e->trail_size++] = lit;
+}
+
+// Takes back every assignment made after the trail had the given size.
+void engine_undo(struct engine *e, int size)
+{
+    while (e->trail_size > size) {
+        int lit = e->trail[--e->trail_size];
+        int var = VAR(lit);
+        if (e->phase_saving) {
+            e->saved_phase[var] = e->assignment[var];
+        }
+        e->assignment[var] = 0;
+        if (e->heuristic != HEURISTIC_FIRST) {
+            heap_insert(&e->order, var);
+        }
+    }
+    if (e->propagated > size) {
+        e->propagated = size;
+    }
+}
+
+// Propagates the pending assignments of the trail. Clauses left with a single
+// non-false literal force it true. Returns the index of a clause whose literals
+// are all false, -1 if no conflict was found, or PROPAGATE_ERROR if memory is
+// exhausted.
+int engine_propagate(struct engine *e)
+{
+    int i, j, k, n, c, size, other, false_lit;
+    int *list, *lits;
+
+    while (e->propagated < e->trail_size) {
+        false_lit = -e->trail[e->propagated++];
+        list = e->watches[LIT_INDEX(false_lit)];
+        n = e->watch_count[LIT_INDEX(false_lit)];
+
+        for (i = 0, j = 0; i < n; i++) {
+            c = list[i];
+            other = (e->watch0[c] == false_lit) ? e->watch1[c] : e->watch0[c];
+
+            // The clause is already satisfied by its other watch.
+            if (literal_value(e, other) == 1) {
+                list[j++] = c;
+                continue;
+            }
+
+            // Look for another literal that is not false to watch instead.
+            lits = engine_clause(e, c, &size);
+            for (k = 0; k < size; k++) {
+                if (lits[k] != false_lit && lits[k] != other && literal_value(e, lits[k]) != -1) {
+                    break;
+                }
+            }
+            if (k < size) {
+                if (watch(e, lits[k], c) < 0) {
+                    // The clause keeps its watch, and the lists stay consistent.
+                    for (; i < n; i++) {
+                        list[j++] = list[i];
+                    }
+                    e->watch_count[LIT_INDEX(false_lit)] = j;
+                    e->propagated--;
+                    return PROPAGATE_ERROR;
+                }
+                if (e->watch0[c] == false_lit) {
+                    e->watch0[c] = lits[k];
+                } else {
+                    e->watch1[c] = lits[k];
+                }
+                continue;
+            }
+
+            // Every other literal is false: the clause is unit or falsified.
+            list[j++] = c;
+            if (literal_value(e, other) == -1) {
+                for (i++; i < n; i++) {
+                    list[j++] = list[i];
+                }
+                e->watch_count[LIT_INDEX(false_lit)] = j;
+                return c;
+            }
+            engine_assign(e, other, c);
+        }
+        e->watch_count[LIT_INDEX(false_lit)] = j;
+    }
+
+    return -1;
+}
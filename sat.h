@@ -0,0 +1,56 @@
+// -----------------------------------------------------------------------
+//
+// libsat: the solver as a library. A solver handle collects clauses, given
+// as DIMACS literals (n for proposition n true, -n for false), and decides
+// them with conflict-driven clause learning under assumption literals. The
+// clauses learned, the values forced at decision level 0 and the scores of
+// the decision heuristic are kept from one search to the next, so repeated
+// queries on the same clauses only pay for what changed. Clauses can be
+// added between searches.
+//
+// Every handle searches its own clauses with its own engine: separate
+// handles can be used from separate threads at once, a single handle
+// cannot.
+//
+// -----------------------------------------------------------------------
+
+#ifndef SAT_H
+#define SAT_H
+
+#define SAT_API __attribute__((visibility("default")))
+
+#define SAT_UNSAT 0         // No solution exists under the assumptions.
+#define SAT_SAT 1           // A solution was found, see sat_value().
+#define SAT_ERROR -1        // Memory exhausted or wrong input.
+
+typedef struct sat_solver sat_solver;
+
+// Creates a solver without clauses. Returns NULL if memory is exhausted.
+SAT_API sat_solver *sat_new(void);
+
+// Releases a solver.
+SAT_API void sat_delete(sat_solver *s);
+
+// Adds a clause of size literals. An empty clause makes every later search fail.
+// Returns 0, or SAT_ERROR if a literal is 0 or memory is exhausted.
+SAT_API int sat_add_clause(sat_solver *s, const int *lits, int size);
+
+// Adds the clauses of a problem file, in the original format or in DIMACS CNF. No binary
+// cache is read or written. Returns 0, or SAT_ERROR if the file cannot be read.
+SAT_API int sat_read(sat_solver *s, const char *filename);
+
+// Searches for a solution of the clauses in which the count assumption literals are true.
+// Returns SAT_SAT, SAT_UNSAT or SAT_ERROR.
+SAT_API int sat_solve(sat_solver *s, const int *assumptions, int count);
+
+// Returns the value of a proposition in the solution of the last search: 1 true, -1 false,
+// or 0 if the last search found no solution or the proposition is out of range.
+SAT_API int sat_value(sat_solver *s, int var);
+
+// Returns the number of propositions of the clauses added so far.
+SAT_API int sat_variables(sat_solver *s);
+
+// Returns the number of clauses added so far.
+SAT_API int sat_clauses(sat_solver *s);
+
+#endif
@@ -8,41 +8,79 @@
 //
 // -----------------------------------------------------------------------
 
-// Common code file
-#include "core.c"
+// Solver library: common code, propagation engine, heuristics, preprocessing,
+// lookahead cuber and clause learning
+#include "libsat.c"
+
+// Stochastic local search functions
+#include "localsearch.c"
 
 // Auxiliary function that displays a message in case of wrong input parameters.
 void syntax_error(char **argv)
 {
     printf("Wrong syntax. Use the following:\n\n");
-    printf("%s <inputfile>\n\n", argv[0]);
+    printf("%s [--mode=dfs|cdcl|bitslice|sls|portfolio|cube|distributed] [--heuristic=first|vsids|jw|moms]\n", argv[0]);
+    printf("    [--phase-saving] [--no-propagation] [--threads=<number>] [--sls=probsat|walksat] [--flips=<number>]\n");
+    printf("    [--time-limit=<seconds>] [--seed=<number>] [--cubes=<number>] [--cube-file=<file>] [--preprocess]\n");
+    printf("    [--listen=<address>] [--workers=<number>] [--stats=text|json[:<file>]] [--progress=<seconds>] [--no-cache]\n");
+    printf("    <inputfile>\n");
+    printf("%s --list=<file>|--stream [--jobs=<number>] [--models] [search options]\n", argv[0]);
+    printf("%s --connect=<address>\n\n", argv[0]);
     printf("where:\n");
     printf("<inputfile> = name of the file with the problem description\n");
+    printf("--mode = search algorithm: depth-first, conflict-driven clause learning, bit-sliced\n");
+    printf("    exhaustive evaluation, stochastic local search, a portfolio racing them on several threads,\n");
+    printf("    cube-and-conquer, or cubes handed out to worker processes\n");
+    printf("    (default bitslice for small problems, portfolio for larger ones with more than one core, dfs otherwise)\n");
+    printf("--heuristic = decision heuristic (default first for dfs, vsids for cdcl)\n");
+    printf("--phase-saving = give each decided proposition its last value (default for cdcl)\n");
+    printf("--no-propagation = prune depth-first search by checking the clauses of each assigned literal instead of\n");
+    printf("    unit propagation\n");
+    printf("--threads = number of threads of the depth-first search, local search, portfolio or conquer phase\n");
+    printf("    (default 1, the number of cores for portfolio and cube)\n");
+    printf("--sls = flip selection of the local search (default probsat)\n");
+    printf("--flips = flips of the local search before it restarts, 0 for no limit (default %d)\n", SLS_DEFAULT_FLIPS);
+    printf("--time-limit = seconds before the local search gives up, 0 for no limit (default %d)\n", SLS_DEFAULT_TIME);
+    printf("--seed = seed of the random numbers (default the current time)\n");
+    printf("--cubes = number of cubes the lookahead splits the problem into (default %d)\n", CUBE_DEFAULT);
+    printf("--cube-file = write the problem and its cubes to this iCNF file\n");
+    printf("--listen = address of the distributed coordinator, unix:<path> or tcp:<host>:<port>\n");
+    printf("    (default unix:/tmp/sat_CPU.<pid>.sock)\n");
+    printf("--workers = number of worker processes the coordinator spawns locally (default the number of cores)\n");
+    printf("--connect = run as a worker of the coordinator at this address\n");
+    printf("--preprocess = simplify the problem before the search, and extend the model found to the original propositions\n");
+    printf("--stats = print the statistics of the run at its end, as text, or as a JSON object on stderr\n");
+    printf("    or in the given file\n");
+    printf("--progress = print a progress line to stderr every this many seconds of the search\n");
+    printf("--no-cache = parse the input file without using or writing its binary cache <inputfile>%s\n", CACHE_SUFFIX);
+    printf("--list = solve the problem files listed in this file, one per line, - for standard input, and print\n");
+    printf("    one line per problem: <name> SAT|UNSAT|UNKNOWN|ERROR <seconds> [<model>]\n");
+    printf("--stream = solve the DIMACS problems written back to back on standard input, likewise\n");
+    printf("--jobs = number of worker processes solving the problems concurrently (default 1)\n");
+    printf("--models = end the lines of the problems found SAT with their models, as signed propositions\n");
     printf("Program terminates.\n");
 }
 
-// This function checks whether a current partial assignment is already invalid. 
-// In order for a partial assignment to be invalid, there should exist a clause such that
-// all propositions in the clause have already value and their values are such that 
-// the clause is false. We validate the vector by counting how many clauses are valid.
-// In order for the vector to be invalid, count is less than K (number of clauses).
-int valid(struct frontier_node *node)
+// This function checks whether a partial assignment of problem p that was valid is still
+// valid after lit was made true. Only the clauses holding the negation of lit can have
+// become false, so only those are checked, through the occurrence lists.
+int valid_literal(struct problem *p, int *vector, int lit)
 {
-    int sum = 0;
-    for (int i = 0; i < K; ++i) {
-        int valid = 0;
-        for (int j = 0; j < M; ++j) {
-            valid += ((Problem[(i * M) + j] > 0) &&
-                (node->vector[Problem[(i * M) + j] - 1] >= 0)) ||
-                ((Problem[(i * M) + j] < 0) &&
-                (node->vector[-Problem[(i * M) + j] - 1] <= 0));
+    int idx = LIT_INDEX(-lit);
+    int *Problem = p->Problem;
+    int *Offsets = p->Offsets;
+    for (int i = p->occ_offsets[idx]; i < p->occ_offsets[idx + 1]; ++i) {
+        int c = p->occ_clauses[i];
+        int j;
+        for (j = Offsets[c]; j < Offsets[c + 1]; ++j) {
+            if (((Problem[j] > 0) && (vector[Problem[j] - 1] >= 0)) ||
+                ((Problem[j] < 0) && (vector[-Problem[j] - 1] <= 0))) {
+                break;
+            }
+        }
+        if (j == Offsets[c + 1]) { // No true or unassigned literal: the clause is invalid.
+            return 0;
         }
-        sum += (valid > 0); // if valid = 0, the clause is invalid.
-    }
-
-    // Check validation.
-    if (sum < K) {
-        return 0;
     }
 
     return 1;
@@ -51,42 +89,410 @@ int valid(struct frontier_node *node)
 // Depth-First Search functions
 #include "dfs.c"
 
+// Bit-sliced exhaustive evaluation functions
+#include "bitslice.c"
+
+// Parallel Depth-First Search functions
+#include "parallel.c"
+
+// Portfolio search functions
+#include "portfolio.c"
+
+// Cube-and-conquer functions
+#include "conquer.c"
+
+// Distributed coordinator and worker functions
+#include "distribute.c"
+
+// Many-instance mode functions
+#include "instances.c"
+
+char *search_mode;              // Search algorithm, or NULL to choose it for each problem.
+int search_heuristic = -1;      // Decision heuristic, or -1 for the default of the algorithm.
+int search_phase_saving = -1;   // Phase saving, or -1 for the default of the algorithm.
+int search_threads;             // Threads of the search, or 0 for the default of the algorithm.
+
+// Chooses the search algorithm for a problem, unless one was requested, and the number of
+// threads, unless it was given. Small problems are enumerated exhaustively unless a mode or
+// several threads are requested. Larger ones race the portfolio on every core, when there
+// is more than one.
+char *choose_mode(struct problem *p, int *threads)
+{
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    char *mode = search_mode;
+
+    *threads = search_threads;
+    if (mode == NULL) {
+        if (p->N <= BITSLICE_AUTO_N && *threads <= 1) {
+            mode = "bitslice";
+        } else if (*threads > 1 || (*threads == 0 && cores > 1)) {
+            mode = "portfolio";
+        } else {
+            mode = "dfs";
+        }
+    }
+    if (*threads == 0) {
+        *threads = ((strcmp(mode, "portfolio") == 0 || strcmp(mode, "cube") == 0) && cores > 1) ? cores : 1;
+    }
+
+    return mode;
+}
+
+// Initializes the engine over a problem and its decision heuristic for a search algorithm.
+// Clause learning defaults to VSIDS with phase saving, depth-first search keeps its original
+// order: first unassigned proposition, value true first. Returns 0, or -1 on error.
+int start_engine(struct problem *p, char *mode, int *heuristic, int *phase_saving)
+{
+    *heuristic = search_heuristic;
+    *phase_saving = search_phase_saving;
+    if (engine_init(&engine, p) < 0) {
+        return -1;
+    }
+    if (*heuristic < 0) {
+        *heuristic = (strcmp(mode, "cdcl") == 0) ? HEURISTIC_VSIDS : HEURISTIC_FIRST;
+    }
+    if (*phase_saving < 0) {
+        *phase_saving = (strcmp(mode, "cdcl") == 0);
+    }
+
+    return heuristic_init(&engine, *heuristic, *phase_saving);
+}
+
+// Runs a search algorithm, other than the distributed one, on a problem, whose engine is
+// started and whose occurrence lists are built. Returns what the algorithm returns, and
+// points algorithm to its name.
+int run_search(struct problem *p, char *mode, int threads, int heuristic, int phase_saving, char *cube_file,
+               char **algorithm, char *winner, int size)
+{
+    if (strcmp(mode, "cdcl") == 0) {
+        // Clause learning always relies on unit propagation.
+        propagation = 1;
+        *algorithm = "CDCL";
+        return cdcl(&engine);
+    } else if (strcmp(mode, "bitslice") == 0) {
+        *algorithm = "bit-sliced evaluation";
+        return bitslice(p, engine.assignment);
+    } else if (strcmp(mode, "sls") == 0) {
+        *algorithm = "local search";
+        return local_search(p, threads, engine.assignment);
+    } else if (strcmp(mode, "portfolio") == 0) {
+        *algorithm = winner;
+        return portfolio(p, threads, engine.assignment, winner, size);
+    } else if (strcmp(mode, "cube") == 0) {
+        *algorithm = "cube-and-conquer";
+        return cube_and_conquer(p, threads, cube_file, engine.assignment);
+    } else if (threads > 1) {
+        *algorithm = "parallel depth-first";
+        return parallel_search(p, threads, heuristic, phase_saving, engine.assignment);
+    }
+    *algorithm = "depth-first";
+
+    return search(&engine); // The main call.
+}
+
+// Nothing to set up before the problems of a many-instance run: every search starts afresh.
+void instances_setup(void)
+{
+}
+
+// Searches a problem of a many-instance run, after its preprocessing, and stores its
+// solution in vector. Returns 1 if a solution was found, 0 if none exists, INSTANCE_UNKNOWN
+// if local search gave up, or -1 on error.
+int search_instance(struct problem *p, int *vector)
+{
+    int threads, heuristic, phase_saving, found;
+    char *mode, *algorithm;
+    char winner[64];
+
+    mode = choose_mode(p, &threads);
+    found = start_engine(p, mode, &heuristic, &phase_saving);
+    if (found == 0) {
+        found = run_search(p, mode, threads, heuristic, phase_saving, NULL, &algorithm, winner, sizeof(winner));
+    }
+    if (found > 0) {
+        memcpy(vector, engine.assignment, p->N * sizeof(int));
+    }
+    engine_free(&engine);
+    if (found == 0 && strcmp(mode, "sls") == 0) {
+        return INSTANCE_UNKNOWN;
+    }
+
+    return found;
+}
+
 int main(int argc, char **argv)
 {
     int err;
+    char *filename = NULL;
+    char *mode = NULL;
+    char *cube_file = NULL;
+    char *listen_address = NULL;
+    char *connect_address = NULL;
+    char *list = NULL;
+    char default_address[64];
+    int heuristic = -1;
+    int phase_saving = -1;
+    int threads = 0;
+    int workers = -1;
+    int stream = 0;
 
+    run_start = wall_clock();
     srand((unsigned)time(NULL));
 
-    if (argc != 2) {
+    propagation = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-propagation") == 0) {
+            propagation = 0;
+        } else if (strncmp(argv[i], "--mode=", 7) == 0) {
+            mode = argv[i] + 7;
+            if (strcmp(mode, "dfs") != 0 && strcmp(mode, "cdcl") != 0 && strcmp(mode, "bitslice") != 0 &&
+                strcmp(mode, "sls") != 0 && strcmp(mode, "portfolio") != 0 && strcmp(mode, "cube") != 0 &&
+                strcmp(mode, "distributed") != 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--heuristic=", 12) == 0) {
+            heuristic = heuristic_from_name(argv[i] + 12);
+            if (heuristic < 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--phase-saving") == 0) {
+            phase_saving = 1;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = atoi(argv[i] + 10);
+            if (threads < 1) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--sls=", 6) == 0) {
+            if (strcmp(argv[i] + 6, "probsat") == 0) {
+                sls_algorithm = SLS_PROBSAT;
+            } else if (strcmp(argv[i] + 6, "walksat") == 0) {
+                sls_algorithm = SLS_WALKSAT;
+            } else {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--flips=", 8) == 0) {
+            sls_max_flips = strtoul(argv[i] + 8, NULL, 10);
+        } else if (strncmp(argv[i], "--time-limit=", 13) == 0) {
+            sls_time_limit = atof(argv[i] + 13);
+            if (sls_time_limit < 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            srand((unsigned)strtoul(argv[i] + 7, NULL, 10));
+        } else if (strncmp(argv[i], "--cubes=", 8) == 0) {
+            cube_target = atoi(argv[i] + 8);
+            if (cube_target < 1) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--cube-file=", 12) == 0) {
+            cube_file = argv[i] + 12;
+        } else if (strncmp(argv[i], "--listen=", 9) == 0) {
+            listen_address = argv[i] + 9;
+        } else if (strncmp(argv[i], "--workers=", 10) == 0) {
+            workers = atoi(argv[i] + 10);
+            if (workers < 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--connect=", 10) == 0) {
+            connect_address = argv[i] + 10;
+        } else if (strcmp(argv[i], "--preprocess") == 0) {
+            preprocessing = 1;
+        } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+            if (stats_parse(argv[i] + 8) < 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--progress=", 11) == 0) {
+            progress_interval = atof(argv[i] + 11);
+            if (progress_interval <= 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        } else if (strncmp(argv[i], "--list=", 7) == 0) {
+            list = argv[i] + 7;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = 1;
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            instance_jobs = atoi(argv[i] + 7);
+            if (instance_jobs < 1) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--models") == 0) {
+            instance_models = 1;
+        } else if (argv[i][0] == '-' || filename != NULL) {
+            syntax_error(argv);
+            exit(-1);
+        } else {
+            filename = argv[i];
+        }
+    }
+
+    // A worker receives its problem from the coordinator.
+    if (connect_address != NULL) {
+        if (filename != NULL || mode != NULL) {
+            syntax_error(argv);
+            exit(-1);
+        }
+        if (run_worker(connect_address) < 0) {
+            exit(-1);
+        }
+        return 0;
+    }
+
+    // Many problems are solved by one process, one result line each.
+    search_mode = mode;
+    search_heuristic = heuristic;
+    search_phase_saving = phase_saving;
+    search_threads = threads;
+    if (list != NULL || stream) {
+        if (filename != NULL || (list != NULL && stream) || cube_file != NULL || stats_format != STATS_NONE ||
+            progress_interval > 0 || (mode != NULL && strcmp(mode, "distributed") == 0)) {
+            syntax_error(argv);
+            exit(-1);
+        }
+        if (run_instances(stream ? "-" : list, stream) < 0) {
+            exit(-1);
+        }
+        return 0;
+    }
+    if (filename == NULL) {
         syntax_error(argv);
         exit(-1);
     }
 
-    err = readfile(argv[1]);
+    phase_begin(PHASE_PARSE);
+    err = readfile(filename);
+    if (err < 0) {
+        exit(-1);
+    }
+
+    // Simplify the problem before the search. When that decides the problem on its own,
+    // there is nothing left to search.
+    int reduced = PRE_REDUCED;
+    if (preprocessing) {
+        phase_begin(PHASE_PREPROCESS);
+        reduced = preprocess(&input, &reduction);
+        if (reduced < 0) {
+            exit(-1);
+        }
+    }
+    if (reduced != PRE_REDUCED) {
+        printf("\nThis programm solves the Propositional (Boolean) Satisfiability Problem written\n");
+        printf("in file %s, using Preprocessing.\n", filename);
+        if (reduced == PRE_SAT) {
+            int *model = preprocess_model(&reduction, input.N, NULL);
+            if (model == NULL) {
+                exit(-1);
+            }
+            printf("\nSolution found with preprocessing!\n");
+            printf("\nSolution vector propositions values:\n");
+            display(model, reduction.N);
+        } else {
+            printf("\nNO SOLUTION EXISTS. Proved by preprocessing!");
+        }
+        printf("\n");
+        if (stats_begin("sat_CPU", filename, &input, "preprocess", reduced == PRE_SAT ? "SAT" : "UNSAT", &engine)) {
+            stats_end();
+        }
+        return 0;
+    }
+
+    phase_begin(PHASE_SETUP);
+    err = occurrences_init(&input);
+    if (err < 0) {
+        exit(-1);
+    }
+
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    mode = choose_mode(&input, &threads);
+    if (workers < 0) {
+        workers = cores > 1 ? cores : 1;
+    }
+    if (listen_address == NULL) {
+        snprintf(default_address, sizeof(default_address), "unix:/tmp/sat_CPU.%d.sock", (int)getpid());
+        listen_address = default_address;
+    }
+
+    err = start_engine(&input, mode, &heuristic, &phase_saving);
     if (err < 0) {
         exit(-1);
     }
 
     printf("\nThis programm solves the Propositional (Boolean) Satisfiability Problem written\n");
-    printf("in file %s, using Depth First Search Algorithm.\n", argv[1]);
+    if (strcmp(mode, "cdcl") == 0) {
+        printf("in file %s, using Conflict-Driven Clause Learning Algorithm.\n", filename);
+    } else if (strcmp(mode, "bitslice") == 0) {
+        printf("in file %s, using Bit-Sliced Exhaustive Evaluation.\n", filename);
+    } else if (strcmp(mode, "sls") == 0) {
+        printf("in file %s, using Stochastic Local Search.\n", filename);
+    } else if (strcmp(mode, "portfolio") == 0) {
+        printf("in file %s, using a Portfolio of Search Algorithms.\n", filename);
+    } else if (strcmp(mode, "cube") == 0) {
+        printf("in file %s, using Cube-and-Conquer.\n", filename);
+    } else if (strcmp(mode, "distributed") == 0) {
+        printf("in file %s, using Cube-and-Conquer on Worker Processes.\n", filename);
+    } else {
+        printf("in file %s, using Depth First Search Algorithm.\n", filename);
+    }
 
-    //display_problem();
+    //display_problem(&input);
 
-    struct frontier_node *solution_node = search(); // The main call.
+    char *algorithm;
+    char winner[64];
+    int found;
+    phase_begin(PHASE_SEARCH);
+    stats_track(&engine);
+    progress_start();
+    if (strcmp(mode, "distributed") == 0) {
+        algorithm = "distributed cube-and-conquer";
+        found = coordinate(&input, listen_address, workers, engine.assignment);
+    } else {
+        found = run_search(&input, mode, threads, heuristic, phase_saving, cube_file, &algorithm, winner, sizeof(winner));
+    }
+    progress_stop();
+    stats_untrack(&engine);
+    phase_end();
 
-    if (solution_node != NULL) {
-        printf("\nSolution found with depth-first!\n");
+    if (found > 0) {
+        printf("\nSolution found with %s!\n", algorithm);
         printf("\nSolution vector propositions values:\n");
-        display(solution_node->vector);
-    } else {
-        if (mem_error == -1) {
-            printf("Memory exhausted. Program terminates.\n");
+        if (preprocessing) {
+            int *model = preprocess_model(&reduction, input.N, engine.assignment);
+            if (model == NULL) {
+                exit(-1);
+            }
+            display(model, reduction.N);
         } else {
-            printf("\nNO SOLUTION EXISTS. Proved by depth-first!");
+            display(engine.assignment, input.N);
         }
+    } else if (found < 0) {
+        exit(-1);
+    } else if (strcmp(mode, "sls") == 0) {
+        // Local search cannot prove that no solution exists.
+        printf("\nNO SOLUTION FOUND by %s within its limits.", algorithm);
+    } else {
+        printf("\nNO SOLUTION EXISTS. Proved by %s!", algorithm);
     }
 
-    printf("\n\nTime spent: %0.3f secs\n", ((float)t2 - t1) / CLOCKS_PER_SEC);
+    printf("\n\nTime spent: %0.3f secs\n", t2 - t1);
+    if (strcmp(mode, "bitslice") == 0) {
+        printf("Kernel: %s\n", bitslice_kernel_name);
+    } else if (strcmp(mode, "sls") != 0) {
+        printf("Expanded nodes: %lu\n", engine.nodes);
+    }
+    if (stats_begin("sat_CPU", filename, &input, mode, found > 0 ? "SAT" : (strcmp(mode, "sls") == 0 ? "UNKNOWN" : "UNSAT"), &engine)) {
+        stats_end();
+    }
 
     return 0;
 }
@@ -12,36 +12,71 @@
 #define CL_TARGET_OPENCL_VERSION 300
 #include <CL/cl.h>
 
-// Common code file
-#include "core.c"
+// Solver library: common code, propagation engine, heuristics, preprocessing,
+// lookahead cuber and clause learning
+#include "libsat.c"
+
+// OpenCL program binary cache
+#include "clcache.c"
+
+#define BATCH_DEFAULT 256 // Default number of candidate vectors validated per kernel launch.
+#define WORK_GROUP_SIZE 64 // Largest work-group size of clvalid.
+#define COALESCED_GROUP_SIZE 256 // Largest work-group size of the coalesced kernels.
+#define GROUPS_PER_UNIT 4  // Work-groups of the coalesced kernels per compute unit.
+#define BUILD_OPTIONS ""   // Options of the OpenCL compiler, part of the program cache key.
 
 // OpenCl global variables
 int WI; // Work items.
 cl_int status;
-cl_context context;
-cl_command_queue cmdQueue;
-cl_kernel kernel;
-size_t globalWorkSize[1];
-cl_mem d_problem;
-cl_mem d_finish;
-int d_step; // Used to define starting index in Problem vector for each work item.
+int *d_vector_copy;     // Host copy of the values last uploaded to the primary device's d_vector.
 
 // Extra timer.
 float communication_time;
 
 // GPU timers.
-cl_event myEvent;
-cl_ulong startTimeNs, endTimeNs;
 float GPU_run_time_sum;
+float overlap_time;     // GPU execution time during which the host was not waiting.
+unsigned long kernel_launches;
+unsigned long bytes_to_device;   // Bytes copied from the host to the devices.
+unsigned long bytes_from_device; // Bytes copied from the devices to the host.
 
 // Auxiliary function that displays a message in case of wrong input parameters.
 void syntax_error(char **argv)
 {
     printf("Wrong syntax. Use the following:\n\n");
-    printf("%s <work items> <inputfile>\n\n", argv[0]);
+    printf("%s [--mode=dfs|enum] [--kernel=legacy|coalesced] [--batch=<number>] [--preprocess]\n", argv[0]);
+    printf("    [--cube-file=<file>] [--devices=<number>] [--sub-devices=<units>] [--no-pipeline] [--seed=<number>]\n");
+    printf("    [--stats=text|json[:<file>]] [--progress=<seconds>] [--no-cache] [--program-cache=<directory>] [--no-program-cache]\n");
+    printf("    <work items> <inputfile>\n");
+    printf("%s --list=<file>|--stream [--jobs=<number>] [--models] [search options] <work items>\n\n", argv[0]);
     printf("where:\n");
     printf("<work items> = number of computing units of the graphics card\n");
     printf("<inputfile> = name of the file with the problem description\n");
+    printf("--mode = search algorithm: depth-first or exhaustive enumeration on the device\n");
+    printf("    (default enum for small problems, dfs otherwise)\n");
+    printf("--kernel = clauses read by the batch and vector validation kernels: the original ranges of\n");
+    printf("    clauses per work item (default legacy), or transposed, with a local copy of the candidate\n");
+    printf("--batch = number of candidate vectors validated per kernel launch (default %d, 1 validates\n", BATCH_DEFAULT);
+    printf("    one vector per launch)\n");
+    printf("--preprocess = simplify the problem before the search, and extend the model found to the original propositions\n");
+    printf("--cube-file = search the cubes of this iCNF file one after the other, with the depth-first search\n");
+    printf("--devices = use at most this many OpenCL devices, GPUs first (default every device of every platform)\n");
+    printf("--sub-devices = split every CPU device into sub-devices of this many compute units\n");
+    printf("--no-pipeline = wait for every batch before preparing the next one\n");
+    printf("--seed = seed of the random numbers (default the current time)\n");
+    printf("--stats = print the statistics of the run at its end, as text, or as a JSON object on stderr\n");
+    printf("    or in the given file\n");
+    printf("--progress = print a progress line to stderr every this many seconds of the search\n");
+    printf("--no-cache = parse the input file without using or writing its binary cache <inputfile>%s\n", CACHE_SUFFIX);
+    printf("--program-cache = directory of the compiled OpenCL programs, reused by later runs (default\n");
+    printf("    $XDG_CACHE_HOME/sat_GPU, or ~/.cache/sat_GPU)\n");
+    printf("--no-program-cache = build the OpenCL programs from source without using or writing their cache\n");
+    printf("--list = solve the problem files listed in this file, one per line, - for standard input, on devices\n");
+    printf("    set up once, and print one line per problem: <name> SAT|UNSAT|UNKNOWN|ERROR <seconds> [<model>]\n");
+    printf("--stream = solve the DIMACS problems written back to back on standard input, likewise\n");
+    printf("--jobs = number of worker processes solving the problems concurrently, each with its own\n");
+    printf("    devices (default 1)\n");
+    printf("--models = end the lines of the problems found SAT with their models, as signed propositions\n");
     printf("Program terminates.\n");
 }
 
@@ -55,121 +90,323 @@ char *readSource(const char *sourceFilename)
 
     fp = fopen(sourceFilename, "rb");
     if (fp == NULL) {
-        printf("Could not open kernel file: %s\n", sourceFilename);
+        report("Could not open kernel file: %s\n", sourceFilename);
         exit(-1);
     }
     err = fseek(fp, 0, SEEK_END);
     if (err != 0) {
-        printf("Error seeking to end of file.\n");
+        report("Error seeking to end of file.\n");
         exit(-1);
     }
     size = ftell(fp);
     if (size < 0) {
-        printf("Error getting file position.\n");
+        report("Error getting file position.\n");
         exit(-1);
     }
     err = fseek(fp, 0, SEEK_SET);
     if (err != 0) {
-        printf("Error seeking to start of file.\n");
+        report("Error seeking to start of file.\n");
         exit(-1);
     }
     source = (char*)malloc(size + 1);
     if (source == NULL) {
-        printf("Error allocating %d bytes for the program source.\n", size + 1);
+        report("Error allocating %d bytes for the program source.\n", size + 1);
         exit(-1);
     }
     err = fread(source, 1, size, fp);
     if (err != size) {
-        printf("only read %d bytes.\n", err);
+        report("only read %d bytes.\n", err);
         exit(0);
     }
     source[size] = '\0';
     return source;
 }
 
-// This function checks whether a current partial assignment is already invalid using the GPU. 
-// In order for a partial assignment to be invalid, there should exist a clause such that
-// all propositions in the clause have already value and their values are such that 
-// the clause is false. We validate the vector by counting how many clauses are valid.
-// In order for the vector to be invalid, count is less than K (number of clauses).
-int valid(struct frontier_node *node)
+// Reads a kernel file and builds it for the devices of a context, from the binaries of
+// an earlier build when the program cache holds them. Build errors are printed to the screen.
+cl_program build_program(cl_context context, const char *sourceFile, cl_uint numDevices, cl_device_id *devices)
 {
-    // Pass the vector to GPU.
-    cl_mem d_vector;
-    d_vector = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, N * sizeof(int), node->vector, &status);
-    if (status != CL_SUCCESS || d_vector == NULL) {
-        printf("clCreateBuffer failed\n");
+    cl_program program;
+    char *source;
+    // This function reads in the source code of the program.
+    source = readSource(sourceFile);
+    if (program_cache_ready()) {
+        program = load_program_binaries(context, sourceFile, BUILD_OPTIONS, source, numDevices, devices);
+        if (program != NULL) {
+            program_cache_hits++;
+            free(source);
+            return program;
+        }
+        program_cache_misses++;
+    }
+    // Create a program. The 'source' string is the code from the kernel file.
+    program = clCreateProgramWithSource(context, 1, (const char**)&source, NULL, &status);
+    if (status != CL_SUCCESS) {
+        report("clCreateProgramWithSource failed. Program terminates.\n");
         exit(-1);
     }
 
-    // Create a partial sums table for the GPU.
-    int *partial_sums = (int*)malloc(WI * sizeof(int));
-    if (partial_sums == NULL) {
-        printf("Error: malloc for partial_sums failed.\n");
-        exit(-1);
+    cl_int buildErr;
+    // Build (compile & link) the program for the devices.
+    // Save the return value in 'buildErr' (the following
+    // code will print any compilation errors to the screen).
+    buildErr = clBuildProgram(program, numDevices, devices, BUILD_OPTIONS, NULL, NULL);
+    // If there are build errors, print them to the screen.
+    if (buildErr != CL_SUCCESS) {
+        report("Program failed to build.\n");
+        cl_build_status buildStatus;
+        for (int i = 0; i < numDevices; i++) {
+            clGetProgramBuildInfo(program, devices[i], CL_PROGRAM_BUILD_STATUS, sizeof(cl_build_status), &buildStatus, NULL);
+            if (buildStatus == CL_SUCCESS) {
+                continue;
+            }
+            char *buildLog;
+            size_t buildLogSize;
+            clGetProgramBuildInfo(program, devices[i], CL_PROGRAM_BUILD_LOG, 0, NULL, &buildLogSize);
+            buildLog = (char*)malloc(buildLogSize);
+            if (buildLog == NULL) {
+                perror("malloc");
+                exit(-1);
+            }
+            clGetProgramBuildInfo(program, devices[i], CL_PROGRAM_BUILD_LOG, buildLogSize, buildLog, NULL);
+            buildLog[buildLogSize - 1] = '\0';
+            report("Device %u Build Log:\n%s\n", i, buildLog);
+            free(buildLog);
+        }
+        exit(0);
     }
-    for (int i = 0; i < WI; i++) {
-        partial_sums[i] = 0;
+    if (use_program_cache) {
+        save_program_binaries(program, sourceFile, BUILD_OPTIONS, source, numDevices, devices);
     }
-    cl_mem d_partial_sums;
-    d_partial_sums = clCreateBuffer(context, CL_MEM_WRITE_ONLY, WI * sizeof(int), NULL, &status);
-    if (status != CL_SUCCESS || d_partial_sums == NULL) {
-        printf("clCreateBuffer failed\n");
-        exit(-1);
+    free(source);
+
+    return program;
+}
+
+// OpenCL devices functions
+#include "devices.c"
+
+// Adds GPU_run_time to the GPU execution time, and the rest of the wall time the host waited
+// since S_idle_timer to the communication time. A kernel that ran longer than the host waited
+// for it ran while the host was working, and the difference goes to the overlap time.
+void add_kernel_times(struct timespec *S_idle_timer, float GPU_run_time)
+{
+    struct timespec E_idle_timer;
+    clock_gettime(CLOCK_MONOTONIC, &E_idle_timer);
+
+    // Wall time, since the host may sleep while waiting for the device.
+    float idle_time = (E_idle_timer.tv_sec - S_idle_timer->tv_sec) + (E_idle_timer.tv_nsec - S_idle_timer->tv_nsec) / 1000000000.0;
+
+    GPU_run_time_sum += GPU_run_time;
+    if (idle_time >= GPU_run_time) {
+        communication_time += idle_time - GPU_run_time;
+    } else {
+        overlap_time += GPU_run_time - idle_time;
     }
+}
 
-    // Set kernel arguments.
-    status = clSetKernelArg(kernel, 1, sizeof(cl_mem), &d_vector);
-    status |= clSetKernelArg(kernel, 3, sizeof(cl_mem), &d_partial_sums);
+// Passes the range of values of vector that changed since the previous upload to d_vector
+// of the primary device, and clears the count. Both are enqueued without waiting.
+void upload_vector(struct problem *p, int *vector)
+{
+    struct device *d = &devs[0];
+    int first, last;
+    int zero = 0;
+
+    for (first = 0; first < p->N && vector[first] == d_vector_copy[first]; first++);
+    for (last = p->N - 1; last > first && vector[last] == d_vector_copy[last]; last--);
+    status = CL_SUCCESS;
+    if (first < p->N) {
+        memcpy(d_vector_copy + first, vector + first, (last - first + 1) * sizeof(int));
+        bytes_to_device += (last - first + 1) * sizeof(int);
+        status = clEnqueueWriteBuffer(d->queue[0], d->d_vector, CL_FALSE, first * sizeof(int), (last - first + 1) * sizeof(int),
+                                      d_vector_copy + first, 0, NULL, NULL);
+    }
+    status |= clEnqueueFillBuffer(d->queue[0], d->d_count, &zero, sizeof(int), 0, sizeof(int), 0, NULL, NULL);
     if (status != CL_SUCCESS) {
-        printf("clSetKernelArg failed\n");
+        report("clEnqueueWriteBuffer failed\n");
         exit(-1);
     }
+}
+
+// This function checks whether a current partial assignment is already invalid using the GPU.
+// The batched search calls it once, on the values it starts from; every later check goes to
+// valid_literal() or to the batch kernel. In order for a partial assignment to be invalid,
+// there should exist a clause such that all propositions in the clause have already value
+// and their values are such that the clause is false. We validate the vector by counting how many clauses are valid.
+// In order for the vector to be invalid, count is less than K (number of clauses).
+// The device buffers are allocated once: only the values that changed since the previous
+// call are uploaded, and the kernel reduces the count on the device. Single vectors are
+// validated by the primary device alone.
+int valid(struct problem *p, int *vector)
+{
+    struct device *d = &devs[0];
+    cl_event event;
+    int sum;
+
+    struct timespec S_idle_timer;
+    clock_gettime(CLOCK_MONOTONIC, &S_idle_timer);
 
-    clock_t S_idle_timer = clock();
+    upload_vector(p, vector);
 
     // Run kernel.
-    status = clEnqueueNDRangeKernel(cmdQueue, kernel, 1, NULL, globalWorkSize, NULL, 0, NULL, &myEvent);
+    status = clEnqueueNDRangeKernel(d->queue[0], d->kernel, 1, NULL, d->globalWorkSize, d->localWorkSize, 0, NULL, &event);
     if (status != CL_SUCCESS) {
-        printf("clEnqueueNDRangeKernel failed\n");
+        report("clEnqueueNDRangeKernel failed\n");
         exit(-1);
     }
 
-    // Copy back the memory to the host.
-    status = clEnqueueReadBuffer(cmdQueue, d_partial_sums, CL_TRUE, 0, WI * sizeof(int), partial_sums, 0, NULL, NULL);
+    // Copy back the count of valid clauses to the host.
+    status = clEnqueueReadBuffer(d->queue[0], d->d_count, CL_TRUE, 0, sizeof(int), &sum, 0, NULL, NULL);
     if (status != CL_SUCCESS) {
-        printf("clEnqueueReadBuffer failed\n");
+        report("clEnqueueReadBuffer failed\n");
         exit(-1);
     }
 
-    clock_t E_idle_timer = clock();
+    clWaitForEvents(1, &event);
+    add_kernel_times(&S_idle_timer, event_time(event));
+    kernel_launches++;
+    bytes_from_device += sizeof(int);
 
-    float idle_time = ((float)(E_idle_timer - S_idle_timer) / CLOCKS_PER_SEC);
+    // Check validation.
+    if (sum < p->K) {
+        return 0;
+    }
 
-    // Release OpenCL objects.
-    clReleaseMemObject(d_partial_sums);
-    clReleaseMemObject(d_vector);
+    return 1;
+}
 
-    // Get timers values.
-    clWaitForEvents(1, &myEvent);
-    clGetEventProfilingInfo(myEvent, CL_PROFILING_COMMAND_START, sizeof(cl_ulong), &startTimeNs, NULL);
-    clGetEventProfilingInfo(myEvent, CL_PROFILING_COMMAND_END, sizeof(cl_ulong), &endTimeNs, NULL);
-    clReleaseEvent(myEvent);
-    float GPU_run_time = ((endTimeNs - startTimeNs) / 1000000000.0);
-    GPU_run_time_sum += GPU_run_time;
+// This function starts the validation of count candidate vectors of N values, stored back
+// to back, with a single kernel launch per device. With the coalesced kernel, the work-groups
+// of a candidate check neighbouring clauses from a local copy of it; there are enough of them
+// to cover its clauses, or to give every compute unit a few work-groups when the batch is
+// small. With the legacy kernel, each work item checks one range of clauses for one
+// candidate. The candidates are split across the devices in proportion to their
+// throughput, and every device will write the flags of its candidates in place, 1 for every
+// valid candidate and 0 for every invalid one. Nothing is waited for: the commands go to the
+// queues and buffers of the given slot, and wait_batch() returns when the flags are in.
+// The candidates must be left untouched until work_uploaded() returns.
+void submit_batch(struct problem *p, struct work *w, int slot, int *candidates, int count, int *flags)
+{
+    int one = 1;
+    int offset = 0;
+    size_t batchWorkSize[2];
+
+    split_work(w, count);
+    for (int i = 0; i < num_devs; i++) {
+        struct device *d = &devs[i];
+        if (w->share[i] == 0) {
+            continue;
+        }
+
+        // Pass the candidates to the device and mark them all valid.
+        status = clEnqueueWriteBuffer(d->queue[slot], d->d_candidates[slot], CL_FALSE, 0, w->share[i] * p->N * sizeof(int),
+                                      candidates + offset * p->N, 0, NULL, &w->first[i]);
+        status |= clEnqueueFillBuffer(d->queue[slot], d->d_flags[slot], &one, sizeof(int), 0, w->share[i] * sizeof(int), 0, NULL, NULL);
+        if (status != CL_SUCCESS) {
+            report("clEnqueueWriteBuffer failed\n");
+            exit(-1);
+        }
+
+        if (d->coalesced) {
+            // Run kernel over clauses x candidates.
+            size_t groups = (d->compute_units * GROUPS_PER_UNIT + w->share[i] - 1) / w->share[i];
+            if (groups > d->batchGroups) {
+                groups = d->batchGroups;
+            }
+            status = clSetKernelArg(d->batch_kernel, 1, sizeof(cl_mem), &d->d_candidates[slot]);
+            status |= clSetKernelArg(d->batch_kernel, 2, sizeof(cl_mem), &d->d_flags[slot]);
+            batchWorkSize[0] = groups * d->batchLocalWorkSize[0];
+            batchWorkSize[1] = w->share[i];
+            status |= clEnqueueNDRangeKernel(d->queue[slot], d->batch_kernel, 2, NULL, batchWorkSize, d->batchLocalWorkSize, 0, NULL, &w->run[i]);
+        } else {
+            // Run kernel over candidates x clause ranges.
+            status = clSetKernelArg(d->batch_kernel, 2, sizeof(cl_mem), &d->d_candidates[slot]);
+            status |= clSetKernelArg(d->batch_kernel, 4, sizeof(cl_mem), &d->d_flags[slot]);
+            batchWorkSize[0] = w->share[i];
+            batchWorkSize[1] = WI;
+            status |= clEnqueueNDRangeKernel(d->queue[slot], d->batch_kernel, 2, NULL, batchWorkSize, NULL, 0, NULL, &w->run[i]);
+        }
+        if (status != CL_SUCCESS) {
+            report("clEnqueueNDRangeKernel failed\n");
+            exit(-1);
+        }
+
+        // Copy back the flags to the host.
+        status = clEnqueueReadBuffer(d->queue[slot], d->d_flags[slot], CL_FALSE, 0, w->share[i] * sizeof(int), flags + offset, 0, NULL, &w->last[i]);
+        if (status != CL_SUCCESS) {
+            report("clEnqueueReadBuffer failed\n");
+            exit(-1);
+        }
+        clFlush(d->queue[slot]);
+        bytes_to_device += w->share[i] * p->N * sizeof(int);
+        bytes_from_device += w->share[i] * sizeof(int);
+        offset += w->share[i];
+    }
+}
+
+// Waits for the flags of a batch started by submit_batch(). Only the time spent waiting here
+// counts as the host's: the part of the kernels that ran before goes to the overlap time.
+void wait_batch(struct work *w)
+{
+    struct timespec S_idle_timer;
+    clock_gettime(CLOCK_MONOTONIC, &S_idle_timer);
+
+    add_kernel_times(&S_idle_timer, merge_work(w));
+}
 
-    communication_time += idle_time - GPU_run_time;
+// This function checks whether a partial assignment that was valid is still valid after
+// lit was made true, using the GPU. Only the clauses holding the negation of lit can have
+// become false, so the kernel checks the occurrence list of that literal alone, on the
+// primary device.
+int valid_literal(struct problem *p, int *vector, int lit)
+{
+    struct device *d = &devs[0];
+    int idx = LIT_INDEX(-lit);
+    int start = p->occ_offsets[idx];
+    int items = p->occ_offsets[idx + 1] - start;
+    int sum;
+    size_t occGlobalWorkSize[1];
+    cl_event event;
+
+    // A literal that no clause holds leaves every clause as it was.
+    if (items == 0) {
+        return 1;
+    }
+
+    struct timespec S_idle_timer;
+    clock_gettime(CLOCK_MONOTONIC, &S_idle_timer);
+
+    upload_vector(p, vector);
+
+    // Run kernel, one thread per clause of the list.
+    status = clSetKernelArg(d->occ_kernel, 6, sizeof(int), &start);
+    status |= clSetKernelArg(d->occ_kernel, 7, sizeof(int), &items);
+    if (status != CL_SUCCESS) {
+        report("clSetKernelArg failed\n");
+        exit(-1);
+    }
+    occGlobalWorkSize[0] = ((items + d->occLocalWorkSize[0] - 1) / d->occLocalWorkSize[0]) * d->occLocalWorkSize[0];
+    status = clEnqueueNDRangeKernel(d->queue[0], d->occ_kernel, 1, NULL, occGlobalWorkSize, d->occLocalWorkSize, 0, NULL, &event);
+    if (status != CL_SUCCESS) {
+        report("clEnqueueNDRangeKernel failed\n");
+        exit(-1);
+    }
 
-    // Reduce the partial sums.
-    int sum = 0;
-    for (int i = 0; i < WI; i++) {
-        sum += partial_sums[i];
+    // Copy back the count of valid clauses to the host.
+    status = clEnqueueReadBuffer(d->queue[0], d->d_count, CL_TRUE, 0, sizeof(int), &sum, 0, NULL, NULL);
+    if (status != CL_SUCCESS) {
+        report("clEnqueueReadBuffer failed\n");
+        exit(-1);
     }
 
-    free(partial_sums);
+    clWaitForEvents(1, &event);
+    add_kernel_times(&S_idle_timer, event_time(event));
+    kernel_launches++;
+    bytes_from_device += sizeof(int);
 
     // Check validation.
-    if (sum < K) {
+    if (sum < items) {
         return 0;
     }
 
@@ -179,257 +416,396 @@ int valid(struct frontier_node *node)
 // Depth-First Search functions
 #include "dfs.c"
 
-int main(int argc, char **argv)
-{
-    int err;
+// Batched Depth-First Search functions
+#include "batch.c"
 
-    srand((unsigned)time(NULL));
+// Exhaustive enumeration functions
+#include "enum.c"
 
-    if (argc != 3) {
-        syntax_error(argv);
-        exit(-1);
-    }
+// Many-instance mode functions
+#include "instances.c"
 
-    WI = atoi(argv[1]);
+char *search_mode;              // Search algorithm, or NULL to choose it for each problem.
+char *kernel_name = "legacy"; // Vector validation kernel.
+int work_items;                 // Work items requested on the command line.
+int max_devices;                // Devices to use, 0 for every device.
+int sub_units;                  // Compute units of the sub-devices of CPU devices, 0 for none.
 
-    err = readfile(argv[2]);
-    if (err < 0) {
-        exit(-1);
+// Chooses the search algorithm for a problem, unless one was requested: small problems are
+// enumerated exhaustively.
+char *choose_mode(struct problem *p)
+{
+    if (search_mode != NULL) {
+        return search_mode;
     }
 
-    printf("\nThis OpenCL programm solves the Propositional (Boolean) Satisfiability Problem \n");
-    printf("written in file %s, using Depth First Search Algorithm.\n", argv[2]);
-    printf("Number of work items: %s\n\n", argv[1]);
+    return (p->N <= ENUM_AUTO_N) ? "enum" : "dfs";
+}
 
-    printf("Device info:\n\n");
-    cl_uint numPlatforms = 0;
-    cl_platform_id* platforms;
-    // Query for the number of recongnized platforms.
-    status = clGetPlatformIDs(0, NULL, &numPlatforms);
-    if (status != CL_SUCCESS) {
-        printf("clGetPlatformIDs failed. Program terminates.\n");
-        exit(-1);
+// Splits the clauses of a problem among the work items and passes the problem to every
+// device, reusing the kernels and buffers of the previous problem.
+void problem_setup(struct problem *p)
+{
+    WI = work_items;
+    if (p->K <= WI) {
+        WI = p->K; // If K is less than threads, we use K threads.
     }
 
-    // Make sure some platforms were found.
-    if (numPlatforms == 0) {
-        printf("No platforms detected. Program terminates.\n");
-        exit(-1);
-    }
+    // Define the step and finishing index for each thread.
+    d_step = p->K / WI;
 
-    // Allocate enough space for each platform.
-    platforms = (cl_platform_id*)malloc(numPlatforms * sizeof(cl_platform_id));
-    if (platforms == NULL) {
-        perror("malloc");
+    d_finish_host = (int*)realloc(d_finish_host, WI * sizeof(int)); // Finishing index of each work item.
+    if (d_finish_host == NULL) {
+        report("Memory exhausted. Program terminates.\n");
         exit(-1);
     }
+    for (int i = 0; i < WI - 1; i++) {
+        d_finish_host[i] = d_step*(i + 1);
+    }
+    // Last thread gets the extra work if K mod WI != 0.
+    d_finish_host[WI - 1] = p->K;
 
-    // Fill in platforms.
-    clGetPlatformIDs(numPlatforms, platforms, NULL);
-    if (status != CL_SUCCESS) {
-        printf("clGetPlatformIDs failed. Program terminates.\n");
+    // The vector starts unassigned on both sides.
+    d_vector_copy = (int*)realloc(d_vector_copy, p->N * sizeof(int));
+    if (d_vector_copy == NULL) {
+        report("Memory exhausted. Program terminates.\n");
         exit(-1);
     }
+    memset(d_vector_copy, 0, p->N * sizeof(int));
 
-    // Print out some basic information about each platform.
-    printf("%u platforms detected\n", numPlatforms);
-    for (int i = 0; i < numPlatforms; i++) {
-        char buf[100];
-        printf("Platform %u: \n", i);
-        status = clGetPlatformInfo(platforms[i], CL_PLATFORM_VENDOR, sizeof(buf), buf, NULL);
-        printf("\tVendor: %s\n", buf);
-        status |= clGetPlatformInfo(platforms[i], CL_PLATFORM_NAME, sizeof(buf), buf, NULL);
-        printf("\tName: %s\n", buf);
-        if (status != CL_SUCCESS) {
-            printf("clGetPlatformInfo failed. Program terminates.\n");
-            exit(-1);
-        }
+    // Every device gets its kernels and its copy of the problem.
+    for (int i = 0; i < num_devs; i++) {
+        device_setup(&devs[i], p, kernel_name, batch_size);
     }
-    printf("\n");
+}
 
-    // Retrive the number of devices present.
-    cl_uint numDevices = 0;
-    cl_device_id* devices;
-    status = clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, 0, NULL, &numDevices);
-    if (status != CL_SUCCESS) {
-        printf("clGetDeviceIDs failed. Program terminates.\n");
-        exit(-1);
+// Runs a search algorithm on a problem: whole assignment space, one vector per
+// launch, batches of candidates, or the cubes read from a file if cube_file is set.
+// Returns what the algorithm returns, and points algorithm to its name.
+int run_search(struct problem *p, char *mode, char *cube_file, char **algorithm)
+{
+    if (strcmp(mode, "enum") == 0) {
+        *algorithm = "exhaustive enumeration";
+        return enumerate(p, engine.assignment);
+    } else if (cube_file != NULL) {
+        *algorithm = "depth-first search of the cubes";
+        return search_cubes(&engine);
     }
-
-    // Make sure some devices were found.
-    if (numDevices == 0) {
-        printf("No devices detected. Program terminates.\n");
-        exit(-1);
+    *algorithm = "depth-first";
+    if (batch_size > 1) {
+        return batch_search(&engine);
     }
 
-    // Allocate enough space for each device.
-    devices = (cl_device_id*)malloc(numDevices * sizeof(cl_device_id));
-    if (devices == NULL) {
-        perror("malloc");
-        exit(-1);
-    }
+    return search(&engine);
+}
 
-    // Fill in devices.
-    status = clGetDeviceIDs(platforms[0], CL_DEVICE_TYPE_GPU, numDevices, devices, NULL);
-    if (status != CL_SUCCESS) {
-        printf("clGetDeviceIDs failed. Program terminates.\n");
-        exit(-1);
+// Sets the devices up and builds their programs, once for every problem of a many-instance
+// run. The enumeration kernel is built unless another algorithm was requested.
+void instances_setup(void)
+{
+    devices_init(max_devices, sub_units);
+    devices_build(search_mode == NULL || strcmp(search_mode, "enum") == 0);
+}
+
+// Searches a problem of a many-instance run, after its preprocessing, and stores its
+// solution in vector. Returns 1 if a solution was found, 0 if none exists, or -1 on error.
+int search_instance(struct problem *p, int *vector)
+{
+    int found;
+    char *mode, *algorithm;
+
+    mode = choose_mode(p);
+    found = engine_init(&engine, p);
+    if (found == 0) {
+        found = heuristic_init(&engine, HEURISTIC_FIRST, 0);
+    }
+    if (found == 0) {
+        problem_setup(p);
+        found = run_search(p, mode, NULL, &algorithm);
     }
+    if (found > 0) {
+        memcpy(vector, engine.assignment, p->N * sizeof(int));
+    }
+    engine_free(&engine);
 
-    // Print out some basic information about each device.
-    printf("%u devices detected\n", numDevices);
-    for (int i = 0; i < numDevices; i++) {
-        char buf[100];
-        printf("Device %u: \n", i);
-        status = clGetDeviceInfo(devices[i], CL_DEVICE_VENDOR, sizeof(buf), buf, NULL);
-        printf("\tDevice: %s\n", buf);
-        status |= clGetDeviceInfo(devices[i], CL_DEVICE_NAME, sizeof(buf), buf, NULL);
-        printf("\tName: %s\n", buf);
-        if (status != CL_SUCCESS) {
-            printf("clGetDeviceInfo failed. Program terminates.\n");
+    return found;
+}
+
+int main(int argc, char **argv)
+{
+    int err;
+    char *work_items_arg = NULL;
+    char *filename = NULL;
+    char *mode = NULL;
+    char *cube_file = NULL;
+    char *list = NULL;
+    int stream = 0;
+
+    run_start = wall_clock();
+    srand((unsigned)time(NULL));
+
+    batch_size = BATCH_DEFAULT;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--mode=", 7) == 0) {
+            mode = argv[i] + 7;
+            if (strcmp(mode, "dfs") != 0 && strcmp(mode, "enum") != 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--kernel=", 9) == 0) {
+            kernel_name = argv[i] + 9;
+            if (strcmp(kernel_name, "coalesced") != 0 && strcmp(kernel_name, "legacy") != 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--batch=", 8) == 0) {
+            batch_size = atoi(argv[i] + 8);
+            if (batch_size < 1) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--preprocess") == 0) {
+            preprocessing = 1;
+        } else if (strncmp(argv[i], "--cube-file=", 12) == 0) {
+            cube_file = argv[i] + 12;
+        } else if (strncmp(argv[i], "--devices=", 10) == 0) {
+            max_devices = atoi(argv[i] + 10);
+            if (max_devices < 1) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--sub-devices=", 14) == 0) {
+            sub_units = atoi(argv[i] + 14);
+            if (sub_units < 1) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--no-pipeline") == 0) {
+            batch_pipeline = 0;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            srand((unsigned)strtoul(argv[i] + 7, NULL, 10));
+        } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+            if (stats_parse(argv[i] + 8) < 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strncmp(argv[i], "--progress=", 11) == 0) {
+            progress_interval = atof(argv[i] + 11);
+            if (progress_interval <= 0) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        } else if (strncmp(argv[i], "--program-cache=", 16) == 0) {
+            program_cache_dir = argv[i] + 16;
+        } else if (strcmp(argv[i], "--no-program-cache") == 0) {
+            use_program_cache = 0;
+        } else if (strncmp(argv[i], "--list=", 7) == 0) {
+            list = argv[i] + 7;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = 1;
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            instance_jobs = atoi(argv[i] + 7);
+            if (instance_jobs < 1) {
+                syntax_error(argv);
+                exit(-1);
+            }
+        } else if (strcmp(argv[i], "--models") == 0) {
+            instance_models = 1;
+        } else if (argv[i][0] == '-' || filename != NULL) {
+            syntax_error(argv);
             exit(-1);
+        } else if (work_items_arg == NULL) {
+            work_items_arg = argv[i];
+        } else {
+            filename = argv[i];
         }
     }
-    printf("\n");
-
-    // Create a context and associate it with the devices.
-    context = clCreateContext(NULL, numDevices, devices, NULL, NULL, &status);
-    if (status != CL_SUCCESS || context == NULL) {
-        printf("clCreateContext failed. Program terminates.\n");
+    if (work_items_arg == NULL) {
+        syntax_error(argv);
         exit(-1);
     }
+    work_items = atoi(work_items_arg);
+    search_mode = mode;
 
-    // Create a command queue and associate it with the device you want to execute on.
-    cmdQueue = clCreateCommandQueueWithProperties(context, devices[0], NULL, &status);
-    if (status != CL_SUCCESS || cmdQueue == NULL) {
-        printf("clCreateCommandQueue failed. Program terminates.\n");
+    // Many problems are solved by one process, one result line each, on devices set up once.
+    if (list != NULL || stream) {
+        if (filename != NULL || (list != NULL && stream) || cube_file != NULL || stats_format != STATS_NONE ||
+            progress_interval > 0) {
+            syntax_error(argv);
+            exit(-1);
+        }
+        if (run_instances(stream ? "-" : list, stream) < 0) {
+            exit(-1);
+        }
+        return 0;
+    }
+    if (filename == NULL) {
+        syntax_error(argv);
         exit(-1);
     }
 
-    cl_program program;
-    char *source;
-    const char *sourceFile = "cl_valid.cl";
-    // This function reads in the source code of the program.
-    source = readSource(sourceFile);
-    // Create a program. The 'source' string is the code from the cl_valid.cl file.
-    program = clCreateProgramWithSource(context, 1, (const char**)&source, NULL, &status);
-    if (status != CL_SUCCESS) {
-        printf("clCreateProgramWithSource failed. Program terminates.\n");
+    phase_begin(PHASE_PARSE);
+    err = readfile(filename);
+    if (err < 0) {
         exit(-1);
     }
 
-    cl_int buildErr;
-    // Build (compile & link) the program for the devices.
-    // Save the return value in 'buildErr' (the following
-    // code will print any compilation errors to the screen).
-    buildErr = clBuildProgram(program, numDevices, devices, NULL, NULL, NULL);
-    // If there are build errors, print them to the screen.
-    if (buildErr != CL_SUCCESS) {
-        printf("Program failed to build.\n");
-        cl_build_status buildStatus;
-        for (int i = 0; i < numDevices; i++) {
-            clGetProgramBuildInfo(program, devices[i], CL_PROGRAM_BUILD_STATUS, sizeof(cl_build_status), &buildStatus, NULL);
-            if (buildStatus == CL_SUCCESS) {
-                continue;
-            }
-            char *buildLog;
-            size_t buildLogSize;
-            clGetProgramBuildInfo(program, devices[i], CL_PROGRAM_BUILD_LOG, 0, NULL, &buildLogSize);
-            buildLog = (char*)malloc(buildLogSize);
-            if (buildLog == NULL) {
-                perror("malloc");
+    // Simplify the problem before the search. When that decides the problem on its own,
+    // there is nothing left to search.
+    int reduced = PRE_REDUCED;
+    if (preprocessing) {
+        phase_begin(PHASE_PREPROCESS);
+        reduced = preprocess(&input, &reduction);
+        if (reduced < 0) {
+            exit(-1);
+        }
+    }
+    if (reduced != PRE_REDUCED) {
+        printf("\nThis OpenCL programm solves the Propositional (Boolean) Satisfiability Problem \n");
+        printf("written in file %s, using Preprocessing.\n", filename);
+        if (reduced == PRE_SAT) {
+            int *model = preprocess_model(&reduction, input.N, NULL);
+            if (model == NULL) {
                 exit(-1);
             }
-            clGetProgramBuildInfo(program, devices[i], CL_PROGRAM_BUILD_LOG, buildLogSize, buildLog, NULL);
-            buildLog[buildLogSize - 1] = '\0';
-            printf("Device %u Build Log:\n%s\n", i, buildLog);
-            free(buildLog);
+            printf("\nSolution found with preprocessing!\n");
+            printf("\nSolution vector propositions values:\n");
+            display(model, reduction.N);
+        } else {
+            printf("\nNO SOLUTION EXISTS. Proved by preprocessing!");
         }
-        exit(0);
+        printf("\n");
+        if (stats_begin("sat_GPU", filename, &input, "preprocess", reduced == PRE_SAT ? "SAT" : "UNSAT", &engine)) {
+            stats_end();
+        }
+        return 0;
     }
 
-    // Create a kernel from the vector validation function (named "clvalid").
-    kernel = clCreateKernel(program, "clvalid", &status);
-    if (status != CL_SUCCESS) {
-        printf("clCreateKernel failed. Program terminates.\n");
+    phase_begin(PHASE_SETUP);
+    err = occurrences_init(&input);
+    if (err < 0) {
         exit(-1);
     }
 
-    // Define an index space (global work size) of threads for execution.
-    // A workgroup size (local work size) is not required, but can be used.
-    // There are WI threads.
-    if (K <= WI) {
-        WI = K; // If K is less than threads, we use K threads.
+    // Small problems are enumerated exhaustively unless a mode or cubes are requested.
+    // Cubes are searched depth-first.
+    if (cube_file != NULL) {
+        if (mode != NULL && strcmp(mode, "dfs") != 0) {
+            syntax_error(argv);
+            exit(-1);
+        }
+        mode = "dfs";
+        if (read_cubes(&input, cube_file) < 0 || cube_results_init() < 0) {
+            exit(-1);
+        }
     }
-    globalWorkSize[0] = WI;
-
-    // Define the step and finishing index for each thread.
-    d_step = K / WI;
+    search_mode = mode;
+    mode = choose_mode(&input);
 
-    int *finish = (int*)malloc(WI * sizeof(int)); // Finishing index of each work item.
-    if (finish == NULL) {
-        printf("Memory exhausted. Program terminates.\n");
+    err = engine_init(&engine, &input);
+    if (err < 0) {
         exit(-1);
     }
-    for (int i = 0; i < WI - 1; i++) {
-        finish[i] = d_step*(i + 1);
-    }
-    // Last thread gets the extra work if K mod WI != 0.
-    finish[WI - 1] = K;
 
-    // Pass data to GPU.
-    d_finish = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, WI * sizeof(int), finish, &status);
-    if (status != CL_SUCCESS || d_finish == NULL) {
-        printf("clCreateBuffer failed. Program terminates.\n");
+    err = heuristic_init(&engine, HEURISTIC_FIRST, 0);
+    if (err < 0) {
         exit(-1);
     }
 
-    d_problem = clCreateBuffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, K*M * sizeof(int), Problem, &status);
-    if (status != CL_SUCCESS || d_problem == NULL) {
-        printf("clCreateBuffer failed. Program terminates.\n");
-        exit(-1);
+    printf("\nThis OpenCL programm solves the Propositional (Boolean) Satisfiability Problem \n");
+    if (strcmp(mode, "enum") == 0) {
+        printf("written in file %s, using Exhaustive Enumeration.\n", filename);
+        printf("Assignments per kernel launch: %d\n\n", ENUM_CHUNK);
+    } else {
+        printf("written in file %s, using Depth First Search Algorithm.\n", filename);
+        printf("Number of work items: %d\n", work_items);
+        printf("Validation kernel: %s\n", kernel_name);
+        if (cube_file != NULL) {
+            printf("Cubes: %d, from %s\n\n", num_cubes, cube_file);
+        } else {
+            printf("Candidates per kernel launch: %d\n\n", batch_size);
+        }
     }
 
-    // Set kernel arguments.
-    status = clSetKernelArg(kernel, 0, sizeof(cl_mem), &d_problem);
-    status |= clSetKernelArg(kernel, 2, sizeof(cl_mem), &d_finish);
-    status |= clSetKernelArg(kernel, 4, sizeof(int), &d_step);
-    status |= clSetKernelArg(kernel, 5, sizeof(int), &M);
-    if (status != CL_SUCCESS) {
-        printf("clSetKernelArg failed. Program terminates.\n");
-        exit(-1);
+    printf("Device info:\n\n");
+    devices_init(max_devices, sub_units);
+    phase_begin(PHASE_BUILD);
+    devices_build(strcmp(mode, "enum") == 0);
+    phase_begin(PHASE_SETUP);
+    problem_setup(&input);
+
+    if (program_cache_hits > 0) {
+        printf("Programs loaded from the cache in %0.3f secs, starting solving the problem...\n", phase_time[PHASE_BUILD]);
+    } else {
+        printf("No build errors, starting solving the problem...\n");
     }
 
-    printf("No build errors, starting solving the problem...\n");
+    //display_problem(&input);
 
-    //display_problem();
-
-    struct frontier_node* solution_node = search(); // The main call.
+    // The main call.
+    char *algorithm;
+    int found;
+    phase_begin(PHASE_SEARCH);
+    stats_track(&engine);
+    progress_start();
+    found = run_search(&input, mode, cube_file, &algorithm);
+    if (cube_file != NULL) {
+        printf("\nCubes of %s:\n", cube_file);
+        report_cubes();
+    }
+    progress_stop();
+    stats_untrack(&engine);
+    phase_end();
 
-    if (solution_node != NULL) {
-        printf("\nSolution found with depth-first!\n");
+    if (found > 0) {
+        printf("\nSolution found with %s!\n", algorithm);
         printf("\nSolution vector propositions values:\n");
-        display(solution_node->vector);
-
-    } else {
-        if (mem_error == -1) {
-            printf("Memory exhausted. Program terminates.\n");
+        if (preprocessing) {
+            int *model = preprocess_model(&reduction, input.N, engine.assignment);
+            if (model == NULL) {
+                exit(-1);
+            }
+            display(model, reduction.N);
         } else {
-            printf("\nNO SOLUTION EXISTS. Proved by depth-first!");
+            display(engine.assignment, input.N);
         }
+    } else if (found < 0) {
+        exit(-1);
+    } else {
+        printf("\nNO SOLUTION EXISTS. Proved by %s!", algorithm);
     }
 
-    printf("\n\nTime spent = %0.3f\n", ((float)t2 - t1) / CLOCKS_PER_SEC);
+    printf("\n\nTime spent = %0.3f\n", t2 - t1);
+    printf("Startup time = %0.3f (build %0.3f)\n", startup_time(), phase_time[PHASE_BUILD]);
+    report_devices(strcmp(mode, "enum") == 0 ? "assignments" : "candidates");
     printf("GPU execution time = %0.3f\n", GPU_run_time_sum);
     printf("Communication time = %0.3f\n", communication_time);
+    if (overlap_time > 0) {
+        printf("Overlapped GPU time = %0.3f (%0.0f%% of GPU execution time)\n", overlap_time, overlap_time * 100.0 / GPU_run_time_sum);
+    }
+    printf("Kernel launches = %lu\n", kernel_launches);
+    if (kernel_launches > 0) {
+        printf("Average kernel time = %0.3f us\n", GPU_run_time_sum * 1000000.0 / kernel_launches);
+    }
+    if (stats_begin("sat_GPU", filename, &input, mode, found > 0 ? "SAT" : "UNSAT", &engine)) {
+        stats_ulong("devices", num_devs);
+        stats_ulong("kernel_launches", kernel_launches);
+        stats_ulong("bytes_to_device", bytes_to_device);
+        stats_ulong("bytes_from_device", bytes_from_device);
+        stats_double("gpu_secs", GPU_run_time_sum);
+        stats_double("communication_secs", communication_time);
+        stats_double("overlap_secs", overlap_time);
+        stats_ulong("program_cache_hits", program_cache_hits);
+        stats_ulong("program_cache_misses", program_cache_misses);
+        stats_end();
+    }
 
     // Cleanup OpenCL structures.
-    clReleaseProgram(program);
-    clReleaseKernel(kernel);
-    clReleaseCommandQueue(cmdQueue);
-    clReleaseMemObject(d_problem);
-    clReleaseMemObject(d_finish);
-    clReleaseContext(context);
+    devices_free();
+    free(d_finish_host);
+    free(d_vector_copy);
 
     return 0;
 }
@@ -0,0 +1,311 @@
+// -----------------------------------------------------------------------
+//
+// Solver statistics. The phases of a run (parsing, preprocessing, setup,
+// kernel build and search) are timed with the monotonic wall clock, and
+// every engine counts its consistency checks, the nodes they pruned, the
+// deepest decision level it reached and the tables it grew while searching.
+// At the end of the run the figures are printed as text after the result,
+// or as a single JSON object on stderr or in a file of its own, so that it
+// can be parsed without the result and the model. A progress thread may also print the nodes of the engines
+// being searched to stderr at a fixed interval.
+//
+// -----------------------------------------------------------------------
+
+#include <pthread.h>
+#include <sys/resource.h>
+
+// Phases of a run.
+#define PHASE_PARSE      0  // Reading the problem file or its binary cache.
+#define PHASE_PREPROCESS 1  // Simplifying the problem.
+#define PHASE_SETUP      2  // Engines, occurrence lists, devices and buffers.
+#define PHASE_BUILD      3  // Building the OpenCL programs.
+#define PHASE_SEARCH     4  // The search itself.
+#define PHASES           5
+
+// Output formats of the statistics.
+#define STATS_NONE 0
+#define STATS_TEXT 1
+#define STATS_JSON 2
+
+const char *phase_names[PHASES] = {"parse", "preprocess", "setup", "build", "search"};
+double phase_time[PHASES];  // Wall time of each phase, in seconds.
+int phase_current = -1;     // Phase being timed, -1 if none.
+double phase_start;         // Wall clock when the current phase began.
+double run_start;           // Wall clock when the run began.
+
+int stats_format = STATS_NONE; // Format of the statistics printed at the end of the run.
+FILE *stats_out;            // Stream of the statistics: stdout for text, stderr or a file for JSON.
+int stats_fields;           // Fields printed so far.
+
+double progress_interval;   // Seconds between progress lines, 0 for none.
+int progress_done;          // Set to stop the progress thread. Always accessed atomically.
+pthread_t progress_thread;
+pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER; // Protects the tracked engines.
+struct engine **tracked;    // Engines whose nodes the progress lines report.
+int num_tracked;            // Number of tracked engines.
+int tracked_capacity;       // Allocated size of tracked.
+
+// Ends the phase being timed, if any, and starts timing phase.
+void phase_begin(int phase)
+{
+    double now = wall_clock();
+
+    if (phase_current >= 0) {
+        phase_time[phase_current] += now - phase_start;
+    }
+    phase_current = phase;
+    phase_start = now;
+}
+
+// Ends the phase being timed, if any.
+void phase_end(void)
+{
+    if (phase_current >= 0) {
+        phase_time[phase_current] += wall_clock() - phase_start;
+        phase_current = -1;
+    }
+}
+
+// Returns the wall time spent before the search: parsing, preprocessing, setup and build.
+double startup_time(void)
+{
+    double startup = 0.0;
+
+    for (int i = 0; i < PHASES; i++) {
+        if (i != PHASE_SEARCH) {
+            startup += phase_time[i];
+        }
+    }
+
+    return startup;
+}
+
+// Parses the argument of --stats: text, json for a JSON object on stderr, or json:<path>
+// for a JSON object written to that file. Returns 0, or -1 if the format is unknown or the
+// file cannot be created.
+int stats_parse(char *format)
+{
+    if (strcmp(format, "text") == 0) {
+        stats_format = STATS_TEXT;
+        stats_out = stdout;
+    } else if (strcmp(format, "json") == 0) {
+        stats_format = STATS_JSON;
+        stats_out = stderr;
+    } else if (strncmp(format, "json:", 5) == 0 && format[5] != '\0') {
+        stats_format = STATS_JSON;
+        stats_out = fopen(format + 5, "w");
+        if (stats_out == NULL) {
+            report("Error: cannot create the statistics file %s.\n", format + 5);
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Adds the counters of an engine to those of another one, which reports the engines of
+// a multi-threaded search as a whole.
+void engine_add_counts(struct engine *to, struct engine *from)
+{
+    COUNT_ADD(to->checks, from->checks);
+    COUNT_ADD(to->pruned, from->pruned);
+    to->conflicts += from->conflicts;
+    to->allocations += from->allocations;
+    COUNT_MAX(to->max_depth, from->max_depth);
+}
+
+// Lets the progress lines report the nodes of an engine until stats_untrack() is called.
+void stats_track(struct engine *e)
+{
+    pthread_mutex_lock(&stats_lock);
+    if (num_tracked == tracked_capacity) {
+        int capacity = tracked_capacity > 0 ? 2 * tracked_capacity : 16;
+        struct engine **grown = (struct engine**)realloc(tracked, capacity * sizeof(struct engine*));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&stats_lock);
+            return;
+        }
+        tracked = grown;
+        tracked_capacity = capacity;
+    }
+    tracked[num_tracked++] = e;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+// Stops reporting the nodes of an engine, before it is freed.
+void stats_untrack(struct engine *e)
+{
+    pthread_mutex_lock(&stats_lock);
+    for (int i = 0; i < num_tracked; i++) {
+        if (tracked[i] == e) {
+            tracked[i] = tracked[--num_tracked];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+// Progress thread: every progress_interval seconds, prints the elapsed search time and
+// the nodes, checks, pruned nodes and deepest level of the tracked engines. The engines
+// are read while they search, so the figures are approximate.
+void *progress_main(void *arg)
+{
+    double start = wall_clock();
+    double last = start, next = start + progress_interval;
+    unsigned long last_nodes = 0;
+    struct timespec pause = {0, 50000000};
+
+    while (!__atomic_load_n(&progress_done, __ATOMIC_ACQUIRE)) {
+        nanosleep(&pause, NULL);
+        double now = wall_clock();
+        if (now < next || __atomic_load_n(&progress_done, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        unsigned long nodes = 0, checks = 0, pruned = 0;
+        int depth = 0;
+        pthread_mutex_lock(&stats_lock);
+        for (int i = 0; i < num_tracked; i++) {
+            nodes += __atomic_load_n(&tracked[i]->nodes, __ATOMIC_RELAXED);
+            checks += __atomic_load_n(&tracked[i]->checks, __ATOMIC_RELAXED);
+            pruned += __atomic_load_n(&tracked[i]->pruned, __ATOMIC_RELAXED);
+            if (__atomic_load_n(&tracked[i]->max_depth, __ATOMIC_RELAXED) > depth) {
+                depth = __atomic_load_n(&tracked[i]->max_depth, __ATOMIC_RELAXED);
+            }
+        }
+        pthread_mutex_unlock(&stats_lock);
+
+        fprintf(stderr, "Progress: %0.1f secs, %lu nodes (%0.0f nodes/sec), %lu checks, %lu pruned, depth %d\n",
+                now - start, nodes, (nodes - last_nodes) / (now - last), checks, pruned, depth);
+        last_nodes = nodes;
+        last = now;
+        next = now + progress_interval;
+    }
+
+    return NULL;
+}
+
+// Starts the progress thread, if progress lines were requested.
+void progress_start(void)
+{
+    __atomic_store_n(&progress_done, 0, __ATOMIC_RELEASE);
+    if (progress_interval > 0 && pthread_create(&progress_thread, NULL, progress_main, NULL) != 0) {
+        progress_interval = 0;
+    }
+}
+
+// Stops the progress thread, if it runs.
+void progress_stop(void)
+{
+    if (progress_interval > 0) {
+        __atomic_store_n(&progress_done, 1, __ATOMIC_RELEASE);
+        pthread_join(progress_thread, NULL);
+    }
+}
+
+// Starts the name of a field, with the separator the format needs.
+void stats_field(const char *name)
+{
+    if (stats_format == STATS_JSON) {
+        fprintf(stats_out, "%s\"%s\": ", stats_fields > 0 ? ", " : "", name);
+    } else {
+        fprintf(stats_out, "    %-24s ", name);
+    }
+    stats_fields++;
+}
+
+// Prints a field holding a string, escaped for JSON.
+void stats_string(const char *name, const char *value)
+{
+    stats_field(name);
+    if (stats_format != STATS_JSON) {
+        fprintf(stats_out, "%s\n", value);
+        return;
+    }
+    fputc('"', stats_out);
+    for (const char *c = value; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(stats_out, "\\%c", *c);
+        } else if ((unsigned char)*c < 0x20) {
+            fprintf(stats_out, "\\u%04x", *c);
+        } else {
+            fputc(*c, stats_out);
+        }
+    }
+    fputc('"', stats_out);
+}
+
+// Prints a field holding a count.
+void stats_ulong(const char *name, unsigned long value)
+{
+    stats_field(name);
+    fprintf(stats_out, stats_format == STATS_JSON ? "%lu" : "%lu\n", value);
+}
+
+// Prints a field holding a time or a rate.
+void stats_double(const char *name, double value)
+{
+    stats_field(name);
+    fprintf(stats_out, stats_format == STATS_JSON ? "%0.6f" : "%0.3f\n", value);
+}
+
+// Starts the statistics of a run, if requested, with the fields common to both programs:
+// the problem p searched, the result, the phase times, and the counters of the engine e, to
+// which multi-threaded searches add the counters of their engines. Fields specific to a
+// program follow, then stats_end(). Returns 0 if no statistics were requested.
+int stats_begin(char *program, char *filename, struct problem *p, char *mode, char *result, struct engine *e)
+{
+    char name[32];
+    struct rusage usage;
+
+    phase_end();
+    if (stats_format == STATS_NONE) {
+        return 0;
+    }
+
+    stats_fields = 0;
+    if (stats_format == STATS_JSON) {
+        fflush(stdout);
+        fprintf(stats_out, "{");
+    } else {
+        fprintf(stats_out, "\nStatistics:\n");
+    }
+    stats_string("program", program);
+    stats_string("file", filename);
+    stats_string("mode", mode);
+    stats_string("result", result);
+    stats_ulong("propositions", p->N);
+    stats_ulong("clauses", p->K);
+    for (int i = 0; i < PHASES; i++) {
+        snprintf(name, sizeof(name), "%s_secs", phase_names[i]);
+        stats_double(name, phase_time[i]);
+    }
+    stats_double("startup_secs", startup_time());
+    stats_double("total_secs", wall_clock() - run_start);
+    stats_ulong("nodes", e->nodes);
+    stats_double("nodes_per_sec", phase_time[PHASE_SEARCH] > 0 ? e->nodes / phase_time[PHASE_SEARCH] : 0.0);
+    stats_ulong("checks", e->checks);
+    stats_ulong("pruned", e->pruned);
+    stats_ulong("max_depth", e->max_depth);
+    stats_ulong("conflicts", e->conflicts);
+    stats_ulong("search_allocations", e->allocations);
+    getrusage(RUSAGE_SELF, &usage);
+    stats_ulong("peak_rss_kb", usage.ru_maxrss);
+
+    return 1;
+}
+
+// Ends the statistics of a run, and closes their file if they have one.
+void stats_end(void)
+{
+    if (stats_format == STATS_JSON) {
+        fprintf(stats_out, "}\n");
+    }
+    if (stats_out != stdout && stats_out != stderr) {
+        fclose(stats_out);
+    } else {
+        fflush(stats_out);
+    }
+}